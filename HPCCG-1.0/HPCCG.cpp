@@ -45,6 +45,13 @@
 
 // niters - On output, the number of iterations actually performed.
 
+// cg_variant - CG_STANDARD, CG_FUSED or CG_PIPELINED (see HPCCG.hpp).
+//              All variants fill times[] the same way.
+
+// overlap_exchange - In MPI mode, overlap exchange_externals with the
+//                    interior rows of sparsemv (see HPC_sparsemv_overlap).
+//                    Ignored in serial mode.
+
 /////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
@@ -54,15 +61,40 @@ using std::endl;
 #include <cmath>
 #include "mytimer.hpp"
 #include "HPCCG.hpp"
+#include "first_touch.hpp"
+#include "compute_residual.hpp"
 
 #define TICK()  t0 = mytimer() // Use TICK and TOCK to time a code section
 #define TOCK(t) t += mytimer() - t0
+
+static int HPCCG_fused(HPC_Sparse_Matrix * A,
+	  const double * const b, double * const x,
+	  const int max_iter, const double tolerance, int &niters, double & normr,
+	  double * times, const bool overlap_exchange);
+static int HPCCG_pipelined(HPC_Sparse_Matrix * A,
+	  const double * const b, double * const x,
+	  const int max_iter, const double tolerance, int &niters, double & normr,
+	  double * times, const bool overlap_exchange);
+static int HPCCG_mixed(HPC_Sparse_Matrix * A,
+	  const double * const b, double * const x,
+	  const int max_iter, const double tolerance, int &niters, double & normr,
+	  double * times);
+
 int HPCCG(HPC_Sparse_Matrix * A,
 	  const double * const b, double * const x,
 	  const int max_iter, const double tolerance, int &niters, double & normr,
-	  double * times)
+	  double * times, const int cg_variant, const bool overlap_exchange)
 
 {
+  if (cg_variant == CG_FUSED)
+    return HPCCG_fused(A, b, x, max_iter, tolerance, niters, normr, times,
+		       overlap_exchange);
+  if (cg_variant == CG_PIPELINED)
+    return HPCCG_pipelined(A, b, x, max_iter, tolerance, niters, normr, times,
+			   overlap_exchange);
+  if (cg_variant == CG_MIXED)
+    return HPCCG_mixed(A, b, x, max_iter, tolerance, niters, normr, times);
+
   double t_begin = mytimer();  // Start timing right away
 
   double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0;
@@ -75,6 +107,9 @@ int HPCCG(HPC_Sparse_Matrix * A,
   double * r = new double [nrow];
   double * p = new double [ncol]; // In parallel case, A is rectangular
   double * Ap = new double [nrow];
+  first_touch(r, nrow); // Place pages with the threads that use them
+  first_touch(p, ncol);
+  first_touch(Ap, nrow);
 
   normr = 0.0;
   double rtrans = 0.0;
@@ -122,9 +157,18 @@ int HPCCG(HPC_Sparse_Matrix * A,
      
 
 #ifdef USING_MPI
-      TICK(); exchange_externals(A,p); TOCK(t5); 
-#endif
+      if (overlap_exchange)
+	{
+	  HPC_sparsemv_overlap(A, p, Ap, 0, t3, t5, t4); // 2*nnz ops
+	}
+      else
+	{
+	  TICK(); exchange_externals(A,p); TOCK(t5); 
+	  TICK(); HPC_sparsemv(A, p, Ap); TOCK(t3); // 2*nnz ops
+	}
+#else
       TICK(); HPC_sparsemv(A, p, Ap); TOCK(t3); // 2*nnz ops
+#endif
       double alpha = 0.0;
       TICK(); ddot(nrow, p, Ap, &alpha, t4); TOCK(t1); // 2*nrow ops
       alpha = rtrans/alpha;
@@ -147,3 +191,396 @@ int HPCCG(HPC_Sparse_Matrix * A,
   times[0] = mytimer() - t_begin;  // Total time. All done...
   return(0);
 }
+
+/////////////////////////////////////////////////////////////////////////
+// Fused CG: same recurrences as above, but p'*Ap is computed inside
+// sparsemv and the x and r updates share one pass that also produces
+// r'*r for the next iteration.
+/////////////////////////////////////////////////////////////////////////
+
+static int HPCCG_fused(HPC_Sparse_Matrix * A,
+	  const double * const b, double * const x,
+	  const int max_iter, const double tolerance, int &niters, double & normr,
+	  double * times, const bool overlap_exchange)
+
+{
+  double t_begin = mytimer();  // Start timing right away
+
+  double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0;
+#ifdef USING_MPI
+  double t5 = 0.0;
+#endif
+  int nrow = A->local_nrow;
+  int ncol = A->local_ncol;
+
+  double * r = new double [nrow];
+  double * p = new double [ncol]; // In parallel case, A is rectangular
+  double * Ap = new double [nrow];
+  first_touch(r, nrow); // Place pages with the threads that use them
+  first_touch(p, ncol);
+  first_touch(Ap, nrow);
+
+  normr = 0.0;
+  double rtrans = 0.0;
+  double oldrtrans = 0.0;
+
+#ifdef USING_MPI
+  int rank; // Number of MPI processes, My process ID
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#else
+  int rank = 0; // Serial case (not using MPI)
+#endif
+
+  int print_freq = max_iter/10; 
+  if (print_freq>50) print_freq=50;
+  if (print_freq<1)  print_freq=1;
+
+  // p is of length ncols, copy x to p for sparse MV operation
+  TICK(); waxpby(nrow, 1.0, x, 0.0, x, p); TOCK(t2);
+#ifdef USING_MPI
+  TICK(); exchange_externals(A,p); TOCK(t5); 
+#endif
+  TICK(); HPC_sparsemv(A, p, Ap); TOCK(t3);
+  TICK(); waxpby(nrow, 1.0, b, -1.0, Ap, r); TOCK(t2);
+  TICK(); ddot(nrow, r, r, &rtrans, t4); TOCK(t1);
+  normr = sqrt(rtrans);
+
+  if (rank==0) cout << "Initial Residual = "<< normr << endl;
+
+  for(int k=1; k<max_iter && normr > tolerance; k++ )
+    {
+      if (k == 1)
+	{
+	  TICK(); waxpby(nrow, 1.0, r, 0.0, r, p); TOCK(t2);
+	}
+      else
+	{
+	  double beta = rtrans/oldrtrans;
+	  TICK(); waxpby (nrow, 1.0, r, beta, p, p);  TOCK(t2);// 2*nrow ops
+	}
+      if (rank==0 && (k%print_freq == 0 || k+1 == max_iter))
+      cout << "Iteration = "<< k << "   Residual = "<< normr << endl;
+     
+
+      double alpha = 0.0;
+#ifdef USING_MPI
+      if (overlap_exchange)
+	{
+	  HPC_sparsemv_overlap(A, p, Ap, &alpha, t3, t5, t4); // 2*nnz+2*nrow ops
+	}
+      else
+	{
+	  TICK(); exchange_externals(A,p); TOCK(t5); 
+	  TICK(); HPC_sparsemv_ddot(A, p, Ap, &alpha, t4); TOCK(t3); // 2*nnz+2*nrow ops
+	}
+#else
+      TICK(); HPC_sparsemv_ddot(A, p, Ap, &alpha, t4); TOCK(t3); // 2*nnz+2*nrow ops
+#endif
+      alpha = rtrans/alpha;
+      oldrtrans = rtrans;
+      TICK(); fused_xr_update(nrow, alpha, p, Ap, x, r, &rtrans, t4); TOCK(t2);// 6*nrow ops
+      normr = sqrt(rtrans);
+      niters = k;
+    }
+
+  // Store times
+  times[1] = t1; // ddot time
+  times[2] = t2; // waxpby time
+  times[3] = t3; // sparsemv time
+  times[4] = t4; // AllReduce time
+#ifdef USING_MPI
+  times[5] = t5; // exchange boundary time
+#endif
+  delete [] p;
+  delete [] Ap;
+  delete [] r;
+  times[0] = mytimer() - t_begin;  // Total time. All done...
+  return(0);
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Pipelined CG (Chronopoulos-Gear recurrences in the Ghysels-Vanroose
+// pipelined form).  r'*r and (Ar)'*r are reduced together with a single
+// MPI_Iallreduce that is in flight while exchange_externals and sparsemv
+// compute q = Aw.  The recursively updated residual can drift from
+// b - Ax by rounding, so the attainable accuracy is lower than CG_STANDARD.
+/////////////////////////////////////////////////////////////////////////
+
+static int HPCCG_pipelined(HPC_Sparse_Matrix * A,
+	  const double * const b, double * const x,
+	  const int max_iter, const double tolerance, int &niters, double & normr,
+	  double * times, const bool overlap_exchange)
+
+{
+  double t_begin = mytimer();  // Start timing right away
+
+  double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0;
+#ifdef USING_MPI
+  double t5 = 0.0;
+#endif
+  int nrow = A->local_nrow;
+  int ncol = A->local_ncol;
+
+  double * r = new double [ncol]; // r and w are sparsemv inputs
+  double * w = new double [ncol];
+  double * p = new double [ncol];
+  double * q = new double [nrow];
+  double * s = new double [nrow];
+  double * z = new double [nrow];
+  first_touch(r, ncol); // Place pages with the threads that use them
+  first_touch(w, ncol);
+  first_touch(p, ncol);
+  first_touch(q, nrow);
+  first_touch(s, nrow);
+  first_touch(z, nrow);
+
+  normr = 0.0;
+  double gamma = 0.0, oldgamma = 0.0;
+  double delta = 0.0;
+  double alpha = 0.0, oldalpha = 0.0;
+  double local_dots[2], dots[2];
+
+#ifdef USING_MPI
+  int rank; // Number of MPI processes, My process ID
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Request request;
+#else
+  int rank = 0; // Serial case (not using MPI)
+#endif
+
+  int print_freq = max_iter/10; 
+  if (print_freq>50) print_freq=50;
+  if (print_freq<1)  print_freq=1;
+
+  // r = b - Ax, w = Ar
+  TICK(); waxpby(nrow, 1.0, x, 0.0, x, p); TOCK(t2);
+#ifdef USING_MPI
+  TICK(); exchange_externals(A,p); TOCK(t5); 
+#endif
+  TICK(); HPC_sparsemv(A, p, q); TOCK(t3);
+  TICK(); waxpby(nrow, 1.0, b, -1.0, q, r); TOCK(t2);
+#ifdef USING_MPI
+  TICK(); exchange_externals(A,r); TOCK(t5); 
+#endif
+  TICK(); HPC_sparsemv_ddot(A, r, w, &dots[1], t4); TOCK(t3);
+  TICK(); ddot(nrow, r, r, &dots[0], t4); TOCK(t1);
+  normr = sqrt(dots[0]);
+
+  if (rank==0) cout << "Initial Residual = "<< normr << endl;
+
+  for (int i=0; i<nrow; i++) z[i] = s[i] = p[i] = 0.0;
+
+  for(int k=1; k<max_iter && normr > tolerance; k++ )
+    {
+      // Reduce r'*r and w'*r from the previous update (the first
+      // iteration uses the values from the setup above) and overlap the
+      // reduction with q = Aw.
+#ifdef USING_MPI
+      if (k > 1) {
+	TICK(); MPI_Iallreduce(local_dots, dots, 2, MPI_DOUBLE, MPI_SUM,
+			       MPI_COMM_WORLD, &request); TOCK(t4);
+      }
+      if (overlap_exchange)
+	{
+	  HPC_sparsemv_overlap(A, w, q, 0, t3, t5, t4); // 2*nnz ops
+	}
+      else
+	{
+	  TICK(); exchange_externals(A,w); TOCK(t5); 
+	  TICK(); HPC_sparsemv(A, w, q); TOCK(t3); // 2*nnz ops
+	}
+#else
+      if (k > 1) {
+	dots[0] = local_dots[0];
+	dots[1] = local_dots[1];
+      }
+      TICK(); HPC_sparsemv(A, w, q); TOCK(t3); // 2*nnz ops
+#endif
+#ifdef USING_MPI
+      if (k > 1) {
+	TICK(); MPI_Wait(&request, MPI_STATUS_IGNORE); TOCK(t4);
+      }
+#endif
+
+      oldgamma = gamma;
+      gamma = dots[0];
+      delta = dots[1];
+      normr = sqrt(gamma);
+      if (rank==0 && (k%print_freq == 0 || k+1 == max_iter))
+      cout << "Iteration = "<< k << "   Residual = "<< normr << endl;
+
+      double beta = 0.0;
+      oldalpha = alpha;
+      if (k == 1)
+	alpha = gamma/delta;
+      else
+	{
+	  beta = gamma/oldgamma;
+	  alpha = gamma/(delta - beta*gamma/oldalpha);
+	}
+      TICK(); pipelined_update(nrow, alpha, beta, q, z, s, p, x, r, w,
+			       local_dots); TOCK(t2); // 16*nrow ops
+      niters = k;
+    }
+
+  // Store times
+  times[1] = t1; // ddot time
+  times[2] = t2; // waxpby time
+  times[3] = t3; // sparsemv time
+  times[4] = t4; // AllReduce time
+#ifdef USING_MPI
+  times[5] = t5; // exchange boundary time
+#endif
+  delete [] r;
+  delete [] w;
+  delete [] p;
+  delete [] q;
+  delete [] s;
+  delete [] z;
+  times[0] = mytimer() - t_begin;  // Total time. All done...
+  return(0);
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Mixed precision iterative refinement.  The outer loop computes the
+// residual r = b - Ax in double (compute_refinement_residual), the inner
+// loop runs CG in float on A d = r/|r| with A->mixed_vals, and x += |r|*d
+// is applied in double.  Scaling by |r| keeps the float vectors away from
+// underflow as the residual shrinks.  Each inner solve stops after a
+// relative reduction of mixed_inner_reduction, which float can deliver,
+// and the iteration count covers all inner iterations.
+/////////////////////////////////////////////////////////////////////////
+
+static const double mixed_inner_reduction = 1.0e-5;
+
+static void scale_to_float(const int n, const double alpha,
+			   const double * const x, float * const w)
+{
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i=0; i<n; i++) w[i] = (float) (alpha*x[i]);
+}
+
+static void add_scaled_float(const int n, const double alpha,
+			     const float * const x, double * const w)
+{
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i=0; i<n; i++) w[i] += alpha*x[i];
+}
+
+static int HPCCG_mixed(HPC_Sparse_Matrix * A,
+	  const double * const b, double * const x,
+	  const int max_iter, const double tolerance, int &niters, double & normr,
+	  double * times)
+
+{
+  double t_begin = mytimer();  // Start timing right away
+
+  double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0;
+#ifdef USING_MPI
+  double t5 = 0.0;
+#endif
+  int nrow = A->local_nrow;
+  int ncol = A->local_ncol;
+
+  double * xd = new double [ncol]; // x with room for externals
+  double * Ax = new double [nrow];
+  double * r = new double [nrow];
+  float * rf = new float [nrow];
+  float * d = new float [nrow];
+  float * p = new float [ncol];
+  float * Ap = new float [nrow];
+  first_touch(xd, ncol); // Place pages with the threads that use them
+  first_touch(Ax, nrow);
+  first_touch(r, nrow);
+  first_touch(rf, nrow);
+  first_touch(d, nrow);
+  first_touch(p, ncol);
+  first_touch(Ap, nrow);
+
+  normr = 0.0;
+  double rtrans = 0.0;
+  double oldrtrans = 0.0;
+
+#ifdef USING_MPI
+  int rank; // Number of MPI processes, My process ID
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#else
+  int rank = 0; // Serial case (not using MPI)
+#endif
+
+  int print_freq = max_iter/10; 
+  if (print_freq>50) print_freq=50;
+  if (print_freq<1)  print_freq=1;
+
+  TICK(); waxpby(nrow, 1.0, x, 0.0, x, xd); TOCK(t2);
+  TICK(); compute_refinement_residual(A, b, xd, Ax, r, &normr, t4); TOCK(t3);
+
+  if (rank==0) cout << "Initial Residual = "<< normr << endl;
+
+  int k = 1;
+  while (k<max_iter && normr > tolerance)
+    {
+      // Inner solve in single precision, starting from d = 0
+      TICK(); scale_to_float(nrow, 1.0/normr, r, rf);
+      waxpby(nrow, 0.0, rf, 0.0, rf, d); TOCK(t2);
+      TICK(); ddot(nrow, rf, rf, &rtrans, t4); TOCK(t1);
+
+      for(int inner=1; k<max_iter; inner++)
+	{
+	  if (inner == 1)
+	    {
+	      TICK(); waxpby(nrow, 1.0, rf, 0.0, rf, p); TOCK(t2);
+	    }
+	  else
+	    {
+	      double beta = rtrans/oldrtrans;
+	      TICK(); waxpby (nrow, 1.0, rf, beta, p, p);  TOCK(t2);// 2*nrow ops
+	    }
+	  if (rank==0 && (k%print_freq == 0 || k+1 == max_iter))
+	    cout << "Iteration = "<< k << "   Residual = "<< normr*sqrt(rtrans) << endl;
+
+#ifdef USING_MPI
+	  TICK(); exchange_externals(A,p); TOCK(t5); 
+#endif
+	  TICK(); HPC_sparsemv(A, p, Ap); TOCK(t3); // 2*nnz ops
+	  double alpha = 0.0;
+	  TICK(); ddot(nrow, p, Ap, &alpha, t4); TOCK(t1); // 2*nrow ops
+	  alpha = rtrans/alpha;
+	  TICK(); waxpby(nrow, 1.0, d, alpha, p, d);// 2*nrow ops
+	  waxpby(nrow, 1.0, rf, -alpha, Ap, rf);  TOCK(t2);// 2*nrow ops
+	  niters = k++;
+
+	  oldrtrans = rtrans;
+	  TICK(); ddot (nrow, rf, rf, &rtrans, t4); TOCK(t1);// 2*nrow ops
+	  if (sqrt(rtrans) <= mixed_inner_reduction) break;
+	}
+
+      // Correction and true residual in double precision
+      TICK(); add_scaled_float(nrow, normr, d, xd); TOCK(t2);
+      TICK(); compute_refinement_residual(A, b, xd, Ax, r, &normr, t4); TOCK(t3);
+    }
+
+  TICK(); waxpby(nrow, 1.0, xd, 0.0, xd, x); TOCK(t2);
+
+  // Store times
+  times[1] = t1; // ddot time
+  times[2] = t2; // waxpby time
+  times[3] = t3; // sparsemv time
+  times[4] = t4; // AllReduce time
+#ifdef USING_MPI
+  times[5] = t5; // exchange boundary time
+#endif
+  delete [] xd;
+  delete [] Ax;
+  delete [] r;
+  delete [] rf;
+  delete [] d;
+  delete [] p;
+  delete [] Ap;
+  times[0] = mytimer() - t_begin;  // Total time. All done...
+  return(0);
+}
@@ -39,9 +39,26 @@
 #include <mpi.h> // If this routine is compiled with -DUSING_MPI
                  // then include mpi.h
 #endif
+#include "cg_fused_updates.hpp"
+
+// CG_STANDARD   - one kernel call (and OpenMP region) per vector operation.
+// CG_FUSED      - sparsemv fused with p'*Ap, x/r updates fused with r'*r.
+// CG_PIPELINED  - pipelined Chronopoulos-Gear recurrences: one reduction
+//                 per iteration, overlapped with exchange_externals and
+//                 sparsemv.  Needs MPI_Iallreduce (MPI-3) in MPI mode.
+// CG_MIXED      - float CG inner solves with double precision residual
+//                 correction.  Needs make_mixed_matrix(A) first.
+enum HPCCG_Variant {
+  CG_STANDARD = 0,
+  CG_FUSED = 1,
+  CG_PIPELINED = 2,
+  CG_MIXED = 3
+};
+
 int HPCCG(HPC_Sparse_Matrix * A,
 	  const double * const b, double * const x,
-	  const int max_iter, const double tolerance, int & niters, double & normr, double * times);
+	  const int max_iter, const double tolerance, int & niters, double & normr, double * times,
+	  const int cg_variant = CG_STANDARD, const bool overlap_exchange = false);
 
 // this function will compute the Conjugate Gradient...
 // A <=> Matrix
@@ -56,4 +73,6 @@ int HPCCG(HPC_Sparse_Matrix * A,
 // b is known vector
 // xnot = 0
 // niters is the number of iterations
+// cg_variant selects one of the HPCCG_Variant algorithms
+// overlap_exchange overlaps the halo exchange with interior rows (MPI only)
 #endif
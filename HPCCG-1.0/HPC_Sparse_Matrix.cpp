@@ -36,6 +36,34 @@ void destroyMatrix(HPC_Sparse_Matrix * &A)
   {
     delete [] A->ptr_to_diags;
   }
+  if(A->row_offsets)
+  {
+    delete [] A->row_offsets;
+  }
+  if(A->sell_chunk_offsets)
+  {
+    delete [] A->sell_chunk_offsets;
+  }
+  if(A->sell_chunk_width)
+  {
+    delete [] A->sell_chunk_width;
+  }
+  if(A->sell_row_perm)
+  {
+    delete [] A->sell_row_perm;
+  }
+  if(A->sell_vals)
+  {
+    delete [] A->sell_vals;
+  }
+  if(A->sell_inds)
+  {
+    delete [] A->sell_inds;
+  }
+  if(A->mixed_vals)
+  {
+    delete [] A->mixed_vals;
+  }
 
 #ifdef USING_MPI
   if(A->external_index)
@@ -66,6 +94,18 @@ void destroyMatrix(HPC_Sparse_Matrix * &A)
   {
     delete [] A->send_buffer;
   }
+  if(A->exchange_requests)
+  {
+    delete [] A->exchange_requests;
+  }
+  if(A->mixed_send_buffer)
+  {
+    delete [] A->mixed_send_buffer;
+  }
+  if(A->interior_boundary_rows)
+  {
+    delete [] A->interior_boundary_rows;
+  }
 #endif
 
   delete A;
@@ -116,6 +156,34 @@ void destroySharedMemMatrix(HPC_Sparse_Matrix * &A)
   {
     delete [] A->ptr_to_diags;
   }
+  if(A->row_offsets)
+  {
+    delete [] A->row_offsets;
+  }
+  if(A->sell_chunk_offsets)
+  {
+    delete [] A->sell_chunk_offsets;
+  }
+  if(A->sell_chunk_width)
+  {
+    delete [] A->sell_chunk_width;
+  }
+  if(A->sell_row_perm)
+  {
+    delete [] A->sell_row_perm;
+  }
+  if(A->sell_vals)
+  {
+    delete [] A->sell_vals;
+  }
+  if(A->sell_inds)
+  {
+    delete [] A->sell_inds;
+  }
+  if(A->mixed_vals)
+  {
+    delete [] A->mixed_vals;
+  }
 
 
 #ifdef USING_MPI
@@ -147,6 +215,18 @@ void destroySharedMemMatrix(HPC_Sparse_Matrix * &A)
   {
     delete [] A->send_buffer;
   }
+  if(A->exchange_requests)
+  {
+    delete [] A->exchange_requests;
+  }
+  if(A->mixed_send_buffer)
+  {
+    delete [] A->mixed_send_buffer;
+  }
+  if(A->interior_boundary_rows)
+  {
+    delete [] A->interior_boundary_rows;
+  }
 #endif
 
   MPI_Comm_free_mem(MPI_COMM_NODE,A); A=0;
@@ -29,6 +29,9 @@
 
 #ifndef HPC_SPARSE_MATRIX_H
 #define HPC_SPARSE_MATRIX_H
+#ifdef USING_MPI
+#include <mpi.h>
+#endif
 
 // These constants are upper bounds that might need to be changes for 
 // pathological matrices, e.g., those with nearly dense rows/columns.
@@ -37,6 +40,25 @@ const int max_external = 100000;
 const int max_num_messages = 500;
 const int max_num_neighbors = max_num_messages;
 
+// Storage formats understood by HPC_sparsemv.  MATRIX_FORMAT_PTR is the
+// original per-row pointer layout.  MATRIX_FORMAT_CSR walks list_of_vals and
+// list_of_inds through row_offsets, and MATRIX_FORMAT_SELL uses the
+// SELL-C-sigma arrays built by convert_matrix_format.
+// MATRIX_FORMAT_MATRIX_FREE stores no matrix at all: generate_matrix only
+// records the nx/ny/nz geometry and HPC_sparsemv applies the stencil.
+
+enum HPC_Matrix_Format {
+  MATRIX_FORMAT_PTR = 0,
+  MATRIX_FORMAT_CSR = 1,
+  MATRIX_FORMAT_SELL = 2,
+  MATRIX_FORMAT_MATRIX_FREE = 3
+};
+
+// Number of rows in a SELL-C-sigma chunk (the "C").  Eight doubles fill
+// one AVX-512 register or two AVX2 registers.
+
+const int sell_chunk_size = 8;
+
 
 struct HPC_Sparse_Matrix_STRUCT {
   char   *title;
@@ -52,6 +74,33 @@ struct HPC_Sparse_Matrix_STRUCT {
   int ** ptr_to_inds_in_row;
   double ** ptr_to_diags;
 
+  int matrix_format;
+  int * row_offsets;      // row i is [row_offsets[i],row_offsets[i+1]) in list_of_vals/inds
+
+  // SELL-C-sigma storage, only allocated for MATRIX_FORMAT_SELL.
+  // Rows are sorted by length within windows of sell_sigma rows, then
+  // packed into chunks of sell_chunk_size rows stored column by column.
+  int sell_sigma;
+  int sell_num_chunks;
+  int * sell_chunk_offsets; // start of chunk c in sell_vals/sell_inds
+  int * sell_chunk_width;   // longest row in chunk c
+  int * sell_row_perm;      // local row held by each chunk slot, -1 for padding
+  double * sell_vals;
+  int * sell_inds;
+
+  // Grid geometry, only set for MATRIX_FORMAT_MATRIX_FREE.  Local rows are
+  // numbered ix + nx*(iy + ny*iz); in MPI mode the plane below the
+  // subdomain (if any) is stored after the local rows, then the plane above.
+  int nx;
+  int ny;
+  int nz;
+  bool use_7pt_stencil;
+
+  // Single precision copy of the matrix values for cg=mixed, built by
+  // make_mixed_matrix.  Same layout as sell_vals for MATRIX_FORMAT_SELL,
+  // otherwise as list_of_vals (indexed through row_offsets).
+  float * mixed_vals;
+
 #ifdef USING_MPI
   int num_external;
   int num_send_neighbors;
@@ -63,6 +112,15 @@ struct HPC_Sparse_Matrix_STRUCT {
   int *recv_length;
   int *send_length;
   double *send_buffer;
+  MPI_Request *exchange_requests; // used by begin/finish_exchange_externals
+  float *mixed_send_buffer;        // exchange_externals of float vectors
+
+  // Rows split by make_local_matrix for overlapping the exchange with
+  // sparsemv: the first num_interior_rows entries have no external
+  // columns, the remaining local_nrow-num_interior_rows entries do.
+  int num_interior_rows;
+  int *interior_boundary_rows;
+  int sell_num_interior_chunks; // SELL chunks holding only interior rows
 #endif
 
   double *list_of_vals;   //needed for cleaning up memory
@@ -0,0 +1,80 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef HPC_BINARY_MATRIX_H
+#define HPC_BINARY_MATRIX_H
+
+// Binary CSR file format read by read_HPC_binary and written by
+// HPC_text_to_binary.  It holds the same data as the text format read by
+// read_HPC_row, laid out so each rank can mmap the file and copy its own
+// row range without parsing:
+//
+//   header     HPC_Binary_Header (all offsets in bytes from file start)
+//   row_ptr    total_nrow+1 long long, row i is [row_ptr[i],row_ptr[i+1])
+//   vals       total_nnz doubles
+//   x, b, xexact  total_nrow doubles each
+//   inds       total_nnz ints (global column indices)
+//
+// All data is in the byte order of the machine that wrote it.
+
+const char HPC_binary_magic[8] = {'H','P','C','C','G','B','I','N'};
+const long long HPC_binary_version = 1;
+
+struct HPC_Binary_Header_STRUCT {
+  char magic[8];
+  long long version;
+  long long total_nrow;
+  long long total_nnz;
+  long long row_ptr_offset;
+  long long vals_offset;
+  long long x_offset;
+  long long b_offset;
+  long long xexact_offset;
+  long long inds_offset;
+  long long file_size;
+};
+typedef struct HPC_Binary_Header_STRUCT HPC_Binary_Header;
+
+// Fill in the layout for a matrix of the given size.
+inline void HPC_binary_layout(HPC_Binary_Header &h, long long total_nrow,
+			      long long total_nnz)
+{
+  for (int i=0; i<8; i++) h.magic[i] = HPC_binary_magic[i];
+  h.version = HPC_binary_version;
+  h.total_nrow = total_nrow;
+  h.total_nnz = total_nnz;
+  h.row_ptr_offset = sizeof(HPC_Binary_Header);
+  h.vals_offset = h.row_ptr_offset + (total_nrow+1)*sizeof(long long);
+  h.x_offset = h.vals_offset + total_nnz*sizeof(double);
+  h.b_offset = h.x_offset + total_nrow*sizeof(double);
+  h.xexact_offset = h.b_offset + total_nrow*sizeof(double);
+  h.inds_offset = h.xexact_offset + total_nrow*sizeof(double);
+  h.file_size = h.inds_offset + total_nnz*sizeof(int);
+}
+#endif
@@ -36,6 +36,17 @@
 // x - known vector
 // y - On exit contains Ax.
 
+// HPC_sparsemv_ddot also returns the dot product of x and y over the
+// local rows, computed while each y[i] is still in a register.
+
+// HPC_sparsemv_overlap (MPI only) performs the exchange_externals step
+// itself: it starts the exchange, computes the interior rows while the
+// messages are in flight, then completes the exchange and computes the
+// boundary rows.  If result is non-null it also returns x'*y as above.
+
+// The float overload of HPC_sparsemv multiplies by the single precision
+// copy of A built by make_mixed_matrix (all local rows, no overlap).
+
 /////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
@@ -50,17 +61,24 @@ using std::endl;
 #include <cmath>
 #include "HPC_sparsemv.hpp"
 
-int HPC_sparsemv( HPC_Sparse_Matrix *A, 
-		 const double * const x, double * const y)
+// Each kernel is instantiated with and without the fused x.y product
+// and returns the local part of it (0.0 when with_dot is false).
+
+// Original layout: one pointer per row into list_of_vals/list_of_inds.
+template <bool with_dot>
+static double sparsemv_ptr( HPC_Sparse_Matrix *A, 
+		 const double * const x, double * const y,
+		 const int * const rows, const int nrow)
 {
 
-  const int nrow = (const int) A->local_nrow;
+  double dot = 0.0;
 
 #ifdef USING_OMP
-#pragma omp parallel for
+#pragma omp parallel for schedule(static) reduction (+:dot)
 #endif
-  for (int i=0; i< nrow; i++)
+  for (int ii=0; ii< nrow; ii++)
     {
+      const int i = rows ? rows[ii] : ii;
       double sum = 0.0;
       const double * const cur_vals = 
      (const double * const) A->ptr_to_vals_in_row[i];
@@ -73,6 +91,290 @@ int HPC_sparsemv( HPC_Sparse_Matrix *A,
       for (int j=0; j< cur_nnz; j++)
           sum += cur_vals[j]*x[cur_inds[j]];
       y[i] = sum;
+      if (with_dot) dot += x[i]*sum;
+    }
+  return dot;
+}
+
+// CSR: rows are located through row_offsets, no per-row pointer loads.
+// Also instantiated for float with vals = mixed_vals (cg=mixed).
+template <bool with_dot, class T>
+static double sparsemv_csr( HPC_Sparse_Matrix *A, const T * const vals,
+		 const T * const x, T * const y,
+		 const int * const rows, const int nrow)
+{
+
+  const int * const row_offsets = A->row_offsets;
+  const int * const inds = A->list_of_inds;
+  double dot = 0.0;
+
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static) reduction (+:dot)
+#endif
+  for (int ii=0; ii< nrow; ii++)
+    {
+      const int i = rows ? rows[ii] : ii;
+      T sum = 0.0;
+      const int stop = row_offsets[i+1];
+      for (int j=row_offsets[i]; j< stop; j++)
+          sum += vals[j]*x[inds[j]];
+      y[i] = sum;
+      if (with_dot) dot += x[i]*sum;
+    }
+  return dot;
+}
+
+// SELL-C-sigma: the inner loop runs across the sell_chunk_size rows of a
+// chunk, so it vectorizes into gathers of x (use -mavx2 or -mavx512f).
+// vals is sell_vals, or mixed_vals in float for cg=mixed.
+template <bool with_dot, class T>
+static double sparsemv_sell( HPC_Sparse_Matrix *A, const T * const vals,
+		 const T * const x, T * const y,
+		 const int first_chunk, const int stop_chunk)
+{
+
+  const int C = sell_chunk_size;
+  const int * const chunk_offsets = A->sell_chunk_offsets;
+  const int * const chunk_width = A->sell_chunk_width;
+  const int * const row_perm = A->sell_row_perm;
+  double dot = 0.0;
+
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static) reduction (+:dot)
+#endif
+  for (int c=first_chunk; c< stop_chunk; c++)
+    {
+      T sum[sell_chunk_size];
+      for (int l=0; l<C; l++) sum[l] = 0.0;
+
+      const T * const cur_vals = vals + chunk_offsets[c];
+      const int    * const cur_inds = A->sell_inds + chunk_offsets[c];
+      const int width = chunk_width[c];
+
+      for (int j=0; j< width; j++)
+	for (int l=0; l<C; l++)
+	  sum[l] += cur_vals[j*C+l]*x[cur_inds[j*C+l]];
+
+      const int * const cur_rows = row_perm + c*C;
+      for (int l=0; l<C; l++)
+	if (cur_rows[l]>=0)
+	  {
+	    y[cur_rows[l]] = sum[l];
+	    if (with_dot) dot += x[cur_rows[l]]*sum[l];
+	  }
+    }
+  return dot;
+}
+
+// Matrix-free: apply the 27-point (or 7-point) stencil with 27.0 on the
+// diagonal and -1.0 elsewhere straight from the grid geometry.
+template <bool with_dot>
+static double sparsemv_matrix_free( HPC_Sparse_Matrix *A, 
+		 const double * const x, double * const y,
+		 const int first_plane, const int stop_plane)
+{
+
+  const int nx = A->nx;
+  const int ny = A->ny;
+  const int nz = A->nz;
+  const int nxy = nx*ny;
+  const int nrow = A->local_nrow;
+  const bool use_7pt_stencil = A->use_7pt_stencil;
+
+  // Neighbouring planes owned by other ranks (see make_local_matrix)
+  const bool have_below = A->start_row > 0;
+  const bool have_above = A->stop_row < A->total_nrow-1;
+  const double * const x_below = have_below ? x + nrow : 0;
+  const double * const x_above = have_above ? x + nrow + (have_below ? nxy : 0) : 0;
+
+  // Work one grid line at a time: start from 28*x (27 on the diagonal
+  // plus the centre point subtracted below), then subtract each
+  // neighbouring line that exists.  The ix loops vectorize.
+
+  double dot = 0.0;
+
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static) reduction (+:dot)
+#endif
+  for (int iz=first_plane; iz<stop_plane; iz++)
+    {
+      const double * planes[3];
+      planes[0] = (iz>0) ? x + (iz-1)*nxy : x_below;
+      planes[1] = x + iz*nxy;
+      planes[2] = (iz<nz-1) ? x + (iz+1)*nxy : x_above;
+
+      for (int iy=0; iy<ny; iy++)
+	{
+	  const double * const xrow = x + iz*nxy + iy*nx;
+	  double * const yrow = y + iz*nxy + iy*nx;
+	  for (int ix=0; ix<nx; ix++) yrow[ix] = 28.0*xrow[ix];
+
+	  for (int sz=-1; sz<=1; sz++)
+	    {
+	      if (planes[sz+1]==0) continue;
+	      for (int sy=-1; sy<=1; sy++)
+		{
+		  if (iy+sy<0 || iy+sy>=ny) continue;
+		  const int dist = sz*sz+sy*sy;
+		  if (use_7pt_stencil && dist>1) continue;
+		  const double * const line = planes[sz+1] + (iy+sy)*nx;
+		  for (int ix=0; ix<nx; ix++) yrow[ix] -= line[ix];
+		  if (use_7pt_stencil && dist==1) continue; // no diagonal neighbours
+		  for (int ix=1; ix<nx; ix++) yrow[ix] -= line[ix-1];
+		  for (int ix=0; ix<nx-1; ix++) yrow[ix] -= line[ix+1];
+		}
+	    }
+	  if (with_dot)
+	    for (int ix=0; ix<nx; ix++) dot += xrow[ix]*yrow[ix];
+	}
+    }
+  return dot;
+}
+
+// Run the kernel for the selected format over all local rows, or only
+// the interior or boundary rows found by make_local_matrix.  Without that
+// split every row counts as interior.
+template <bool with_dot>
+static double sparsemv_dispatch( HPC_Sparse_Matrix *A, 
+		 const double * const x, double * const y, const int part)
+{
+  const int nrow = A->local_nrow;
+  int num_interior_rows = nrow;
+  const int * interior_boundary_rows = 0;
+  int sell_num_interior_chunks = A->sell_num_chunks;
+#ifdef USING_MPI
+  if (A->interior_boundary_rows)
+    {
+      num_interior_rows = A->num_interior_rows;
+      interior_boundary_rows = A->interior_boundary_rows;
+      sell_num_interior_chunks = A->sell_num_interior_chunks;
+    }
+#endif
+
+  switch (A->matrix_format)
+    {
+    case MATRIX_FORMAT_SELL:
+      if (part == SPARSEMV_INTERIOR_ROWS)
+	return sparsemv_sell<with_dot>(A, A->sell_vals, x, y, 0, sell_num_interior_chunks);
+      if (part == SPARSEMV_BOUNDARY_ROWS)
+	return sparsemv_sell<with_dot>(A, A->sell_vals, x, y, sell_num_interior_chunks, A->sell_num_chunks);
+      return sparsemv_sell<with_dot>(A, A->sell_vals, x, y, 0, A->sell_num_chunks);
+
+    case MATRIX_FORMAT_MATRIX_FREE:
+      {
+	// Only the first and last planes touch other ranks
+	const int nz = A->nz;
+	const int first = (A->start_row > 0) ? 1 : 0;
+	const int stop = (A->stop_row < A->total_nrow-1) ? nz-1 : nz;
+	if (part == SPARSEMV_INTERIOR_ROWS)
+	  return (first < stop) ? sparsemv_matrix_free<with_dot>(A, x, y, first, stop) : 0.0;
+	if (part == SPARSEMV_BOUNDARY_ROWS)
+	  {
+	    double dot = 0.0;
+	    if (first > 0)
+	      dot += sparsemv_matrix_free<with_dot>(A, x, y, 0, 1);
+	    if (stop < nz && nz-1 >= first)
+	      dot += sparsemv_matrix_free<with_dot>(A, x, y, nz-1, nz);
+	    return dot;
+	  }
+	return sparsemv_matrix_free<with_dot>(A, x, y, 0, nz);
+      }
+    }
+
+  // Row based formats
+  const int * rows = 0;
+  int num_rows = nrow;
+  if (part == SPARSEMV_INTERIOR_ROWS && interior_boundary_rows)
+    {
+      rows = interior_boundary_rows;
+      num_rows = num_interior_rows;
+    }
+  else if (part == SPARSEMV_BOUNDARY_ROWS)
+    {
+      if (!interior_boundary_rows) return 0.0;
+      rows = interior_boundary_rows + num_interior_rows;
+      num_rows = nrow - num_interior_rows;
     }
+  if (A->matrix_format == MATRIX_FORMAT_CSR)
+    return sparsemv_csr<with_dot>(A, A->list_of_vals, x, y, rows, num_rows);
+  return sparsemv_ptr<with_dot>(A, x, y, rows, num_rows);
+}
+
+int HPC_sparsemv( HPC_Sparse_Matrix *A, 
+		 const double * const x, double * const y)
+{
+  sparsemv_dispatch<false>(A, x, y, SPARSEMV_ALL_ROWS);
   return(0);
 }
+
+int HPC_sparsemv( HPC_Sparse_Matrix *A, 
+		 const float * const x, float * const y)
+{
+  if (A->matrix_format == MATRIX_FORMAT_SELL)
+    sparsemv_sell<false>(A, (const float *) A->mixed_vals, x, y, 0, A->sell_num_chunks);
+  else
+    sparsemv_csr<false>(A, (const float *) A->mixed_vals, x, y, (const int *) 0, A->local_nrow);
+  return(0);
+}
+
+int HPC_sparsemv_ddot( HPC_Sparse_Matrix *A, 
+		 const double * const x, double * const y,
+		 double * const result, double & time_allreduce)
+{
+  double local_result = sparsemv_dispatch<true>(A, x, y, SPARSEMV_ALL_ROWS);
+
+#ifdef USING_MPI
+  // Use MPI's reduce function to collect all partial sums
+  double t0 = mytimer();
+  double global_result = 0.0;
+  MPI_Allreduce(&local_result, &global_result, 1, MPI_DOUBLE, MPI_SUM, 
+                MPI_COMM_WORLD);
+  *result = global_result;
+  time_allreduce += mytimer() - t0;
+#else
+  *result = local_result;
+#endif
+
+  return(0);
+}
+
+#ifdef USING_MPI
+int HPC_sparsemv_overlap( HPC_Sparse_Matrix *A, 
+		 const double * const x, double * const y,
+		 double * const result, double & time_sparsemv,
+		 double & time_exchange, double & time_allreduce)
+{
+  double t0 = mytimer();
+  begin_exchange_externals(A, x);
+  time_exchange += mytimer() - t0;
+
+  t0 = mytimer();
+  double local_result = 0.0;
+  if (result)
+    local_result = sparsemv_dispatch<true>(A, x, y, SPARSEMV_INTERIOR_ROWS);
+  else
+    sparsemv_dispatch<false>(A, x, y, SPARSEMV_INTERIOR_ROWS);
+  time_sparsemv += mytimer() - t0;
+
+  t0 = mytimer();
+  finish_exchange_externals(A);
+  time_exchange += mytimer() - t0;
+
+  t0 = mytimer();
+  if (result)
+    local_result += sparsemv_dispatch<true>(A, x, y, SPARSEMV_BOUNDARY_ROWS);
+  else
+    sparsemv_dispatch<false>(A, x, y, SPARSEMV_BOUNDARY_ROWS);
+  time_sparsemv += mytimer() - t0;
+
+  if (result)
+    {
+      t0 = mytimer();
+      MPI_Allreduce(&local_result, result, 1, MPI_DOUBLE, MPI_SUM, 
+		    MPI_COMM_WORLD);
+      time_allreduce += mytimer() - t0;
+    }
+
+  return(0);
+}
+#endif
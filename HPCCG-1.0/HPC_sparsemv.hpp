@@ -33,8 +33,32 @@
 #ifdef USING_MPI
 #include <mpi.h> // If this routine is compiled with -DUSING_MPI
                  // then include mpi.h
+#include "mytimer.hpp"
+#include "exchange_externals.hpp"
 #endif
 
+// Row subsets for overlapping sparsemv with exchange_externals
+enum HPC_Sparsemv_Rows {
+  SPARSEMV_ALL_ROWS = 0,
+  SPARSEMV_INTERIOR_ROWS = 1,
+  SPARSEMV_BOUNDARY_ROWS = 2
+};
+
 int HPC_sparsemv( HPC_Sparse_Matrix *A, 
 		 const double * const x, double * const y);
+
+// Single precision product with A->mixed_vals (see make_mixed_matrix).
+int HPC_sparsemv( HPC_Sparse_Matrix *A, 
+		 const float * const x, float * const y);
+
+int HPC_sparsemv_ddot( HPC_Sparse_Matrix *A, 
+		 const double * const x, double * const y,
+		 double * const result, double & time_allreduce);
+
+#ifdef USING_MPI
+int HPC_sparsemv_overlap( HPC_Sparse_Matrix *A, 
+		 const double * const x, double * const y,
+		 double * const result, double & time_sparsemv,
+		 double & time_exchange, double & time_allreduce);
+#endif
 #endif
@@ -0,0 +1,162 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Converts a linear system in the text format read by read_HPC_row into
+// the binary format described in HPC_binary_matrix.hpp.
+
+// Calling sequence:
+
+// HPC_text_to_binary HPC_data_file binary_file
+
+// The text file is read once.  Each output section is written through
+// its own file handle, so memory use does not grow with the matrix.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include "HPC_binary_matrix.hpp"
+
+static FILE * open_section(const char *name, long long offset)
+{
+  FILE *f = fopen(name, "r+b");
+  if (f == NULL || fseeko(f, offset, SEEK_SET) != 0)
+    {
+      printf("Error: Cannot write file: %s\n",name);
+      exit(1);
+    }
+  return f;
+}
+
+static void read_error(const char *name)
+{
+  printf("Error: Unexpected end of data in %s\n",name);
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 3)
+    {
+      fprintf(stderr, "Usage: %s HPC_data_file binary_file\n", argv[0]);
+      exit(1);
+    }
+  const char *text_file = argv[1];
+  const char *binary_file = argv[2];
+
+  FILE *in_file = fopen(text_file, "r");
+  if (in_file == NULL)
+    {
+      printf("Error: Cannot open file: %s\n",text_file);
+      exit(1);
+    }
+
+  int total_nrow;
+  long long total_nnz;
+  if (fscanf(in_file,"%d",&total_nrow) != 1 ||
+      fscanf(in_file,"%lld",&total_nnz) != 1) read_error(text_file);
+
+  HPC_Binary_Header h;
+  HPC_binary_layout(h, total_nrow, total_nnz);
+
+  // Create the file at full size, then fill each section in order
+
+  FILE *out_file = fopen(binary_file, "wb");
+  if (out_file == NULL || fwrite(&h, sizeof(h), 1, out_file) != 1 ||
+      fseeko(out_file, h.file_size-1, SEEK_SET) != 0 ||
+      fputc(0, out_file) == EOF)
+    {
+      printf("Error: Cannot write file: %s\n",binary_file);
+      exit(1);
+    }
+  fclose(out_file);
+
+  FILE *row_ptr_file = open_section(binary_file, h.row_ptr_offset);
+  FILE *vals_file = open_section(binary_file, h.vals_offset);
+  FILE *inds_file = open_section(binary_file, h.inds_offset);
+  FILE *x_file = open_section(binary_file, h.x_offset);
+  FILE *b_file = open_section(binary_file, h.b_offset);
+  FILE *xexact_file = open_section(binary_file, h.xexact_offset);
+
+  int i, j;
+  long long nnz = 0;
+  fwrite(&nnz, sizeof(nnz), 1, row_ptr_file);
+  for (i=0; i<total_nrow; i++)
+    {
+      int cur_nnz;
+      if (fscanf(in_file, "%d",&cur_nnz) != 1) read_error(text_file);
+      nnz += cur_nnz;
+      fwrite(&nnz, sizeof(nnz), 1, row_ptr_file);
+    }
+  if (nnz != total_nnz)
+    {
+      printf("Error: Row lengths add up to %lld, header says %lld\n",
+	     nnz, total_nnz);
+      exit(1);
+    }
+
+  for (i=0; i<total_nrow; i++)
+    {
+      int cur_nnz;
+      if (fscanf(in_file, "%d",&cur_nnz) != 1) read_error(text_file);
+      for (j=0; j<cur_nnz; j++) 
+	{
+	  double v;
+	  int l;
+	  if (fscanf(in_file, "%lf %d",&v,&l) != 2) read_error(text_file);
+	  fwrite(&v, sizeof(v), 1, vals_file);
+	  fwrite(&l, sizeof(l), 1, inds_file);
+	}
+    }
+
+  for (i=0; i<total_nrow; i++) 
+    {
+      double xt, bt, xxt;
+      if (fscanf(in_file, "%lf %lf %lf",&xt, &bt, &xxt) != 3) read_error(text_file);
+      fwrite(&xt, sizeof(xt), 1, x_file);
+      fwrite(&bt, sizeof(bt), 1, b_file);
+      fwrite(&xxt, sizeof(xxt), 1, xexact_file);
+    }
+
+  fclose(in_file);
+  FILE *sections[6] = {row_ptr_file, vals_file, inds_file,
+		       x_file, b_file, xexact_file};
+  for (i=0; i<6; i++)
+    if (fclose(sections[i]) != 0)
+      {
+	printf("Error: Cannot write file: %s\n",binary_file);
+	exit(1);
+      }
+
+  printf("Wrote %d rows and %lld nonzeros to %s\n", total_nrow, total_nnz,
+	 binary_file);
+  return 0;
+}
@@ -0,0 +1,114 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Fused vector updates used by the fused and pipelined CG variants.
+// Each routine makes a single pass over its vectors, in one OpenMP
+// parallel region, instead of one waxpby/ddot call per operation.
+
+// fused_xr_update:
+//   x = x + alpha*p
+//   r = r - alpha*Ap
+//   rtrans = r'*r  (global, reduced with MPI_Allreduce)
+
+// pipelined_update (Ghysels/Vanroose pipelined CG recurrences):
+//   z = q + beta*z,  s = w + beta*s,  p = r + beta*p
+//   x = x + alpha*p, r = r - alpha*s, w = w - alpha*z
+//   local_dots[0] = r'*r, local_dots[1] = w'*r over the local rows only;
+//   the caller reduces them together with one (non-blocking) reduction.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include "cg_fused_updates.hpp"
+
+int fused_xr_update (const int n, const double alpha,
+		     const double * const p, const double * const Ap,
+		     double * const x, double * const r,
+		     double * const rtrans, double & time_allreduce)
+{
+  double local_result = 0.0;
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static) reduction (+:local_result)
+#endif
+  for (int i=0; i<n; i++)
+    {
+      x[i] += alpha * p[i];
+      double ri = r[i] - alpha * Ap[i];
+      r[i] = ri;
+      local_result += ri*ri;
+    }
+
+#ifdef USING_MPI
+  // Use MPI's reduce function to collect all partial sums
+  double t0 = mytimer();
+  double global_result = 0.0;
+  MPI_Allreduce(&local_result, &global_result, 1, MPI_DOUBLE, MPI_SUM, 
+                MPI_COMM_WORLD);
+  *rtrans = global_result;
+  time_allreduce += mytimer() - t0;
+#else
+  *rtrans = local_result;
+#endif
+
+  return(0);
+}
+
+int pipelined_update (const int n, const double alpha, const double beta,
+		      const double * const q, double * const z,
+		      double * const s, double * const p,
+		      double * const x, double * const r, double * const w,
+		      double * const local_dots)
+{
+  double rr = 0.0;
+  double wr = 0.0;
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static) reduction (+:rr,wr)
+#endif
+  for (int i=0; i<n; i++)
+    {
+      double zi = q[i] + beta * z[i];
+      double si = w[i] + beta * s[i];
+      double pi = r[i] + beta * p[i];
+      z[i] = zi;
+      s[i] = si;
+      p[i] = pi;
+      x[i] += alpha * pi;
+      double ri = r[i] - alpha * si;
+      double wi = w[i] - alpha * zi;
+      r[i] = ri;
+      w[i] = wi;
+      rr += ri*ri;
+      wr += wi*ri;
+    }
+  local_dots[0] = rr;
+  local_dots[1] = wr;
+
+  return(0);
+}
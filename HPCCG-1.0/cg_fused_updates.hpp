@@ -0,0 +1,47 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef CG_FUSED_UPDATES_H
+#define CG_FUSED_UPDATES_H
+#ifdef USING_MPI
+#include <mpi.h>
+#include "mytimer.hpp"
+#endif
+
+int fused_xr_update (const int n, const double alpha,
+		     const double * const p, const double * const Ap,
+		     double * const x, double * const r,
+		     double * const rtrans, double & time_allreduce);
+
+int pipelined_update (const int n, const double alpha, const double beta,
+		      const double * const q, double * const z,
+		      double * const s, double * const p,
+		      double * const x, double * const r, double * const w,
+		      double * const local_dots);
+#endif
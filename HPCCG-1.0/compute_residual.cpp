@@ -37,11 +37,22 @@
 
 // residual - pointer to scalar value, on exit will contain result.
 
+// compute_refinement_residual computes the double precision residual
+// r = b - A*x and its 2-norm normr, which drive the outer correction loop
+// of cg=mixed.  x must have room for the external values (local_ncol),
+// Ax is a work vector of local_nrow entries.
+
 /////////////////////////////////////////////////////////////////////////
 
 #include <cmath>  // needed for fabs
 using std::fabs;
 #include "compute_residual.hpp"
+#include "HPC_sparsemv.hpp"
+#include "waxpby.hpp"
+#include "ddot.hpp"
+#ifdef USING_MPI
+#include "exchange_externals.hpp"
+#endif
 
 int compute_residual(const int n, const double * const v1, 
 		     const double * const v2, double * const residual)
@@ -66,3 +77,22 @@ int compute_residual(const int n, const double * const v1,
 
   return(0);
 }
+
+int compute_refinement_residual(HPC_Sparse_Matrix * A, const double * const b,
+				double * const x, double * const Ax,
+				double * const r, double * const normr,
+				double & time_allreduce)
+{
+  const int nrow = A->local_nrow;
+  double rtrans = 0.0;
+
+#ifdef USING_MPI
+  exchange_externals(A, x);
+#endif
+  HPC_sparsemv(A, x, Ax);
+  waxpby(nrow, 1.0, b, -1.0, Ax, r);
+  ddot(nrow, r, r, &rtrans, time_allreduce);
+  *normr = sqrt(rtrans);
+
+  return(0);
+}
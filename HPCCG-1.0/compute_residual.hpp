@@ -33,7 +33,13 @@
 #include <mpi.h> // If this routine is compiled with -DUSING_MPI
                  // then include mpi.h
 #endif
+#include "HPC_Sparse_Matrix.hpp"
 
 int compute_residual(const int n, const double * const v1, 
 		     const double * const v2, double * const residual);
+
+int compute_refinement_residual(HPC_Sparse_Matrix * A, const double * const b,
+				double * const x, double * const Ax,
+				double * const r, double * const normr,
+				double & time_allreduce);
 #endif
@@ -0,0 +1,203 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to select the storage format used by HPC_sparsemv.
+
+// A - known matrix, with local column indices (i.e. after
+//     make_local_matrix in MPI mode).
+
+// matrix_format - One of the HPC_Matrix_Format values.
+//   MATRIX_FORMAT_PTR and MATRIX_FORMAT_CSR share the arrays built by
+//   generate_matrix/read_HPC_row.  MATRIX_FORMAT_SELL builds a
+//   SELL-C-sigma copy of the matrix.  MATRIX_FORMAT_MATRIX_FREE is only
+//   accepted if generate_matrix already built A that way.
+
+// sell_sigma - Sorting window (in rows) for SELL-C-sigma.  Rounded up to
+//              a multiple of sell_chunk_size.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#include <algorithm>
+#include "convert_matrix_format.hpp"
+
+// Orders rows by decreasing length, used to sort within a sigma window.
+struct longer_row {
+  const int * nnz_in_row;
+  longer_row(const int * nnz) : nnz_in_row(nnz) {}
+  bool operator()(int i, int j) const { return nnz_in_row[i] > nnz_in_row[j]; }
+};
+
+int convert_matrix_format(HPC_Sparse_Matrix *A, int matrix_format, int sell_sigma)
+{
+  // A matrix-free operator has nothing to convert from, and a stored
+  // matrix is not known to be a stencil.  Both must come from generate_matrix.
+  if ((A->matrix_format == MATRIX_FORMAT_MATRIX_FREE) !=
+      (matrix_format == MATRIX_FORMAT_MATRIX_FREE))
+    {
+      cerr << "convert_matrix_format: matrix-free operators must be built by generate_matrix" << endl;
+      return(1);
+    }
+  A->matrix_format = matrix_format;
+  if (matrix_format == MATRIX_FORMAT_MATRIX_FREE) return(0);
+  if (matrix_format == MATRIX_FORMAT_PTR) return(0);
+
+  if (A->row_offsets == 0 || A->list_of_vals == 0)
+    {
+      cerr << "convert_matrix_format: matrix has no contiguous row storage" << endl;
+      return(1);
+    }
+  if (matrix_format == MATRIX_FORMAT_CSR) return(0);
+  if (matrix_format != MATRIX_FORMAT_SELL)
+    {
+      cerr << "convert_matrix_format: unknown format " << matrix_format << endl;
+      return(1);
+    }
+
+  const int C = sell_chunk_size;
+  const int nrow = A->local_nrow;
+  const int * const nnz_in_row = A->nnz_in_row;
+  const int * const row_offsets = A->row_offsets;
+
+  if (sell_sigma < C) sell_sigma = C;
+  sell_sigma = ((sell_sigma + C - 1)/C)*C;
+
+  // In MPI mode interior and boundary rows go to separate chunks, so
+  // sparsemv can process the interior chunks during the exchange.
+
+  const int * group_rows = 0;
+  int num_interior_rows = nrow;
+#ifdef USING_MPI
+  if (A->interior_boundary_rows)
+    {
+      group_rows = A->interior_boundary_rows;
+      num_interior_rows = A->num_interior_rows;
+    }
+#endif
+  int num_interior_chunks = (num_interior_rows + C - 1)/C;
+  int num_chunks = num_interior_chunks + (nrow - num_interior_rows + C - 1)/C;
+
+  // Sort rows by length inside each window of sigma rows
+
+  int * row_perm = new int[num_chunks*C];
+  for (int i=0; i<num_chunks*C; i++) row_perm[i] = -1;
+  for (int group=0; group<2; group++)
+    {
+      int first = (group==0) ? 0 : num_interior_rows;
+      int stop = (group==0) ? num_interior_rows : nrow;
+      int * perm = row_perm + ((group==0) ? 0 : num_interior_chunks*C);
+      for (int i=first; i<stop; i++)
+	perm[i-first] = group_rows ? group_rows[i] : i;
+      for (int start=0; start<stop-first; start+=sell_sigma)
+	{
+	  int window_stop = std::min(start+sell_sigma, stop-first);
+	  std::stable_sort(perm+start, perm+window_stop, longer_row(nnz_in_row));
+	}
+    }
+
+  // Chunk widths and offsets
+
+  int * chunk_width = new int[num_chunks];
+  int * chunk_offsets = new int[num_chunks+1];
+  chunk_offsets[0] = 0;
+  for (int c=0; c<num_chunks; c++)
+    {
+      int width = 0;
+      for (int l=0; l<C; l++)
+	{
+	  int row = row_perm[c*C+l];
+	  if (row>=0 && nnz_in_row[row]>width) width = nnz_in_row[row];
+	}
+      chunk_width[c] = width;
+      chunk_offsets[c+1] = chunk_offsets[c] + width*C;
+    }
+
+  // Fill chunks column by column.  Padding entries multiply x[0] by zero
+  // so the kernel never needs to test for them.
+
+  int sell_nnz = chunk_offsets[num_chunks];
+  double * sell_vals = new double[sell_nnz];
+  int * sell_inds = new int[sell_nnz];
+
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int c=0; c<num_chunks; c++)
+    {
+      double * cur_vals = sell_vals + chunk_offsets[c];
+      int * cur_inds = sell_inds + chunk_offsets[c];
+      for (int l=0; l<C; l++)
+	{
+	  int row = row_perm[c*C+l];
+	  int cur_nnz = (row>=0) ? nnz_in_row[row] : 0;
+	  for (int j=0; j<chunk_width[c]; j++)
+	    {
+	      if (j<cur_nnz)
+		{
+		  cur_vals[j*C+l] = A->list_of_vals[row_offsets[row]+j];
+		  cur_inds[j*C+l] = A->list_of_inds[row_offsets[row]+j];
+		}
+	      else
+		{
+		  cur_vals[j*C+l] = 0.0;
+		  cur_inds[j*C+l] = 0;
+		}
+	    }
+	}
+    }
+
+  A->sell_sigma = sell_sigma;
+  A->sell_num_chunks = num_chunks;
+#ifdef USING_MPI
+  A->sell_num_interior_chunks = num_interior_chunks;
+#endif
+  A->sell_chunk_offsets = chunk_offsets;
+  A->sell_chunk_width = chunk_width;
+  A->sell_row_perm = row_perm;
+  A->sell_vals = sell_vals;
+  A->sell_inds = sell_inds;
+
+  return(0);
+}
+
+const char * matrix_format_name(int matrix_format)
+{
+  switch (matrix_format)
+    {
+    case MATRIX_FORMAT_PTR:  return "ptr";
+    case MATRIX_FORMAT_CSR:  return "csr";
+    case MATRIX_FORMAT_SELL: return "sell";
+    case MATRIX_FORMAT_MATRIX_FREE: return "matrixfree";
+    }
+  return "unknown";
+}
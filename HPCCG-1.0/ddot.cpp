@@ -40,18 +40,20 @@
 /////////////////////////////////////////////////////////////////////////
 
 #include "ddot.hpp"
-int ddot (const int n, const double * const x, const double * const y, 
+// The float overload (cg=mixed) still accumulates in double.
+template <class T>
+static int ddot_impl (const int n, const T * const x, const T * const y, 
 	  double * const result, double & time_allreduce)
 {  
   double local_result = 0.0;
   if (y==x)
 #ifdef USING_OMP
-#pragma omp parallel for reduction (+:local_result)
+#pragma omp parallel for schedule(static) reduction (+:local_result)
 #endif
     for (int i=0; i<n; i++) local_result += x[i]*x[i];
   else
 #ifdef USING_OMP
-#pragma omp parallel for reduction (+:local_result)
+#pragma omp parallel for schedule(static) reduction (+:local_result)
 #endif
     for (int i=0; i<n; i++) local_result += x[i]*y[i];
 
@@ -69,3 +71,15 @@ int ddot (const int n, const double * const x, const double * const y,
 
   return(0);
 }
+
+int ddot (const int n, const double * const x, const double * const y, 
+	  double * const result, double & time_allreduce)
+{
+  return ddot_impl(n, x, y, result, time_allreduce);
+}
+
+int ddot (const int n, const float * const x, const float * const y, 
+	  double * const result, double & time_allreduce)
+{
+  return ddot_impl(n, x, y, result, time_allreduce);
+}
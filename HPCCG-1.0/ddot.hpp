@@ -37,4 +37,6 @@
 
 int ddot (const int n, const double * const x, const double * const y, 
 	  double * const result, double & time_allreduce);
+int ddot (const int n, const float * const x, const float * const y, 
+	  double * const result, double & time_allreduce);
 #endif
@@ -35,7 +35,11 @@ using std::endl;
 #include <cstdio>
 #include "exchange_externals.hpp"
 #undef DEBUG
-void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
+// Blocking exchange for double (cg=standard etc.) and float (cg=mixed)
+// vectors; only the buffer and MPI datatype differ.
+template <class T>
+static void exchange_externals_impl(HPC_Sparse_Matrix * A, const T *x,
+				    T * send_buffer, MPI_Datatype mpi_type)
 {
   int i, j, k;
   int num_external = 0;
@@ -47,7 +51,6 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
   int * recv_length = A->recv_length;
   int * send_length = A->send_length;
   int * neighbors = A->neighbors;
-  double * send_buffer = A->send_buffer;
   int total_to_be_sent = A->total_to_be_sent;
   int * elements_to_send = A->elements_to_send;
   
@@ -68,13 +71,13 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
   //
   // Externals are at end of locals
   //
-  double *x_external = (double *) x + local_nrow;
+  T *x_external = (T *) x + local_nrow;
 
   // Post receives first 
   for (i = 0; i < num_neighbors; i++) 
     {
       int n_recv = recv_length[i];
-      MPI_Irecv(x_external, n_recv, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, 
+      MPI_Irecv(x_external, n_recv, mpi_type, neighbors[i], MPI_MY_TAG, 
 		MPI_COMM_WORLD, request+i);
       x_external += n_recv;
     }
@@ -93,7 +96,7 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
   for (i = 0; i < num_neighbors; i++) 
     {
       int n_send = send_length[i];
-      MPI_Send(send_buffer, n_send, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, 
+      MPI_Send(send_buffer, n_send, mpi_type, neighbors[i], MPI_MY_TAG, 
 	       MPI_COMM_WORLD);
       send_buffer += n_send;
     }
@@ -116,4 +119,79 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
 
   return;
 }
+
+void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
+{
+  exchange_externals_impl(A, x, A->send_buffer, MPI_DOUBLE);
+}
+
+void exchange_externals(HPC_Sparse_Matrix * A, const float *x)
+{
+  exchange_externals_impl(A, x, A->mixed_send_buffer, MPI_FLOAT);
+}
+
+void begin_exchange_externals(HPC_Sparse_Matrix * A, const double *x)
+{
+  int i;
+
+  // Extract Matrix pieces
+
+  int local_nrow = A->local_nrow;
+  int num_neighbors = A->num_send_neighbors;
+  int * recv_length = A->recv_length;
+  int * send_length = A->send_length;
+  int * neighbors = A->neighbors;
+  double * send_buffer = A->send_buffer;
+  int total_to_be_sent = A->total_to_be_sent;
+  int * elements_to_send = A->elements_to_send;
+  MPI_Request * request = A->exchange_requests;
+
+  int MPI_MY_TAG = 99;  
+
+  //
+  // Externals are at end of locals
+  //
+  double *x_external = (double *) x + local_nrow;
+
+  // Post receives first 
+  for (i = 0; i < num_neighbors; i++) 
+    {
+      int n_recv = recv_length[i];
+      MPI_Irecv(x_external, n_recv, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, 
+		MPI_COMM_WORLD, request+i);
+      x_external += n_recv;
+    }
+
+  //
+  // Fill up send buffer
+  //
+
+  for (i=0; i<total_to_be_sent; i++) send_buffer[i] = x[elements_to_send[i]];
+
+  //
+  // Send to each neighbor without waiting for delivery
+  //
+
+  for (i = 0; i < num_neighbors; i++) 
+    {
+      int n_send = send_length[i];
+      MPI_Isend(send_buffer, n_send, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, 
+		MPI_COMM_WORLD, request+num_neighbors+i);
+      send_buffer += n_send;
+    }
+
+  return;
+}
+
+void finish_exchange_externals(HPC_Sparse_Matrix * A)
+{
+  if ( MPI_Waitall(2*A->num_send_neighbors, A->exchange_requests,
+		   MPI_STATUSES_IGNORE) )
+    {
+      cerr << "MPI_Waitall error\n"<<endl;
+      exit(-1);
+    }
+
+  return;
+}
 #endif // USING_MPI
@@ -34,4 +34,13 @@
 #endif
 #include "HPC_Sparse_Matrix.hpp"
 void exchange_externals(HPC_Sparse_Matrix *A, const double *x);
+
+// Single precision vectors for cg=mixed; sends through A->mixed_send_buffer.
+void exchange_externals(HPC_Sparse_Matrix *A, const float *x);
+
+// Non-blocking version: begin posts all receives and sends, finish waits
+// for them.  x must not be modified in between (its external part is
+// being received and its local part has been packed into send_buffer).
+void begin_exchange_externals(HPC_Sparse_Matrix *A, const double *x);
+void finish_exchange_externals(HPC_Sparse_Matrix *A);
 #endif
@@ -0,0 +1,95 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to report where the pages of an array were placed, where:
+
+// v - start of the array (on this processor)
+
+// nbytes - length of the array in bytes
+
+// max_pages - largest number of pages to sample
+
+// pages_per_node - on exit, sampled page count for each NUMA node
+
+// max_nodes - length of pages_per_node
+
+// Returns the number of NUMA nodes seen, 0 if placement is unknown.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include "first_touch.hpp"
+
+int first_touch_placement(const void * const v, const long long nbytes,
+			  const int max_pages, int * const pages_per_node,
+			  const int max_nodes)
+{
+  for (int k=0; k<max_nodes; k++) pages_per_node[k] = 0;
+  if (v==0 || nbytes<=0 || max_pages<=0) return(0);
+
+#if defined(__linux__) && defined(SYS_move_pages)
+  // move_pages with a null node list only queries the current node of
+  // each page; calling the syscall directly avoids a libnuma dependency.
+  long long page_size = sysconf(_SC_PAGESIZE);
+  long long first_page = ((long long) v) / page_size;
+  long long last_page = ((long long) v + nbytes - 1) / page_size;
+  long long num_pages = last_page - first_page + 1;
+  int num_samples = (num_pages < max_pages) ? (int) num_pages : max_pages;
+
+  void ** pages = new void * [num_samples];
+  int * status = new int [num_samples];
+  for (int i=0; i<num_samples; i++)
+    {
+      long long page = first_page + (num_pages*i)/num_samples;
+      pages[i] = (void *) (page*page_size);
+    }
+
+  int num_nodes = 0;
+  if (syscall(SYS_move_pages, 0, (unsigned long) num_samples, pages,
+	      (const int *) 0, status, 0)==0)
+    for (int i=0; i<num_samples; i++)
+      {
+	int node = status[i];
+	if (node<0 || node>=max_nodes) continue; // Not yet touched or out of range
+	pages_per_node[node]++;
+	if (node+1>num_nodes) num_nodes = node+1;
+      }
+
+  delete [] pages;
+  delete [] status;
+  return(num_nodes);
+#else
+  return(0);
+#endif
+}
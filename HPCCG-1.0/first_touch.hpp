@@ -0,0 +1,56 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef FIRST_TOUCH_H
+#define FIRST_TOUCH_H
+
+// Zero-fill a freshly allocated array from the OpenMP threads that will
+// later compute on it.  Linux places each page on the NUMA node of the
+// thread that first writes it, so the loop uses the same schedule(static)
+// split as ddot, waxpby and HPC_sparsemv.  Without OpenMP this is a plain
+// serial zero-fill.
+
+template <class T>
+inline void first_touch(T * const v, const int n)
+{
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i=0; i<n; i++) v[i] = T();
+}
+
+// Count the pages of [v, v+nbytes) resident on each NUMA node.  At most
+// max_pages pages are sampled, evenly spaced.  On return pages_per_node[k]
+// holds the count for node k (k < max_nodes); the function returns the
+// number of nodes seen, or 0 if placement cannot be queried.
+
+int first_touch_placement(const void * const v, const long long nbytes,
+			  const int max_pages, int * const pages_per_node,
+			  const int max_nodes);
+#endif
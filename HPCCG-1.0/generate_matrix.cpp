@@ -36,6 +36,10 @@
 
 // nrow - number of rows of matrix (on this processor)
 
+// matrix_free - If true, do not store the matrix.  Only the vectors and
+//               the grid geometry are set up, and HPC_sparsemv applies
+//               the stencil directly.
+
 #include <iostream>
 using std::cout;
 using std::cerr;
@@ -44,7 +48,9 @@ using std::endl;
 #include <cstdio>
 #include <cassert>
 #include "generate_matrix.hpp"
-void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x, double **b, double **xexact)
+#include "first_touch.hpp"
+void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x, double **b, double **xexact,
+		     bool matrix_free)
 
 {
 #ifdef DEBUG
@@ -62,7 +68,7 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
   int rank = 0;
 #endif
 
-  *A = new HPC_Sparse_Matrix; // Allocate matrix struct and fill it
+  *A = new HPC_Sparse_Matrix(); // Allocate zeroed matrix struct and fill it
   (*A)->title = 0;
 
 
@@ -80,23 +86,40 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
   int stop_row = start_row+local_nrow-1;
   
 
-  // Allocate arrays that are of length local_nrow
-  (*A)->nnz_in_row = new int[local_nrow];
-  (*A)->ptr_to_vals_in_row = new double*[local_nrow];
-  (*A)->ptr_to_inds_in_row = new int   *[local_nrow];
-  (*A)->ptr_to_diags       = new double*[local_nrow];
-
   *x = new double[local_nrow];
   *b = new double[local_nrow];
   *xexact = new double[local_nrow];
-
-
-  // Allocate arrays that are of length local_nnz
-  (*A)->list_of_vals = new double[local_nnz];
-  (*A)->list_of_inds = new int   [local_nnz];
-
-  double * curvalptr = (*A)->list_of_vals;
-  int * curindptr = (*A)->list_of_inds;
+  // First touch everything in parallel before the serial fill below so
+  // each page lands on the NUMA node of the thread that will compute on it.
+  first_touch(*x, local_nrow);
+  first_touch(*b, local_nrow);
+  first_touch(*xexact, local_nrow);
+
+  double * curvalptr = 0;
+  int * curindptr = 0;
+
+  if (!matrix_free) {
+    // Allocate arrays that are of length local_nrow
+    (*A)->nnz_in_row = new int[local_nrow];
+    (*A)->ptr_to_vals_in_row = new double*[local_nrow];
+    (*A)->ptr_to_inds_in_row = new int   *[local_nrow];
+    (*A)->ptr_to_diags       = new double*[local_nrow];
+    (*A)->row_offsets        = new int[local_nrow+1];
+
+    // Allocate arrays that are of length local_nnz
+    (*A)->list_of_vals = new double[local_nnz];
+    (*A)->list_of_inds = new int   [local_nnz];
+    first_touch((*A)->nnz_in_row, local_nrow);
+    first_touch((*A)->ptr_to_vals_in_row, local_nrow);
+    first_touch((*A)->ptr_to_inds_in_row, local_nrow);
+    first_touch((*A)->ptr_to_diags, local_nrow);
+    first_touch((*A)->row_offsets, local_nrow+1);
+    first_touch((*A)->list_of_vals, local_nnz); // Row i starts near 27*i
+    first_touch((*A)->list_of_inds, local_nnz);
+
+    curvalptr = (*A)->list_of_vals;
+    curindptr = (*A)->list_of_inds;
+  }
 
   long long nnzglobal = 0;
   for (int iz=0; iz<nz; iz++) {
@@ -105,8 +128,11 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
 	int curlocalrow = iz*nx*ny+iy*nx+ix;
 	int currow = start_row+iz*nx*ny+iy*nx+ix;
 	int nnzrow = 0;
+	if (!matrix_free) {
 	(*A)->ptr_to_vals_in_row[curlocalrow] = curvalptr;
 	(*A)->ptr_to_inds_in_row[curlocalrow] = curindptr;
+	(*A)->row_offsets[curlocalrow] = curvalptr - (*A)->list_of_vals;
+	}
 	for (int sz=-1; sz<=1; sz++) {
 	  for (int sy=-1; sy<=1; sy++) {
 	    for (int sx=-1; sx<=1; sx++) {
@@ -116,6 +142,7 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
 //            is sufficient to check the z values
               if ((ix+sx>=0) && (ix+sx<nx) && (iy+sy>=0) && (iy+sy<ny) && (curcol>=0 && curcol<total_nrow)) {
                 if (!use_7pt_stencil || (sz*sz+sy*sy+sx*sx<=1)) { // This logic will skip over point that are not part of a 7-pt stencil
+                  if (!matrix_free) { // Matrix-free only needs nnzrow for the right hand side
                   if (curcol==currow) {
 		    (*A)->ptr_to_diags[curlocalrow] = curvalptr;
 		    *curvalptr++ = 27.0;
@@ -124,13 +151,14 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
 		    *curvalptr++ = -1.0;
                   }
 		  *curindptr++ = curcol;
+                  }
 		  nnzrow++;
 	        } 
               }
 	    } // end sx loop
           } // end sy loop
         } // end sz loop
-	(*A)->nnz_in_row[curlocalrow] = nnzrow;
+	if (!matrix_free) (*A)->nnz_in_row[curlocalrow] = nnzrow;
 	nnzglobal += nnzrow;
 	(*x)[curlocalrow] = 0.0;
 	(*b)[curlocalrow] = 27.0 - ((double) (nnzrow-1));
@@ -138,6 +166,7 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
       } // end ix loop
      } // end iy loop
   } // end iz loop  
+  if (!matrix_free) (*A)->row_offsets[local_nrow] = curvalptr - (*A)->list_of_vals;
   if (debug) cout << "Process "<<rank<<" of "<<size<<" has "<<local_nrow;
   
   if (debug) cout << " rows. Global rows "<< start_row
@@ -153,6 +182,11 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
   (*A)->local_nrow = local_nrow;
   (*A)->local_ncol = local_nrow;
   (*A)->local_nnz = local_nnz;
+  (*A)->matrix_format = matrix_free ? MATRIX_FORMAT_MATRIX_FREE : MATRIX_FORMAT_PTR;
+  (*A)->nx = nx;
+  (*A)->ny = ny;
+  (*A)->nz = nz;
+  (*A)->use_7pt_stencil = use_7pt_stencil;
 
   return;
 }
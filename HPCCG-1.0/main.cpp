@@ -65,6 +65,7 @@ using std::endl;
 #include <cassert>
 #include <string>
 #include <cmath>
+#include <cstring>
 #ifdef USING_MPI
 #include <mpi.h> // If this routine is compiled with -DUSING_MPI
                  // then include mpi.h
@@ -80,6 +81,9 @@ using std::endl;
 #include "compute_residual.hpp"
 #include "HPCCG.hpp"
 #include "HPC_Sparse_Matrix.hpp"
+#include "convert_matrix_format.hpp"
+#include "make_mixed_matrix.hpp"
+#include "first_touch.hpp"
 #include "dump_matlab_matrix.hpp"
 
 #include "YAML_Element.hpp"
@@ -129,22 +133,62 @@ int main(int argc, char *argv[])
 #endif
 
 
-  if(argc != 2 && argc!=4) {
+  // Trailing key=value arguments select optional algorithm variants;
+  // everything before them is the original positional usage.
+
+  int nargs = argc;
+  while (nargs>1 && strchr(argv[nargs-1], '=')) nargs--;
+
+  int matrix_format = MATRIX_FORMAT_PTR;
+  int sell_sigma = 32*sell_chunk_size;
+  int cg_variant = CG_STANDARD;
+  bool overlap_exchange = false;
+  bool bad_option = false;
+  for (i=nargs; i<argc; i++)
+    {
+      std::string opt(argv[i]);
+      std::string key = opt.substr(0, opt.find('='));
+      std::string val = opt.substr(opt.find('=')+1);
+      if (key=="format" && val=="ptr") matrix_format = MATRIX_FORMAT_PTR;
+      else if (key=="format" && val=="csr") matrix_format = MATRIX_FORMAT_CSR;
+      else if (key=="format" && val=="sell") matrix_format = MATRIX_FORMAT_SELL;
+      else if (key=="format" && val=="matrixfree") matrix_format = MATRIX_FORMAT_MATRIX_FREE;
+      else if (key=="sigma") sell_sigma = atoi(val.c_str());
+      else if (key=="cg" && val=="standard") cg_variant = CG_STANDARD;
+      else if (key=="cg" && val=="fused") cg_variant = CG_FUSED;
+      else if (key=="cg" && val=="pipelined") cg_variant = CG_PIPELINED;
+      else if (key=="cg" && val=="mixed") cg_variant = CG_MIXED;
+      else if (key=="overlap") overlap_exchange = (atoi(val.c_str()) != 0);
+      else bad_option = true;
+    }
+
+  if (nargs==2 && matrix_format==MATRIX_FORMAT_MATRIX_FREE) bad_option = true; // needs the grid
+  if (cg_variant==CG_MIXED && matrix_format==MATRIX_FORMAT_MATRIX_FREE) bad_option = true; // needs values
+
+  if((nargs != 2 && nargs!=4) || bad_option) {
     if (rank==0)
       cerr << "Usage:" << endl
-	   << "Mode 1: " << argv[0] << " nx ny nz" << endl
+	   << "Mode 1: " << argv[0] << " nx ny nz [options]" << endl
 	   << "     where nx, ny and nz are the local sub-block dimensions, or" << endl
-	   << "Mode 2: " << argv[0] << " HPC_data_file " << endl
-	   << "     where HPC_data_file is a globally accessible file containing matrix data." << endl;
+	   << "Mode 2: " << argv[0] << " HPC_data_file [options]" << endl
+	   << "     where HPC_data_file is a globally accessible file containing matrix data." << endl
+	   << "Options:" << endl
+	   << "     format=ptr|csr|sell  sparse matrix storage used by HPC_sparsemv (default ptr)" << endl
+	   << "     format=matrixfree    apply the stencil without storing the matrix (Mode 1 only)" << endl
+	   << "     sigma=n              SELL-C-sigma sorting window in rows (default " << sell_sigma << ")" << endl
+	   << "     cg=standard|fused|pipelined  CG iteration variant (default standard)" << endl
+	   << "     cg=mixed             float inner CG with double residual correction (not matrixfree)" << endl
+	   << "     overlap=0|1          overlap the boundary exchange with interior rows (MPI, default 0)" << endl;
     exit(1);
   }
 
-  if (argc==4) 
+  if (nargs==4) 
   {
     nx = atoi(argv[1]);
     ny = atoi(argv[2]);
     nz = atoi(argv[3]);
-    generate_matrix(nx, ny, nz, &A, &x, &b, &xexact);
+    generate_matrix(nx, ny, nz, &A, &x, &b, &xexact,
+		    matrix_format==MATRIX_FORMAT_MATRIX_FREE);
   }
   else
   {
@@ -153,7 +197,7 @@ int main(int argc, char *argv[])
 
 
   bool dump_matrix = false;
-  if (dump_matrix && size<=4) dump_matlab_matrix(A, rank);
+  if (dump_matrix && size<=4 && matrix_format!=MATRIX_FORMAT_MATRIX_FREE) dump_matlab_matrix(A, rank);
 
 #ifdef USING_MPI
 
@@ -165,12 +209,24 @@ int main(int argc, char *argv[])
 
 #endif
 
+  // Build the requested storage format (needs local indices in MPI mode).
+
+  double t7 = mytimer();
+  if (convert_matrix_format(A, matrix_format, sell_sigma))
+    {
+      cerr << "Error converting matrix to format " << matrix_format_name(matrix_format) << endl;
+      exit(1);
+    }
+  if (cg_variant==CG_MIXED) make_mixed_matrix(A);
+  t7 = mytimer() - t7;
+
   double t1 = mytimer();   // Initialize it (if needed)
   int niters = 0;
   double normr = 0.0;
   int max_iter = 150;
   double tolerance = 0.0; // Set tolerance to zero to make all runs do max_iter iterations
-  ierr = HPCCG( A, b, x, max_iter, tolerance, niters, normr, times);
+  ierr = HPCCG( A, b, x, max_iter, tolerance, niters, normr, times, cg_variant,
+		overlap_exchange);
 
 	if (ierr) cerr << "Error in call to CG: " << ierr << ".\n" << endl;
 
@@ -216,11 +272,59 @@ int main(int argc, char *argv[])
           doc.get("Parallelism")->add("OpenMP not enabled","");
 #endif
 
+      // Page placement of rank 0's arrays, sampled after the solve
+      doc.add("NUMA placement","");
+#if defined(USING_OMP) && _OPENMP >= 201307
+      const char * bind_names[] = {"false", "true", "master", "close", "spread"};
+      int bind = (int) omp_get_proc_bind();
+      doc.get("NUMA placement")->add("OpenMP proc bind",
+				     std::string((bind>=0 && bind<5) ? bind_names[bind] : "unknown"));
+#endif
+      const char * placement_names[] = {"Matrix values", "Vector x"};
+      const void * placement_arrays[2] = {0, x};
+      long long placement_bytes[2] = {0, A->local_nrow*(long long) sizeof(double)};
+      if (matrix_format==MATRIX_FORMAT_SELL) {
+	placement_arrays[0] = A->sell_vals;
+	placement_bytes[0] = A->sell_chunk_offsets[A->sell_num_chunks]*(long long) sizeof(double);
+      }
+      else if (matrix_format!=MATRIX_FORMAT_MATRIX_FREE) {
+	placement_arrays[0] = A->list_of_vals;
+	placement_bytes[0] = A->local_nnz*(long long) sizeof(double);
+      }
+      const int max_nodes = 64;
+      int pages_per_node[max_nodes];
+      for (int a=0; a<2; a++) {
+	if (placement_arrays[a]==0) continue;
+	int num_nodes = first_touch_placement(placement_arrays[a], placement_bytes[a],
+					      4096, pages_per_node, max_nodes);
+	YAML_Element * placement = doc.get("NUMA placement")->add(placement_names[a],"");
+	if (num_nodes==0) placement->add("Not available","");
+	for (int k=0; k<num_nodes; k++) {
+	  char node_key[32];
+	  sprintf(node_key, "Node %d pages", k);
+	  placement->add(node_key, pages_per_node[k]);
+	}
+      }
+
       doc.add("Dimensions","");
 	  doc.get("Dimensions")->add("nx",nx);
 	  doc.get("Dimensions")->add("ny",ny);
 	  doc.get("Dimensions")->add("nz",nz);
 
+      doc.add("Matrix format","");
+	  doc.get("Matrix format")->add("Storage",matrix_format_name(matrix_format));
+	  if (matrix_format==MATRIX_FORMAT_SELL) {
+	    doc.get("Matrix format")->add("SELL chunk size",sell_chunk_size);
+	    doc.get("Matrix format")->add("SELL sigma",A->sell_sigma);
+	  }
+	  doc.get("Matrix format")->add("Conversion time",t7);
+
+      const char * cg_names[] = {"standard", "fused", "pipelined", "mixed"};
+      doc.add("CG variant",cg_names[cg_variant]);
+#ifdef USING_MPI
+      doc.add("Overlapped boundary exchange",overlap_exchange ? 1 : 0);
+#endif
+
 
 
       doc.add("Number of iterations: ", niters);
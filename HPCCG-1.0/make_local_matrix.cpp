@@ -42,8 +42,70 @@ using std::endl;
 #include "make_local_matrix.hpp"
 #include "mytimer.hpp"
 //#define DEBUG
+
+// Matrix-free operators have no column indices to scan.  The chimney stack
+// decomposition means each rank only needs the last plane of rank-1 and
+// the first plane of rank+1, so the exchange lists are built directly.
+static void make_local_matrix_free(HPC_Sparse_Matrix * A)
+{
+  int size, rank; // Number of MPI processes, My process ID
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  const int local_nrow = A->local_nrow;
+  const int nxy = A->nx*A->ny;
+  const bool have_below = A->start_row > 0;
+  const bool have_above = A->stop_row < A->total_nrow-1;
+
+  int num_neighbors = 0;
+  int * neighbors = new int[max_num_neighbors];
+  int * recv_length = new int[max_num_neighbors];
+  int * send_length = new int[max_num_neighbors];
+  int total_to_be_sent = ((have_below ? 1 : 0) + (have_above ? 1 : 0))*nxy;
+  int * elements_to_send = new int[total_to_be_sent];
+
+  // Receive order must match the ghost layout used by HPC_sparsemv:
+  // plane below first, then plane above.
+  int * cur_send = elements_to_send;
+  if (have_below)
+    {
+      neighbors[num_neighbors] = rank-1;
+      recv_length[num_neighbors] = nxy;
+      send_length[num_neighbors] = nxy;
+      num_neighbors++;
+      for (int i=0; i<nxy; i++) *cur_send++ = i;
+    }
+  if (have_above)
+    {
+      neighbors[num_neighbors] = rank+1;
+      recv_length[num_neighbors] = nxy;
+      send_length[num_neighbors] = nxy;
+      num_neighbors++;
+      for (int i=0; i<nxy; i++) *cur_send++ = local_nrow - nxy + i;
+    }
+
+  A->num_external = total_to_be_sent;
+  A->external_index = 0;
+  A->external_local_index = 0;
+  A->num_send_neighbors = num_neighbors;
+  A->neighbors = neighbors;
+  A->recv_length = recv_length;
+  A->send_length = send_length;
+  A->total_to_be_sent = total_to_be_sent;
+  A->elements_to_send = elements_to_send;
+  A->send_buffer = new double[total_to_be_sent];
+  A->exchange_requests = new MPI_Request[2*max_num_neighbors];
+  A->local_ncol = local_nrow + A->num_external;
+}
+
 void make_local_matrix(HPC_Sparse_Matrix * A)
 {
+  if (A->matrix_format == MATRIX_FORMAT_MATRIX_FREE)
+    {
+      make_local_matrix_free(A);
+      return;
+    }
+
   std::map< int, int > externals;
   int i, j, k;
   int num_external = 0;
@@ -584,6 +646,37 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   //Used in exchange_externals
   double *send_buffer = new double[total_to_be_sent];
   A->send_buffer = send_buffer;
+  A->exchange_requests = new MPI_Request[2*max_num_neighbors];
+
+  // Split rows into interior rows (all columns local) and boundary rows
+  // (at least one external column) so sparsemv can overlap the exchange.
+
+  bool * is_boundary = new bool[local_nrow];
+  int num_interior_rows = 0;
+  for (i=0; i< local_nrow; i++)
+    {
+      is_boundary[i] = false;
+      for (j=0; j<nnz_in_row[i]; j++)
+	if (ptr_to_inds_in_row[i][j] >= local_nrow) is_boundary[i] = true;
+      if (!is_boundary[i]) num_interior_rows++;
+    }
+  int * interior_boundary_rows = new int[local_nrow];
+  int num_boundary_rows = 0;
+  int next_interior = 0;
+  for (i=0; i< local_nrow; i++)
+    {
+      if (is_boundary[i])
+	interior_boundary_rows[num_interior_rows + num_boundary_rows++] = i;
+      else
+	interior_boundary_rows[next_interior++] = i;
+    }
+  delete [] is_boundary;
+  A->num_interior_rows = num_interior_rows;
+  A->interior_boundary_rows = interior_boundary_rows;
+
+  if (debug) cout << "Processor " << rank << " of " << size <<
+	       ": Number of interior rows = " << num_interior_rows <<
+	       ", boundary rows = " << num_boundary_rows << endl;
 
   delete [] tmp_buffer;
   delete [] global_index_offsets;
@@ -0,0 +1,71 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to build the single precision copy of a matrix used by the
+// inner iterations of cg=mixed, where:
+
+// A - known matrix, already converted to its final storage format
+//     (and made local in MPI mode).  On exit A->mixed_vals holds the
+//     values rounded to float in the layout of sell_vals (SELL) or
+//     list_of_vals (PTR, CSR); the indices are shared with A.
+
+// Returns 1 for MATRIX_FORMAT_MATRIX_FREE, which has no values to copy.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include "make_mixed_matrix.hpp"
+
+int make_mixed_matrix(HPC_Sparse_Matrix * A)
+{
+  if (A->matrix_format==MATRIX_FORMAT_MATRIX_FREE) return(1);
+
+  const double * vals = A->list_of_vals;
+  int nvals = A->row_offsets[A->local_nrow];
+  if (A->matrix_format==MATRIX_FORMAT_SELL)
+    {
+      vals = A->sell_vals;
+      nvals = A->sell_chunk_offsets[A->sell_num_chunks];
+    }
+
+  // Same schedule as the copy's consumers, so this is also the first touch
+  float * mixed_vals = new float[nvals];
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i=0; i<nvals; i++) mixed_vals[i] = (float) vals[i];
+  A->mixed_vals = mixed_vals;
+
+#ifdef USING_MPI
+  A->mixed_send_buffer = new float[A->total_to_be_sent];
+#endif
+
+  return(0);
+}
@@ -0,0 +1,220 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//  
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//  
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to read a sparse matrix, right hand side, initial guess, 
+// and exact solution from the binary format described in
+// HPC_binary_matrix.hpp.  Each processor maps the file and copies only
+// its own rows, using the same row partition as read_HPC_row.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cout;
+using std::cerr;
+using std::endl;
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "HPC_binary_matrix.hpp"
+#include "read_HPC_binary.hpp"
+
+bool is_HPC_binary_file(const char *data_file)
+{
+  char magic[8];
+  FILE *in_file = fopen(data_file, "rb");
+  if (in_file == NULL) return false;
+  bool is_binary = (fread(magic, 1, 8, in_file) == 8 &&
+		    memcmp(magic, HPC_binary_magic, 8) == 0);
+  fclose(in_file);
+  return is_binary;
+}
+
+void read_HPC_binary(const char *data_file, HPC_Sparse_Matrix **A,
+		     double **x, double **b, double **xexact)
+{
+  int i;
+#ifdef DEBUG
+  int debug = 1;
+#else
+  int debug = 0;
+#endif
+
+#ifdef USING_MPI
+  int size, rank; // Number of MPI processes, My process ID
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#else
+  int size = 1; // Serial case (not using MPI)
+  int rank = 0;
+#endif
+
+  if (rank==0) printf("Mapping binary matrix from %s...\n",data_file);
+
+  int fd = open(data_file, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+    {
+      printf("Error: Cannot open file: %s\n",data_file);
+      exit(1);
+    }
+
+  HPC_Binary_Header h;
+  if (pread(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) ||
+      memcmp(h.magic, HPC_binary_magic, 8) != 0 ||
+      h.version != HPC_binary_version)
+    {
+      printf("Error: %s is not an HPCCG binary matrix file\n",data_file);
+      exit(1);
+    }
+
+  HPC_Binary_Header expected;
+  HPC_binary_layout(expected, h.total_nrow, h.total_nnz);
+  if (memcmp(&h, &expected, sizeof(h)) != 0 || st.st_size < h.file_size ||
+      h.total_nrow > INT_MAX)
+    {
+      printf("Error: Inconsistent header or truncated file: %s\n",data_file);
+      exit(1);
+    }
+
+  const char * base = (const char *) mmap(0, h.file_size, PROT_READ,
+					  MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    {
+      printf("Error: Cannot map file: %s\n",data_file);
+      exit(1);
+    }
+  close(fd); // the mapping stays valid
+
+  const long long * row_ptr = (const long long *) (base + h.row_ptr_offset);
+  const double * file_vals = (const double *) (base + h.vals_offset);
+  const int * file_inds = (const int *) (base + h.inds_offset);
+
+  int total_nrow = (int) h.total_nrow;
+  long long total_nnz = h.total_nnz;
+
+  // Same row partition as read_HPC_row
+
+  int n = total_nrow;
+  int chunksize = n/size;
+  int remainder = n%size;
+
+  int mp = chunksize;
+  if (rank<remainder) mp++;
+  int local_nrow = mp;
+  
+  int off = rank*(chunksize+1);
+  if (rank>remainder) off -= (rank - remainder);
+  int start_row = off;
+  int stop_row = off + mp -1;
+
+  long long first_nnz = row_ptr[start_row];
+  long long stop_nnz = row_ptr[start_row+local_nrow];
+  if (stop_nnz - first_nnz > INT_MAX)
+    {
+      printf("Error: Process %d has too many nonzeros (%lld)\n",rank,
+	     stop_nnz - first_nnz);
+      exit(1);
+    }
+  int local_nnz = (int) (stop_nnz - first_nnz);
+
+  // Copy this processor's slice; make_local_matrix rewrites the indices
+  // in place, so they cannot stay in the read-only mapping.
+
+  int *nnz_in_row = new int[local_nrow];
+  int *row_offsets = new int[local_nrow+1];
+  double **ptr_to_vals_in_row = new double*[local_nrow];
+  int    **ptr_to_inds_in_row = new int   *[local_nrow];
+  double **ptr_to_diags       = new double*[local_nrow];
+  double *list_of_vals = new double[local_nnz];
+  int *list_of_inds = new int   [local_nnz];
+
+  memcpy(list_of_vals, file_vals + first_nnz, local_nnz*sizeof(double));
+  memcpy(list_of_inds, file_inds + first_nnz, local_nnz*sizeof(int));
+
+  for (i=0; i<local_nrow; i++)
+    {
+      row_offsets[i] = (int) (row_ptr[start_row+i] - first_nnz);
+      nnz_in_row[i] = (int) (row_ptr[start_row+i+1] - row_ptr[start_row+i]);
+      ptr_to_vals_in_row[i] = list_of_vals + row_offsets[i];
+      ptr_to_inds_in_row[i] = list_of_inds + row_offsets[i];
+      ptr_to_diags[i] = 0;
+      for (int j=0; j<nnz_in_row[i]; j++)
+	if (ptr_to_inds_in_row[i][j] == start_row+i)
+	  ptr_to_diags[i] = ptr_to_vals_in_row[i]+j;
+    }
+  row_offsets[local_nrow] = local_nnz;
+
+  *x = new double[local_nrow];
+  *b = new double[local_nrow];
+  *xexact = new double[local_nrow];
+  memcpy(*x, (const double *) (base + h.x_offset) + start_row,
+	 local_nrow*sizeof(double));
+  memcpy(*b, (const double *) (base + h.b_offset) + start_row,
+	 local_nrow*sizeof(double));
+  memcpy(*xexact, (const double *) (base + h.xexact_offset) + start_row,
+	 local_nrow*sizeof(double));
+
+  munmap((void *) base, h.file_size);
+
+  if (debug) cout << "Process "<<rank<<" of "<<size<<" has "<<local_nrow;
+
+  if (debug) cout << " rows. Global rows "<< start_row
+		  <<" through "<< stop_row <<endl;
+
+  if (debug) cout << "Process "<<rank<<" of "<<size
+		  <<" has "<<local_nnz<<" nonzeros."<<endl;
+
+  *A = new HPC_Sparse_Matrix(); // Allocate zeroed matrix struct and fill it
+  (*A)->title = 0;
+  (*A)->start_row = start_row ; 
+  (*A)->stop_row = stop_row;
+  (*A)->total_nrow = total_nrow;
+  (*A)->total_nnz = total_nnz;
+  (*A)->local_nrow = local_nrow;
+  (*A)->local_ncol = local_nrow;
+  (*A)->local_nnz = local_nnz;
+  (*A)->nnz_in_row = nnz_in_row;
+  (*A)->ptr_to_vals_in_row = ptr_to_vals_in_row;
+  (*A)->ptr_to_inds_in_row = ptr_to_inds_in_row;
+  (*A)->ptr_to_diags = ptr_to_diags;
+  (*A)->list_of_vals = list_of_vals;
+  (*A)->list_of_inds = list_of_inds;
+  (*A)->row_offsets = row_offsets;
+  (*A)->matrix_format = MATRIX_FORMAT_PTR;
+
+  return;
+}
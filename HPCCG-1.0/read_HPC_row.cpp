@@ -44,6 +44,7 @@ using std::endl;
 #include <cstdio>
 #include <cassert>
 #include "read_HPC_row.hpp"
+#include "read_HPC_binary.hpp"
 void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
 		  double **x, double **b, double **xexact)
 
@@ -63,6 +64,13 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
   int debug = 0;
 #endif
 
+  // Files written by HPC_text_to_binary are mapped instead of parsed
+  if (is_HPC_binary_file(data_file))
+    {
+      read_HPC_binary(data_file, A, x, b, xexact);
+      return;
+    }
+
   printf("Reading matrix info from %s...\n",data_file);
   
   in_file = fopen( data_file, "r");
@@ -128,13 +136,17 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
   int *list_of_inds = new int   [local_nnz];
 
   // Define pointers into list_of_vals/inds 
+  int *row_offsets = new int[local_nrow+1];
+  row_offsets[0] = 0;
   ptr_to_vals_in_row[0] = list_of_vals;
   ptr_to_inds_in_row[0] = list_of_inds;
   for (i=1; i<local_nrow; i++)
     {
+      row_offsets[i] = row_offsets[i-1]+nnz_in_row[i-1];
       ptr_to_vals_in_row[i] = ptr_to_vals_in_row[i-1]+nnz_in_row[i-1];
       ptr_to_inds_in_row[i] = ptr_to_inds_in_row[i-1]+nnz_in_row[i-1];
     }
+  row_offsets[local_nrow] = local_nnz;
 
   cur_local_row = 0;
   for (i=0; i<total_nrow; i++)
@@ -185,7 +197,7 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
   if (debug) cout << "Process "<<rank<<" of "<<size
 		  <<" has "<<local_nnz<<" nonzeros."<<endl;
 
-  *A = new HPC_Sparse_Matrix; // Allocate matrix struct and fill it
+  *A = new HPC_Sparse_Matrix(); // Allocate zeroed matrix struct and fill it
   (*A)->title = 0;
   (*A)->start_row = start_row ; 
   (*A)->stop_row = stop_row;
@@ -198,6 +210,10 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
   (*A)->ptr_to_vals_in_row = ptr_to_vals_in_row;
   (*A)->ptr_to_inds_in_row = ptr_to_inds_in_row;
   (*A)-> ptr_to_diags = ptr_to_diags;
+  (*A)->list_of_vals = list_of_vals;
+  (*A)->list_of_inds = list_of_inds;
+  (*A)->row_offsets = row_offsets;
+  (*A)->matrix_format = MATRIX_FORMAT_PTR;
 
   return;
 }
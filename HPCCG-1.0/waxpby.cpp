@@ -46,28 +46,44 @@
 
 #include "waxpby.hpp"
 
-int waxpby (const int n, const double alpha, const double * const x, 
-	    const double beta, const double * const y, 
-		     double * const w)
+// The float overload (cg=mixed) rounds alpha and beta to float.
+template <class T>
+static int waxpby_impl (const int n, const T alpha, const T * const x, 
+	    const T beta, const T * const y, 
+		     T * const w)
 {  
   if (alpha==1.0) {
 #ifdef USING_OMP
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
 #endif
     for (int i=0; i<n; i++) w[i] = x[i] + beta * y[i];
   }
   else if(beta==1.0) {
 #ifdef USING_OMP
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
 #endif
     for (int i=0; i<n; i++) w[i] = alpha * x[i] + y[i];
   }
   else {
 #ifdef USING_OMP
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
 #endif
     for (int i=0; i<n; i++) w[i] = alpha * x[i] + beta * y[i];
   }
 
   return(0);
 }
+
+int waxpby (const int n, const double alpha, const double * const x, 
+	    const double beta, const double * const y, 
+		     double * const w)
+{
+  return waxpby_impl(n, alpha, x, beta, y, w);
+}
+
+int waxpby (const int n, const double alpha, const float * const x, 
+	    const double beta, const float * const y, 
+		     float * const w)
+{
+  return waxpby_impl(n, (float) alpha, x, (float) beta, y, w);
+}
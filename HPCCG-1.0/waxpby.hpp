@@ -30,3 +30,6 @@
 int waxpby (const int n, const double alpha, const double * const x, 
 	    const double beta, const double * const y, 
 		     double * const w);
+int waxpby (const int n, const double alpha, const float * const x, 
+	    const double beta, const float * const y, 
+		     float * const w);
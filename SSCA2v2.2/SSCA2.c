@@ -100,6 +100,20 @@ int main(int argc, char** argv)
     
     free(SDGdata);
 
+#ifdef RELABEL
+    /* ------------------------------------ */
+    /*  Vertex relabeling -- timed apart    */
+    /* ------------------------------------ */
+
+    fprintf(stderr, "\nrelabelGraph() beginning execution...\n");
+
+    elapsed_time = relabelGraph(G, &G->newId, &G->oldId);
+
+    fprintf(stderr, "\n\trelabelGraph() completed execution\n");
+    fprintf(stderr, "\nTime taken for vertex relabeling is %9.6lf sec.\n\n",
+            elapsed_time);
+#endif
+
     /* ---------------------------------------------------- */
     /*  Kernel 2 - Find max edge weight                     */
     /* ---------------------------------------------------- */
@@ -151,6 +165,10 @@ int main(int argc, char** argv)
     free(G->numEdges);
     free(G->endV);
     free(G->weight);
+    free(G->newId);
+    free(G->oldId);
+    free(G->k4EndV);
+    free(G->k4NumEdges);
     free(G);
 
     return 0;
@@ -1,20 +1,102 @@
 #include "defs.h"
 
+/* Vertices a thread discovers in a BFS phase are buffered locally and
+   appended to S this many at a time */
+#define BC_BUF_LEN 1024
+
+/* Coarse-grained Kernel 4: the calling thread's share of whole
+   traversals from Srcs[0..numSrcs-1], each run serially with private
+   d/sig/del arrays, with the dependencies added into myBC. Called by
+   every thread of the parallel region */
+static void bcSourceParallel(graph* G, LONG_T* Srcs, LONG_T numSrcs,
+        DOUBLE_T* myBC) {
+
+    VERT_T *S;
+    DOUBLE_T *sig, *del;
+    LONG_T *d;
+    LONG_T i, j, k, p, v, w, x, n, count;
+    DOUBLE_T dsum;
+
+    n = G->n;
+    S   = (VERT_T *) malloc(n*sizeof(VERT_T));
+    sig = (DOUBLE_T *) calloc(n, sizeof(DOUBLE_T));
+    del = (DOUBLE_T *) calloc(n, sizeof(DOUBLE_T));
+    d   = (LONG_T *) malloc(n*sizeof(LONG_T));
+    for (i=0; i<n; i++) {
+        d[i] = -1;
+    }
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (p=0; p<numSrcs; p++) {
+
+        i = Srcs[p];
+        if (G->numEdges[i+1] - G->numEdges[i] == 0) {
+            continue;
+        }
+
+        sig[i] = 1;
+        d[i] = 0;
+        S[0] = i;
+        count = 1;
+
+        /* S doubles as the BFS queue */
+        for (k=0; k<count; k++) {
+            v = S[k];
+            for (j=G->k4NumEdges[v]; j<G->k4NumEdges[v+1]; j++) {
+                w = G->k4EndV[j];
+                if (d[w] == -1) {
+                    d[w] = d[v] + 1;
+                    S[count++] = w;
+                }
+                if (d[w] == d[v] + 1) {
+                    sig[w] += sig[v];
+                }
+            }
+        }
+
+        /* Successors of w are later in S, so walk it backwards */
+        for (k=count-1; k>0; k--) {
+            w = S[k];
+            dsum = 0;
+            for (j=G->k4NumEdges[w]; j<G->k4NumEdges[w+1]; j++) {
+                x = G->k4EndV[j];
+                if (d[x] == d[w] + 1) {
+                    dsum += (1+del[x])/sig[x];
+                }
+            }
+            del[w] = sig[w]*dsum;
+            myBC[w] += del[w];
+        }
+
+        for (k=0; k<count; k++) {
+            w = S[k];
+            d[w] = -1;
+            sig[w] = 0;
+            del[w] = 0;
+        }
+    }
+
+    free(S);
+    free(sig);
+    free(del);
+    free(d);
+}
+
 double betweennessCentrality(graph* G, DOUBLE_T* BC) {
 
-    VERT_T *S;         /* stack of vertices in the order of non-decreasing 
+    VERT_T *S = NULL;  /* stack of vertices in the order of non-decreasing 
                           distance from s. Also used to implicitly 
                           represent the BFS queue */
-    plist* P;          /* predecessors of a vertex v on shortest paths from s */
-    DOUBLE_T* sig;     /* No. of shortest paths */
-    LONG_T* d;         /* Length of the shortest path between every pair */
-    DOUBLE_T* del;     /* dependency of vertices */
-    LONG_T *in_degree, *numEdges, *pSums;
-    LONG_T *pListMem;    
+    DOUBLE_T* sig = NULL; /* No. of shortest paths */
+    LONG_T* d = NULL;  /* Length of the shortest path between every pair */
+    DOUBLE_T* del = NULL; /* dependency of vertices */
+    DOUBLE_T** bcPart; /* per-thread BC accumulators (coarse-grained mode) */
     LONG_T* Srcs; 
-    LONG_T *start, *end;
+    LONG_T *start = NULL, *end = NULL;
     LONG_T MAX_NUM_PHASES;
-    LONG_T *psCount;
+    LONG_T sEnd;       /* no. of vertices appended to S so far */
 #ifdef _OPENMP    
     omp_lock_t* vLock;
     LONG_T chunkSize;
@@ -27,19 +109,19 @@ double betweennessCentrality(graph* G, DOUBLE_T* BC) {
 {
 #endif
 
-    VERT_T *myS, *myS_t;
-    LONG_T myS_size;
+    VERT_T *myS = NULL;
     LONG_T i, j, k, p, count, myCount;
-    LONG_T v, w, vert;
-    LONG_T numV, num_traversals, n, m, phase_num;
+    LONG_T v, w, x, vert;
+    DOUBLE_T dsum;
+    LONG_T numV, num_traversals, n, phase_num;
     LONG_T tid, nthreads;
+    int coarse;
     int* stream;
 #ifdef DIAGNOSTIC
     double elapsed_time_part;
 #endif
 
 #ifdef _OPENMP
-    int myLock;
     tid = omp_get_thread_num();
     nthreads = omp_get_num_threads();
 #else
@@ -56,7 +138,16 @@ double betweennessCentrality(graph* G, DOUBLE_T* BC) {
     /* numV: no. of vertices to run BFS from = 2^K4approx */
     numV = 1<<K4approx;
     n = G->n;
-    m = G->m;
+
+    /* Run whole traversals on each thread when there are enough
+       sources to go around and the private arrays fit */
+#if defined(K4_COARSE)
+    coarse = K4_COARSE;
+#else
+    coarse = (numV >= 4*nthreads) &&
+        ((double) nthreads*n*(sizeof(VERT_T) + sizeof(LONG_T) + 3*sizeof(DOUBLE_T))
+         <= (double) K4_COARSE_MAX_MB*1024*1024);
+#endif
 
     /* Permute vertices */
     if (tid == 0) {
@@ -81,7 +172,8 @@ double betweennessCentrality(graph* G, DOUBLE_T* BC) {
 #pragma omp for
 #endif
     for (i=0; i<n; i++) {
-        Srcs[i] = i;
+        /* Same sources as without relabeling */
+        Srcs[i] = (G->newId == NULL) ? i : G->newId[i];
     }
 
 #ifdef _OPENMP
@@ -134,79 +226,49 @@ double betweennessCentrality(graph* G, DOUBLE_T* BC) {
 #pragma omp barrier    
 #endif
 
-    /* Initialize predecessor lists */
-    
-    /* The size of the predecessor list of each vertex is bounded by 
-       its in-degree. So we first compute the in-degree of every
-       vertex */ 
-
-    if (tid == 0) {
-        P   = (plist  *) calloc(n, sizeof(plist));
-        in_degree = (LONG_T *) calloc(n+1, sizeof(LONG_T));
-        numEdges = (LONG_T *) malloc((n+1)*sizeof(LONG_T));
-        pSums = (LONG_T *) malloc(nthreads*sizeof(LONG_T));
-    }
-
+    if (coarse) {
+        /* Per-thread dependency accumulators, summed into BC below */
+        if (tid == 0) {
+            bcPart = (DOUBLE_T **) malloc(nthreads*sizeof(DOUBLE_T *));
+        }
 #ifdef _OPENMP
 #pragma omp barrier
-#pragma omp for
 #endif
-    for (i=0; i<m; i++) {
-        v = G->endV[i];
-#ifdef _OPENMP
-        omp_set_lock(&vLock[v]);
-#endif
-        in_degree[v]++;
-#ifdef _OPENMP
-        omp_unset_lock(&vLock[v]);
-#endif
-    }
-
-    prefix_sums(in_degree, numEdges, pSums, n);
-    
-    if (tid == 0) {
-        pListMem = (LONG_T *) malloc(m*sizeof(LONG_T));
-    }
+        bcPart[tid] = (DOUBLE_T *) calloc(n, sizeof(DOUBLE_T));
+        for (p=0, k=0; p<n && k<numV; p++) {
+            i = Srcs[p];
+            if (G->numEdges[i+1] - G->numEdges[i] != 0) {
+                k++;
+            }
+        }
+        bcSourceParallel(G, Srcs, p, bcPart[tid]);
 
 #ifdef _OPENMP
-#pragma omp barrier
 #pragma omp for
 #endif
-    for (i=0; i<n; i++) {
-        P[i].list = pListMem + numEdges[i];
-        P[i].degree = in_degree[i];
-        P[i].count = 0;
-    }
-
-#ifdef DIAGNOSTIC
-    if (tid == 0) {
-        elapsed_time_part = get_seconds() - elapsed_time_part;
-        fprintf(stderr, "In-degree computation time: %lf seconds\n", elapsed_time_part);
-        elapsed_time_part = get_seconds();
-    }
-#endif
+        for (i=0; i<n; i++) {
+            for (k=0; k<nthreads; k++) {
+                BC[i] += bcPart[k][i];
+            }
+        }
+        free(bcPart[tid]);
+    } else {
 
-    /* Allocate shared memory */ 
-    if (tid == 0) {
-        free(in_degree);
-        free(numEdges);
-        free(pSums);
-        
-        S   = (VERT_T *) malloc(n*sizeof(VERT_T));
-        sig = (DOUBLE_T *) malloc(n*sizeof(DOUBLE_T));
-        d   = (LONG_T *) malloc(n*sizeof(LONG_T));
-        del = (DOUBLE_T *) calloc(n, sizeof(DOUBLE_T));
+        /* Allocate shared memory */ 
+        if (tid == 0) {
+            S   = (VERT_T *) malloc(n*sizeof(VERT_T));
+            sig = (DOUBLE_T *) calloc(n, sizeof(DOUBLE_T));
+            d   = (LONG_T *) malloc(n*sizeof(LONG_T));
+            del = (DOUBLE_T *) calloc(n, sizeof(DOUBLE_T));
         
-        start = (LONG_T *) malloc(MAX_NUM_PHASES*sizeof(LONG_T));
-        end = (LONG_T *) malloc(MAX_NUM_PHASES*sizeof(LONG_T));
-        psCount = (LONG_T *) malloc((nthreads+1)*sizeof(LONG_T));
-    }
+            start = (LONG_T *) malloc(MAX_NUM_PHASES*sizeof(LONG_T));
+            end = (LONG_T *) malloc(MAX_NUM_PHASES*sizeof(LONG_T));
+        }
 
-    /* local memory for each thread */  
-    myS_size = (2*n)/nthreads;
-    myS = (LONG_T *) malloc(myS_size*sizeof(LONG_T));
-    num_traversals = 0;
-    myCount = 0;
+        /* local memory for each thread */  
+        myS = (VERT_T *) malloc(BC_BUF_LEN*sizeof(VERT_T));
+        num_traversals = 0;
+        myCount = 0;
 
 #ifdef _OPENMP    
 #pragma omp barrier
@@ -215,189 +277,163 @@ double betweennessCentrality(graph* G, DOUBLE_T* BC) {
 #ifdef _OPENMP    
 #pragma omp for
 #endif
-    for (i=0; i<n; i++) {
-        d[i] = -1;
-    }
+        for (i=0; i<n; i++) {
+            d[i] = -1;
+        }
  
 #ifdef DIAGNOSTIC
-    if (tid == 0) {
-        elapsed_time_part = get_seconds() -elapsed_time_part;
-        fprintf(stderr, "BC initialization time: %lf seconds\n", elapsed_time_part);
-        elapsed_time_part = get_seconds();
-    }
+        if (tid == 0) {
+            elapsed_time_part = get_seconds() -elapsed_time_part;
+            fprintf(stderr, "BC initialization time: %lf seconds\n", elapsed_time_part);
+            elapsed_time_part = get_seconds();
+        }
 #endif
    
-    for (p=0; p<n; p++) {
+        for (p=0; p<n; p++) {
 
-        i = Srcs[p];
-        if (G->numEdges[i+1] - G->numEdges[i] == 0) {
-            continue;
-        } else {
-            num_traversals++;
-        }
+            i = Srcs[p];
+            if (G->numEdges[i+1] - G->numEdges[i] == 0) {
+                continue;
+            } else {
+                num_traversals++;
+            }
 
-        if (num_traversals == numV + 1) {
-            break;
-        }
+            if (num_traversals == numV + 1) {
+                break;
+            }
         
-        if (tid == 0) {
-            sig[i] = 1;
-            d[i] = 0;
-            S[0] = i;
-            start[0] = 0;
-            end[0] = 1;
-        }
+            if (tid == 0) {
+                sig[i] = 1;
+                d[i] = 0;
+                S[0] = i;
+                start[0] = 0;
+                end[0] = 1;
+                sEnd = 1;
+            }
         
-        count = 1;
-        phase_num = 0;
+            phase_num = 0;
 
 #ifdef _OPENMP       
 #pragma omp barrier
 #endif
         
-        while (end[phase_num] - start[phase_num] > 0) {
+            /* No locks in the BFS: a CAS on d[w] decides which thread
+               appends w to S, and sig[w] is updated atomically by every
+               vertex of the previous level adjacent to it */
+            while (end[phase_num] - start[phase_num] > 0) {
             
-            myCount = 0;
+                myCount = 0;
 #ifdef _OPENMP
-#pragma omp barrier
-#pragma omp for schedule(dynamic)
+#pragma omp for schedule(dynamic) nowait
+#endif
+                for (vert = start[phase_num]; vert < end[phase_num]; vert++) {
+                    v = S[vert];
+                    for (j=G->k4NumEdges[v]; j<G->k4NumEdges[v+1]; j++) {
+                        w = G->k4EndV[j];
+
+                        /* w found for the first time? */ 
+#ifdef _OPENMP
+                        if (d[w] == -1 &&
+                            __sync_bool_compare_and_swap(&d[w], -1, d[v]+1)) {
+#else
+                        if (d[w] == -1) {
+                            d[w] = d[v] + 1;
+#endif
+                            if (myCount == BC_BUF_LEN) {
+#ifdef _OPENMP
+                                k = __sync_fetch_and_add(&sEnd, myCount);
+#else
+                                k = sEnd;
+                                sEnd += myCount;
 #endif
-            for (vert = start[phase_num]; vert < end[phase_num]; vert++) {
-                v = S[vert];
-                for (j=G->numEdges[v]; j<G->numEdges[v+1]; j++) {
-
-#ifndef VERIFYK4
-                    /* Filter edges with weights divisible by 8 */
-                    if ((G->weight[j] & 7) != 0) {
-#endif
-                        w = G->endV[j];
-                        if (v != w) {
-
-#ifdef _OPENMP                            
-                            myLock = omp_test_lock(&vLock[w]);
-                            if (myLock) { 
-#endif             
-                                /* w found for the first time? */ 
-                                if (d[w] == -1) {
-                                    if (myS_size == myCount) {
-                                        /* Resize myS */
-                                        myS_t = (LONG_T *)
-                                            malloc(2*myS_size*sizeof(VERT_T));
-                                        memcpy(myS_t, myS, myS_size*sizeof(VERT_T));
-                                        free(myS);
-                                        myS = myS_t;
-                                        myS_size = 2*myS_size;
-                                    }
-                                    myS[myCount++] = w;
-                                    d[w] = d[v] + 1;
-                                    sig[w] = sig[v];
-                                    P[w].list[P[w].count++] = v;
-                                } else if (d[w] == d[v] + 1) {
-                                    sig[w] += sig[v];
-                                    P[w].list[P[w].count++] = v;
-                                }
-#ifdef _OPENMP  
-                            
-                            omp_unset_lock(&vLock[w]);
-                            } else {
-                                if ((d[w] == -1) || (d[w] == d[v]+ 1)) {
-                                    omp_set_lock(&vLock[w]);
-                                    sig[w] += sig[v];
-                                    P[w].list[P[w].count++] = v;
-                                    omp_unset_lock(&vLock[w]);
-                                }
+                                memcpy(&S[k], myS, myCount*sizeof(VERT_T));
+                                myCount = 0;
                             }
+                            myS[myCount++] = w;
+                        }
+                        if (d[w] == d[v] + 1) {
+#ifdef _OPENMP
+#pragma omp atomic
 #endif
-                            
+                            sig[w] += sig[v];
                         }
-#ifndef VERIFYK4
                     }
-#endif
                 }
-             }
-            /* Merge all local stacks for next iteration */
-            phase_num++; 
 
-            psCount[tid+1] = myCount;
+                /* Append what is left of the local buffer */
+                if (myCount > 0) {
+#ifdef _OPENMP
+                    k = __sync_fetch_and_add(&sEnd, myCount);
+#else
+                    k = sEnd;
+                    sEnd += myCount;
+#endif
+                    memcpy(&S[k], myS, myCount*sizeof(VERT_T));
+                }
+                phase_num++; 
 
 #ifdef _OPENMP
 #pragma omp barrier
 #endif
 
-            if (tid == 0) {
-                start[phase_num] = end[phase_num-1];
-                psCount[0] = start[phase_num];
-                for(k=1; k<=nthreads; k++) {
-                    psCount[k] = psCount[k-1] + psCount[k];
+                if (tid == 0) {
+                    start[phase_num] = end[phase_num-1];
+                    end[phase_num] = sEnd;
                 }
-                end[phase_num] = psCount[nthreads];
-            }
             
 #ifdef _OPENMP           
 #pragma omp barrier
 #endif
-
-            for (k = psCount[tid]; k < psCount[tid+1]; k++) {
-                S[k] = myS[k-psCount[tid]];
-            } 
-            
-#ifdef _OPENMP            
-#pragma omp barrier
-#endif
-            count = end[phase_num];
-        }
+            }
      
-        phase_num--;
+            count = end[phase_num];
 
-#ifdef _OPENMP        
-#pragma omp barrier
-#endif
+            /* Accumulate dependencies from the successors of each vertex,
+               deepest level first, so every thread only writes del[] of
+               its own vertices. The deepest level has no successors and
+               its del[] stays 0 */
+            phase_num -= 2;
 
-        while (phase_num > 0) {
+            while (phase_num > 0) {
 #ifdef _OPENMP        
-#pragma omp for
-#endif
-            for (j=start[phase_num]; j<end[phase_num]; j++) {
-                w = S[j];
-                for (k = 0; k<P[w].count; k++) {
-                    v = P[w].list[k];
-#ifdef _OPENMP
-                    omp_set_lock(&vLock[v]);
-#endif
-                    del[v] = del[v] + sig[v]*(1+del[w])/sig[w];
-#ifdef _OPENMP
-                    omp_unset_lock(&vLock[v]);
+#pragma omp for schedule(dynamic)
 #endif
+                for (j=start[phase_num]; j<end[phase_num]; j++) {
+                    w = S[j];
+                    dsum = 0;
+                    for (k=G->k4NumEdges[w]; k<G->k4NumEdges[w+1]; k++) {
+                        x = G->k4EndV[k];
+                        if (d[x] == d[w] + 1) {
+                            dsum += (1+del[x])/sig[x];
+                        }
+                    }
+                    del[w] = sig[w]*dsum;
+                    BC[w] += del[w];
                 }
-                BC[w] += del[w];
-            }
 
-            phase_num--;
-            
-#ifdef _OPENMP
-#pragma omp barrier
-#endif            
-        }
+                phase_num--;
+            }
 
         
 #ifdef _OPENMP
-        chunkSize = n/nthreads;
+            chunkSize = n/nthreads;
 #pragma omp for schedule(static, chunkSize)
 #endif
-        for (j=0; j<count; j++) {
-            w = S[j];
-            d[w] = -1;
-            del[w] = 0;
-            P[w].count = 0;
-        }
+            for (j=0; j<count; j++) {
+                w = S[j];
+                d[w] = -1;
+                del[w] = 0;
+                sig[w] = 0;
+            }
 
 
 #ifdef _OPENMP
 #pragma omp barrier
 #endif
 
+        }
     }
- 
+
 #ifdef DIAGNOSTIC
     if (tid == 0) {
         elapsed_time_part = get_seconds() -elapsed_time_part;
@@ -415,9 +451,10 @@ double betweennessCentrality(graph* G, DOUBLE_T* BC) {
     free(myS);
     
     if (tid == 0) { 
+        if (coarse) {
+            free(bcPart);
+        }
         free(S);
-        free(pListMem);
-        free(P);
         free(sig);
         free(d);
         free(del);
@@ -426,7 +463,6 @@ double betweennessCentrality(graph* G, DOUBLE_T* BC) {
 #endif
         free(start);
         free(end);
-        free(psCount);
         elapsed_time = get_seconds() - elapsed_time;
         free(Srcs);
     }
@@ -182,6 +182,8 @@ double computeGraph(graph* G, graphSDG* SDGdata) {
         G->numEdges = numEdges;
         G->endV = endV;
         G->weight = w;
+        G->newId = NULL;
+        G->oldId = NULL;
     }
 #ifdef _OPENMP    
 }
@@ -211,8 +213,94 @@ double computeGraph(graph* G, graphSDG* SDGdata) {
     free(SDGdata->startVertex);
     free(SDGdata->endVertex);
     free(SDGdata->weight);
+
+    filterK4Edges(G);
     
     elapsed_time = get_seconds() - elapsed_time; 
     
     return elapsed_time;
 }
+
+#ifdef VERIFYK4
+#define K4_EDGE(G, u, j) (G->endV[j] != u)
+#else
+#define K4_EDGE(G, u, j) (((G->weight[j] & 7) != 0) && (G->endV[j] != u))
+#endif
+
+/* Copy the edges Kernel 4 follows into G->k4EndV and G->k4NumEdges,
+   so its traversals read no weights and test no edges */
+void filterK4Edges(graph* G) {
+
+    VERT_T* endV;
+    LONG_T *degree, *numEdges, *pSums;
+
+#ifdef _OPENMP
+#pragma omp parallel
+{
+#endif
+    LONG_T i, j, k, n, tid, nthreads;
+
+#ifdef _OPENMP
+    nthreads = omp_get_num_threads();
+    tid = omp_get_thread_num();
+#else
+    tid = 0;
+    nthreads = 1;
+#endif
+
+    n = G->n;
+
+    if (tid == 0) {
+        degree = (LONG_T *) malloc(n*sizeof(LONG_T));
+        assert(degree != NULL);
+        numEdges = (LONG_T *) malloc((n+1)*sizeof(LONG_T));
+        assert(numEdges != NULL);
+        pSums = (LONG_T *) malloc(nthreads*sizeof(LONG_T));
+        assert(pSums != NULL);
+    }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp for
+#endif
+    for (i=0; i<n; i++) {
+        degree[i] = 0;
+        for (j=G->numEdges[i]; j<G->numEdges[i+1]; j++) {
+            if (K4_EDGE(G, i, j))
+                degree[i]++;
+        }
+    }
+
+    prefix_sums(degree, numEdges, pSums, n);
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+
+    if (tid == 0) {
+        endV = (VERT_T *) malloc(numEdges[n]*sizeof(VERT_T));
+        assert(endV != NULL);
+    }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp for
+#endif
+    for (i=0; i<n; i++) {
+        k = numEdges[i];
+        for (j=G->numEdges[i]; j<G->numEdges[i+1]; j++) {
+            if (K4_EDGE(G, i, j))
+                endV[k++] = G->endV[j];
+        }
+    }
+
+    if (tid == 0) {
+        free(degree);
+        free(pSums);
+        G->k4EndV = endV;
+        G->k4NumEdges = numEdges;
+    }
+#ifdef _OPENMP
+}
+#endif
+}
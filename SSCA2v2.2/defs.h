@@ -20,6 +20,19 @@
    generate a 2D torus */
 /* #define VERIFYK4 */
 
+/* Uncomment this line, or use the flag -DRELABEL to renumber
+   the vertices by degree after Kernel 1 */
+/* #define RELABEL */
+
+/* Kernel 4 runs each traversal on a single thread, with private
+   arrays per thread, when there are at least 4 sources per thread and
+   those arrays fit in K4_COARSE_MAX_MB; otherwise all threads work
+   on each traversal in turn. Use the flag -DK4_COARSE=0 or
+   -DK4_COARSE=1 to force either mode */
+#ifndef K4_COARSE_MAX_MB
+#define K4_COARSE_MAX_MB 4096
+#endif
+
 #define INT_T int
 #define DOUBLE_T double
 
@@ -70,6 +83,20 @@ typedef struct
     LONG_T* numEdges;
     WEIGHT_T* weight;
 
+    /* If the vertices were relabeled, newId[v] is the current id of
+     * generated vertex v; NULL otherwise */
+    VERT_T* newId;
+
+    /* The inverse of newId: oldId[v] is the generated id of current
+     * vertex v, used to report vertices; NULL if not relabeled */
+    VERT_T* oldId;
+
+    /* The edges Kernel 4 traverses, in the same layout as endV and
+     * numEdges: no self-loops and, unless VERIFYK4, none of weight
+     * divisible by 8. Built by filterK4Edges() */
+    VERT_T* k4EndV;
+    LONG_T* k4NumEdges;
+
 } graph;
 
 /* Edge data structure for Kernel 2 */
@@ -81,14 +108,6 @@ typedef struct
     LONG_T e;
 } edge;
 
-/* Predecessor list data structure for Kernel 4 */
-typedef struct
-{
-    VERT_T* list;
-    VERT_T count;
-    LONG_T degree;
-} plist;
-
 
 /* Global variables */
 extern INT_T SCALE;
@@ -113,6 +132,8 @@ double gen2DTorus(graphSDG*);
 
 /* The four kernels */
 double computeGraph(graph*, graphSDG*);
+void filterK4Edges(graph*);
+double relabelGraph(graph*, VERT_T**, VERT_T**);
 double getStartLists(graph*, edge**, INT_T*);
 double findSubGraphs(graph*, edge*, INT_T);
 double betweennessCentrality(graph*, DOUBLE_T *);
@@ -1,201 +1,234 @@
 #include "defs.h"
+#include <stdint.h>
 
-double findSubGraphs(graph* G, 
-        edge* maxIntWtList, int maxIntWtListSize) {
+/* Searches run together, one bit each in a stamped mask word */
+#define FSG_BATCH 32
+#define FSG_MASK ((((uint64_t) 1) << FSG_BATCH) - 1)
+
+/* Vertices a thread adds to the next frontier are buffered locally and
+   appended to the shared queue this many at a time */
+#define FSG_BUF_LEN 1024
+
+/* The upper 32 bits of a mask word hold the epoch its lower bits were
+   set in; bits stamped with an older epoch read as clear, so the
+   arrays are never reset. Sets bits in *p under epoch e and returns
+   the ones that were not already set; *fresh tells whether the word
+   was stale before this call */
+static uint64_t stampBits(uint64_t* p, uint64_t e, uint64_t bits,
+        int* fresh) {
+
+    uint64_t old, cur;
+#ifdef _OPENMP
+    uint64_t seen;
+#endif
 
-    VERT_T* S;
-    LONG_T *start;
-    char* visited;
-    LONG_T *pSCount;
+    old = *p;
+    for (;;) {
+        cur = ((old >> 32) == e) ? (old & FSG_MASK) : 0;
+        if ((bits & ~cur) == 0) {
+            *fresh = 0;
+            return 0;
+        }
 #ifdef _OPENMP
-    omp_lock_t* vLock;
+        seen = __sync_val_compare_and_swap(p, old, (e << 32) | cur | bits);
+        if (seen == old)
+            break;
+        old = seen;
+#else
+        *p = (e << 32) | cur | bits;
+        break;
 #endif
+    }
+    *fresh = ((old >> 32) != e);
+    return bits & ~cur;
+}
+
+double findSubGraphs(graph* G,
+        edge* maxIntWtList, int maxIntWtListSize) {
+
+    VERT_T *Q[2];       /* current and next frontier */
+    uint64_t *visited;  /* searches that reached each vertex, stamped
+                           with the batch */
+    uint64_t *front[2]; /* searches that reached each frontier vertex in
+                           the last phase, stamped with the phase */
+    LONG_T qEnd[2];
+    LONG_T count[FSG_BATCH];
+    uint64_t batch, level;
 
-    LONG_T phase_num, numPhases;
-    LONG_T count;
-    
     double elapsed_time = get_seconds();
-    
-    numPhases = SubGraphPathLength + 1;
-        
-#ifdef _OPENMP 
+
+#ifdef _OPENMP
     omp_set_num_threads(NUM_THREADS);
 #pragma omp parallel
 {
 #endif
 
-    VERT_T *pS, *pSt;
-    LONG_T pCount, pS_size;
-    LONG_T v, w, search_num;
-    int tid, nthreads;
-    
+    VERT_T *pQ;
+    LONG_T pCount;
+    LONG_T myCount[FSG_BATCH];
+    LONG_T v, w, b, b0, nb, phase_num;
     LONG_T j, k, vert, n;
+    uint64_t bits, newBits, rest;
+    int cur, nxt, fresh;
+    int tid;
 
-#ifdef _OPENMP    
-    LONG_T i;
+#ifdef _OPENMP
     tid = omp_get_thread_num();
-    nthreads = omp_get_num_threads();
 #else
     tid = 0;
-    nthreads = 1;
 #endif
-    
+
     n = G->n;
-    
-    pS_size = n/nthreads + 1;
-    pS = (VERT_T *) malloc(pS_size*sizeof(VERT_T));
-    assert(pS != NULL);
-    
-    if (tid == 0) {  
-        S = (VERT_T *) malloc(n*sizeof(VERT_T));
-        visited = (char *) calloc(n, sizeof(char));
-        start = (LONG_T *) calloc((numPhases+2), sizeof(LONG_T));
-        pSCount = (LONG_T *) malloc((nthreads+1)*sizeof(LONG_T));
-#ifdef _OPENMP
-        vLock = (omp_lock_t *) malloc(n*sizeof(omp_lock_t));
-#endif
-    }
 
-#ifdef _OPENMP    
-#pragma omp barrier
+    pQ = (VERT_T *) malloc(FSG_BUF_LEN*sizeof(VERT_T));
+    assert(pQ != NULL);
 
-#pragma omp for
-    for (i=0; i<n; i++) {
-        omp_init_lock(&vLock[i]);
+    if (tid == 0) {
+        Q[0] = (VERT_T *) malloc(n*sizeof(VERT_T));
+        Q[1] = (VERT_T *) malloc(n*sizeof(VERT_T));
+        visited = (uint64_t *) calloc(n, sizeof(uint64_t));
+        front[0] = (uint64_t *) calloc(n, sizeof(uint64_t));
+        front[1] = (uint64_t *) calloc(n, sizeof(uint64_t));
+        batch = 0;
+        level = 0;
     }
-#endif
-    
-    for (search_num=0; search_num<maxIntWtListSize; search_num++) {
 
-#ifdef _OPENMP
-#pragma omp barrier
-#endif
-        /* Run path-limited BFS in parallel */
-        
+    for (b0=0; b0<maxIntWtListSize; b0+=FSG_BATCH) {
+
+        nb = maxIntWtListSize - b0;
+        if (nb > FSG_BATCH)
+            nb = FSG_BATCH;
+
+        /* Path-limited BFS from the end vertex of each edge in the
+           batch, with its start vertex already visited */
         if (tid == 0) {
-            free(visited);
-            visited = (char *) calloc(n, sizeof(char));
-            S[0] = maxIntWtList[search_num].startVertex;
-            S[1] = maxIntWtList[search_num].endVertex;
-            visited[S[0]] = (char) 1;
-            visited[S[1]] = (char) 1;
-            count = 2;
-            phase_num = 1;
-            start[0] = 0;
-            start[1] = 1;
-            start[2] = 2;
+            batch++;
+            level++;
+            qEnd[1] = 0;
+            for (b=0; b<nb; b++) {
+                v = maxIntWtList[b0+b].startVertex;
+                w = maxIntWtList[b0+b].endVertex;
+                stampBits(&visited[v], batch, ((uint64_t) 1) << b, &fresh);
+                stampBits(&visited[w], batch, ((uint64_t) 1) << b, &fresh);
+                stampBits(&front[1][w], level, ((uint64_t) 1) << b, &fresh);
+                if (fresh)
+                    Q[1][qEnd[1]++] = w;
+                count[b] = 2;
+            }
+        }
+
+        for (b=0; b<nb; b++) {
+            myCount[b] = 0;
         }
 
-        
 #ifdef _OPENMP
 #pragma omp barrier
 #endif
 
-        while (phase_num <= SubGraphPathLength) {
-        
+        for (phase_num=1; phase_num<=SubGraphPathLength; phase_num++) {
+
+            cur = phase_num & 1;
+            nxt = cur ^ 1;
+            if (tid == 0) {
+                qEnd[nxt] = 0;
+            }
             pCount = 0;
 
 #ifdef _OPENMP
-#pragma omp for
+#pragma omp barrier
+#pragma omp for schedule(dynamic, 64) nowait
 #endif
-            for (vert=start[phase_num]; vert<start[phase_num+1]; vert++) {
-            
-                v = S[vert];
+            for (vert=0; vert<qEnd[cur]; vert++) {
+
+                v = Q[cur][vert];
+                bits = front[cur][v] & FSG_MASK;
                 for (j=G->numEdges[v]; j<G->numEdges[v+1]; j++) {
-                    w = G->endV[j]; 
+                    w = G->endV[j];
                     if (v == w)
                         continue;
+                    newBits = stampBits(&visited[w], batch, bits, &fresh);
+                    if (newBits == 0)
+                        continue;
+                    for (rest=newBits; rest!=0; rest&=rest-1) {
+                        myCount[__builtin_ctzll(rest)]++;
+                    }
+                    stampBits(&front[nxt][w], level+1, newBits, &fresh);
+                    if (fresh) {
+                        if (pCount == FSG_BUF_LEN) {
 #ifdef _OPENMP
-                    int myLock = omp_test_lock(&vLock[w]);
-                    if (myLock) {
+                            k = __sync_fetch_and_add(&qEnd[nxt], pCount);
+#else
+                            k = qEnd[nxt];
+                            qEnd[nxt] += pCount;
 #endif
-                        if (visited[w] != (char) 1) { 
-                            visited[w] = (char) 1;
-                            if (pCount == pS_size) {
-                                /* Resize pS */
-                                pSt = (VERT_T *)
-                                    malloc(2*pS_size*sizeof(VERT_T));
-                                memcpy(pSt, pS, pS_size*sizeof(VERT_T));
-                                free(pS);
-                                pS = pSt;
-                                pS_size = 2*pS_size;
-                            }
-                            pS[pCount++] = w;
+                            memcpy(&Q[nxt][k], pQ, pCount*sizeof(VERT_T));
+                            pCount = 0;
                         }
-#ifdef _OPENMP
-                        omp_unset_lock(&vLock[w]);
+                        pQ[pCount++] = w;
                     }
-#endif
                 }
             }
-            
 
+            if (pCount > 0) {
 #ifdef _OPENMP
-#pragma omp barrier
-#endif            
-            pSCount[tid+1] = pCount;
- 
+                k = __sync_fetch_and_add(&qEnd[nxt], pCount);
+#else
+                k = qEnd[nxt];
+                qEnd[nxt] += pCount;
+#endif
+                memcpy(&Q[nxt][k], pQ, pCount*sizeof(VERT_T));
+            }
+
 #ifdef _OPENMP
 #pragma omp barrier
-#endif            
-           
+#endif
             if (tid == 0) {
-                pSCount[0] = start[phase_num+1];
-                for(k=1; k<=nthreads; k++) {
-                    pSCount[k] = pSCount[k-1] + pSCount[k];
-                }
-                start[phase_num+2] = pSCount[nthreads];
-                count = pSCount[nthreads];
-                phase_num++;
+                level++;
             }
-            
+        } /* End of search */
+
+        for (b=0; b<nb; b++) {
 #ifdef _OPENMP
-#pragma omp barrier
+#pragma omp atomic
 #endif
-            for (k = pSCount[tid]; k < pSCount[tid+1]; k++) {
-                S[k] = pS[k-pSCount[tid]];
-            } 
-            
+            count[b] += myCount[b];
+        }
 
 #ifdef _OPENMP
 #pragma omp barrier
 #endif
-        } /* End of search */
 
         if (tid == 0) {
-            fprintf(stderr, "Search from <%ld, %ld>, number of vertices visited:"
-                    " %ld\n", (long) S[0], (long) S[1], (long) count);
+            for (b=0; b<nb; b++) {
+                /* Report the generated vertex ids */
+                v = maxIntWtList[b0+b].startVertex;
+                w = maxIntWtList[b0+b].endVertex;
+                if (G->oldId != NULL) {
+                    v = G->oldId[v];
+                    w = G->oldId[w];
+                }
+                fprintf(stderr, "Search from <%ld, %ld>, number of vertices visited:"
+                        " %ld\n", (long) v, (long) w, (long) count[b]);
+            }
         }
 
     } /* End of outer loop */
-    
-    free(pS);
-#ifdef _OPENMP    
-#pragma omp barrier
 
-#pragma omp for
-    for (i=0; i<n; i++) {
-        omp_destroy_lock(&vLock[i]);
-    }
-#pragma omp barrier
-#endif
+    free(pQ);
 
     if (tid == 0) {
-        free(S);
-        free(start);
+        free(Q[0]);
+        free(Q[1]);
         free(visited);
-        free(pSCount);
-#ifdef _OPENMP
-        free(vLock);
-#endif
-        
+        free(front[0]);
+        free(front[1]);
     }
 
-#ifdef _OPENMP    
+#ifdef _OPENMP
 }
 #endif
 
     elapsed_time = get_seconds() - elapsed_time;
     return elapsed_time;
-   
+
 }
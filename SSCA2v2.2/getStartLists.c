@@ -175,8 +175,13 @@ double getStartLists(graph* G, edge** maxIntWtListPtr,
 #if 0
     maxIntWtList = *maxIntWtListPtr;
     for (int i=0; i<*maxIntWtListSizePtr; i++) {
-        fprintf(stderr, "[%ld %ld %ld %ld] ", maxIntWtList[i].startVertex, 
-                maxIntWtList[i].endVertex, maxIntWtList[i].e, maxIntWtList[i].w);
+        VERT_T u = maxIntWtList[i].startVertex, v = maxIntWtList[i].endVertex;
+        if (G->oldId != NULL) {
+            u = G->oldId[u];
+            v = G->oldId[v];
+        }
+        fprintf(stderr, "[%ld %ld %ld %ld] ", u, v,
+                maxIntWtList[i].e, maxIntWtList[i].w);
     }
 #endif
 
@@ -0,0 +1,156 @@
+#include "defs.h"
+
+/* Renumber the vertices of G in order of non-increasing out-degree
+ * (ties keep their original order), so that the hubs every traversal
+ * keeps returning to share cache lines in the per-vertex arrays of
+ * Kernels 3 and 4. On return, newId[v] is the new id of original
+ * vertex v and oldId[v] the original id of new vertex v. */
+double relabelGraph(graph* G, VERT_T** newId, VERT_T** oldIdPtr) {
+
+    VERT_T *oldId, *newV, *endV;
+    LONG_T *degree, *numEdges, *pSums, *bucket;
+    WEIGHT_T* w;
+    LONG_T maxDegree;
+    double elapsed_time;
+
+    elapsed_time = get_seconds();
+
+    maxDegree = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel
+{
+#endif
+    LONG_T i, j, k, v, n, m, tid, nthreads;
+    LONG_T myMaxDegree;
+
+#ifdef _OPENMP
+    nthreads = omp_get_num_threads();
+    tid = omp_get_thread_num();
+#else
+    tid = 0;
+    nthreads = 1;
+#endif
+
+    n = G->n;
+    m = G->m;
+
+    if (tid == 0) {
+        oldId = (VERT_T *) malloc(n*sizeof(VERT_T));
+        assert(oldId != NULL);
+        newV = (VERT_T *) malloc(n*sizeof(VERT_T));
+        assert(newV != NULL);
+        degree = (LONG_T *) malloc(n*sizeof(LONG_T));
+        assert(degree != NULL);
+        pSums = (LONG_T *) malloc(nthreads*sizeof(LONG_T));
+        assert(pSums != NULL);
+    }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+
+    myMaxDegree = 0;
+#ifdef _OPENMP
+#pragma omp for
+#endif
+    for (i=0; i<n; i++) {
+        if (G->numEdges[i+1] - G->numEdges[i] > myMaxDegree)
+            myMaxDegree = G->numEdges[i+1] - G->numEdges[i];
+    }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    {
+        if (myMaxDegree > maxDegree)
+            maxDegree = myMaxDegree;
+    }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+
+    /* Counting sort by degree, highest first */
+    if (tid == 0) {
+        bucket = (LONG_T *) calloc(maxDegree+2, sizeof(LONG_T));
+        assert(bucket != NULL);
+        for (i=0; i<n; i++) {
+            bucket[maxDegree - (G->numEdges[i+1] - G->numEdges[i]) + 1]++;
+        }
+        for (k=1; k<maxDegree+2; k++) {
+            bucket[k] += bucket[k-1];
+        }
+        for (i=0; i<n; i++) {
+            v = bucket[maxDegree - (G->numEdges[i+1] - G->numEdges[i])]++;
+            oldId[v] = i;
+            newV[i] = v;
+        }
+        free(bucket);
+    }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp for
+#endif
+    for (i=0; i<n; i++) {
+        degree[i] = G->numEdges[oldId[i]+1] - G->numEdges[oldId[i]];
+    }
+
+    if (tid == 0) {
+        numEdges = (LONG_T *) malloc((n+1)*sizeof(LONG_T));
+        assert(numEdges != NULL);
+        endV = (VERT_T *) malloc(m*sizeof(VERT_T));
+        assert(endV != NULL);
+        w = (WEIGHT_T *) malloc(m*sizeof(WEIGHT_T));
+        assert(w != NULL);
+    }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+
+    prefix_sums(degree, numEdges, pSums, n);
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp for
+#endif
+    for (i=0; i<n; i++) {
+        k = numEdges[i];
+        for (j=G->numEdges[oldId[i]]; j<G->numEdges[oldId[i]+1]; j++) {
+            endV[k] = newV[G->endV[j]];
+            w[k] = G->weight[j];
+            k++;
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+
+    if (tid == 0) {
+        free(G->numEdges);
+        free(G->endV);
+        free(G->weight);
+        G->numEdges = numEdges;
+        G->endV = endV;
+        G->weight = w;
+        free(degree);
+        free(pSums);
+        *newId = newV;
+        *oldIdPtr = oldId;
+    }
+
+#ifdef _OPENMP
+}
+#endif
+
+    free(G->k4EndV);
+    free(G->k4NumEdges);
+    filterK4Edges(G);
+
+    elapsed_time = get_seconds() - elapsed_time;
+
+    return elapsed_time;
+}
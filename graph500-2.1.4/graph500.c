@@ -27,6 +27,7 @@
 #include "timer.h"
 #include "xalloc.h"
 #include "options.h"
+#include "graphcache.h"
 #include "generator/splittable_mrg.h"
 #include "generator/graph_generator.h"
 #include "generator/make_graph.h"
@@ -37,13 +38,18 @@ static int64_t bfs_root[NBFS_max];
 
 static double generation_time;
 static double construction_time;
+double relabel_time;
 static double bfs_time[NBFS_max];
 static int64_t bfs_nedge[NBFS_max];
 
 static packed_edge * restrict IJ;
 static int64_t nedge;
+static int IJ_mapped;
+static struct graph_cache gcache;
+static int csr_cached;
 
 static void run_bfs (void);
+static void check_bfs_tree (int m, int64_t *bfs_tree, int64_t max_bfsvtx);
 static void output_results (const int64_t SCALE, int64_t nvtx_scale,
 			    int64_t edgefactor,
 			    const double A, const double B,
@@ -79,7 +85,13 @@ main (int argc, char **argv)
     the following if () {} else {} with a statement pointing IJ
     to wherever the edge list is mapped into the simulator's memory.
   */
-  if (!dumpname) {
+  if (cachedir)
+    TIME(generation_time, IJ_mapped = !graph_cache_load (cachedir, &gcache));
+  if (IJ_mapped) {
+    IJ = gcache.IJ;
+    nedge = gcache.nedge;
+    if (VERBOSE) fprintf (stderr, " done.\n");
+  } else if (!dumpname) {
     if (VERBOSE) fprintf (stderr, "Generating edge list...");
     if (use_RMAT) {
       nedge = desired_nedge;
@@ -89,24 +101,25 @@ main (int argc, char **argv)
       TIME(generation_time, make_graph (SCALE, desired_nedge, userseed, userseed, &nedge, (packed_edge**)(&IJ)));
     }
     if (VERBOSE) fprintf (stderr, " done.\n");
-  } else {
-    int fd;
-    ssize_t sz;
-    if ((fd = open (dumpname, O_RDONLY)) < 0) {
-      perror ("Cannot open input graph file");
-      return EXIT_FAILURE;
+#if !defined(CSR_CACHE)
+    if (cachedir) {
+      gcache.IJ = IJ;
+      gcache.nedge = nedge;
+      graph_cache_store (cachedir, &gcache);
     }
-    sz = nedge * sizeof (*IJ);
-    if (sz != read (fd, IJ, sz)) {
-      perror ("Error reading input graph file");
+#endif
+  } else {
+    if (!(IJ = map_edge_file (dumpname, &nedge)))
       return EXIT_FAILURE;
-    }
-    close (fd);
+    IJ_mapped = 1;
   }
 
   run_bfs ();
 
-  xfree_large (IJ);
+  if (IJ_mapped)
+    graph_cache_unmap ();
+  else
+    xfree_large (IJ);
 
   output_results (SCALE, nvtx_scale, edgefactor, A, B, C, D,
 		  generation_time, construction_time, NBFS, bfs_time, bfs_nedge);
@@ -122,7 +135,33 @@ run_bfs (void)
   int64_t k, t;
 
   if (VERBOSE) fprintf (stderr, "Creating graph...");
+#if defined(CSR_CACHE)
+  if (cachedir) {
+    double finish_time;
+    if (gcache.nxoff)
+      TIME(construction_time,
+	   err = set_graph_csr (gcache.nv, gcache.xoff, gcache.nxoff,
+				gcache.xadj, gcache.nxadj));
+    csr_cached = gcache.nxoff && !err;
+    if (!csr_cached) {
+      TIME(construction_time, err = build_graph_csr (IJ, nedge));
+      if (!err) {
+	/* Saving the graph is not part of its construction. */
+	gcache.IJ = IJ;
+	gcache.nedge = nedge;
+	get_graph_csr (&gcache.nv, &gcache.xoff, &gcache.nxoff,
+		       &gcache.xadj, &gcache.nxadj);
+	graph_cache_store (cachedir, &gcache);
+      }
+    }
+    if (!err) {
+      TIME(finish_time, err = finish_graph_csr ());
+      construction_time += finish_time;
+    }
+  } else
+#endif
   TIME(construction_time, err = create_graph_from_edgelist (IJ, nedge));
+  construction_time -= relabel_time;
   if (VERBOSE) fprintf (stderr, "done.\n");
   if (err) {
     fprintf (stderr, "Failure creating graph.\n");
@@ -184,37 +223,84 @@ run_bfs (void)
     close (fd);
   }
 
-  for (m = 0; m < NBFS; ++m) {
-    int64_t *bfs_tree, max_bfsvtx;
+  if (batch_bfs) {
+#if defined(BATCHED_BFS)
+    int m0, nb;
+    for (m0 = 0; m0 < NBFS; m0 += nb) {
+      int64_t *bfs_tree, max_bfsvtx;
+      double batch_time;
 
-    /* Re-allocate. Some systems may randomize the addres... */
-    bfs_tree = xmalloc_large (nvtx_scale * sizeof (*bfs_tree));
-    assert (bfs_root[m] < nvtx_scale);
+      nb = (NBFS - m0 < BFS_BATCH_max ? NBFS - m0 : BFS_BATCH_max);
+      for (m = m0; m < m0 + nb; ++m)
+	assert (bfs_root[m] < nvtx_scale);
 
-    if (VERBOSE) fprintf (stderr, "Running bfs %d...", m);
-    TIME(bfs_time[m], err = make_bfs_tree (bfs_tree, &max_bfsvtx, bfs_root[m]));
-    if (VERBOSE) fprintf (stderr, "done\n");
+      if (VERBOSE) fprintf (stderr, "Running bfs %d-%d...", m0, m0+nb-1);
+      TIME(batch_time, err = make_bfs_batch (&max_bfsvtx, &bfs_root[m0], nb));
+      if (VERBOSE) fprintf (stderr, "done\n");
 
-    if (err) {
-      perror ("make_bfs_tree failed");
-      abort ();
-    }
+      if (err) {
+	perror ("make_bfs_batch failed");
+	abort ();
+      }
 
-    if (VERBOSE) fprintf (stderr, "Verifying bfs %d...", m);
-    bfs_nedge[m] = verify_bfs_tree (bfs_tree, max_bfsvtx, bfs_root[m], IJ, nedge);
-    if (VERBOSE) fprintf (stderr, "done\n");
-    if (bfs_nedge[m] < 0) {
-      fprintf (stderr, "bfs %d from %" PRId64 " failed verification (%" PRId64 ")\n",
-	       m, bfs_root[m], bfs_nedge[m]);
-      abort ();
+      /* Each search is charged an equal share of the batch plus the
+	 expansion of its own parent tree. */
+      for (m = m0; m < m0 + nb; ++m) {
+	double tree_time;
+	bfs_tree = xmalloc_large (nvtx_scale * sizeof (*bfs_tree));
+	TIME(tree_time, err = get_bfs_batch_tree (bfs_tree, m - m0));
+	if (err) {
+	  perror ("get_bfs_batch_tree failed");
+	  abort ();
+	}
+	bfs_time[m] = batch_time / nb + tree_time;
+	check_bfs_tree (m, bfs_tree, max_bfsvtx);
+	xfree_large (bfs_tree);
+      }
     }
+#else
+    fprintf (stderr, "Batched BFS is not supported by this implementation.\n");
+    exit (EXIT_FAILURE);
+#endif
+  } else {
+    for (m = 0; m < NBFS; ++m) {
+      int64_t *bfs_tree, max_bfsvtx;
+
+      /* Re-allocate. Some systems may randomize the addres... */
+      bfs_tree = xmalloc_large (nvtx_scale * sizeof (*bfs_tree));
+      assert (bfs_root[m] < nvtx_scale);
+
+      if (VERBOSE) fprintf (stderr, "Running bfs %d...", m);
+      TIME(bfs_time[m], err = make_bfs_tree (bfs_tree, &max_bfsvtx, bfs_root[m]));
+      if (VERBOSE) fprintf (stderr, "done\n");
+
+      if (err) {
+	perror ("make_bfs_tree failed");
+	abort ();
+      }
+
+      check_bfs_tree (m, bfs_tree, max_bfsvtx);
 
-    xfree_large (bfs_tree);
+      xfree_large (bfs_tree);
+    }
   }
 
   destroy_graph ();
 }
 
+void
+check_bfs_tree (int m, int64_t *bfs_tree, int64_t max_bfsvtx)
+{
+  if (VERBOSE) fprintf (stderr, "Verifying bfs %d...", m);
+  bfs_nedge[m] = verify_bfs_tree (bfs_tree, max_bfsvtx, bfs_root[m], IJ, nedge);
+  if (VERBOSE) fprintf (stderr, "done\n");
+  if (bfs_nedge[m] < 0) {
+    fprintf (stderr, "bfs %d from %" PRId64 " failed verification (%" PRId64 ")\n",
+	     m, bfs_root[m], bfs_nedge[m]);
+    abort ();
+  }
+}
+
 #define NSTAT 9
 #define PRINT_STATS(lbl, israte)					\
   do {									\
@@ -335,7 +421,15 @@ output_results (const int64_t SCALE, int64_t nvtx_scale, int64_t edgefactor,
 	  SCALE, nvtx_scale, edgefactor, sz/1.0e12);
   printf ("A: %20.17e\nB: %20.17e\nC: %20.17e\nD: %20.17e\n", A, B, C, D);
   printf ("generation_time: %20.17e\n", generation_time);
-  printf ("construction_time: %20.17e\n", construction_time);
+  /* A cached CSR is loaded, not constructed. */
+  if (csr_cached)
+    printf ("cache_load_time: %20.17e\n", construction_time);
+  else if (sort_csr)
+    printf ("sort_construction_time: %20.17e\n", construction_time);
+  else
+    printf ("construction_time: %20.17e\n", construction_time);
+  if (relabel_vtx)
+    printf ("relabel_time: %20.17e\n", relabel_time);
   printf ("nbfs: %d\n", NBFS);
 
   memcpy (tm, bfs_time, NBFS*sizeof(tm[0]));
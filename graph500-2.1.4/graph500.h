@@ -16,6 +16,39 @@ int create_graph_from_edgelist (struct packed_edge *IJ, int64_t nedge);
 int make_bfs_tree (int64_t *bfs_tree_out, int64_t *max_vtx_out,
 		   int64_t srcvtx);
 
+#if defined(BATCHED_BFS)
+/** Most roots one make_bfs_batch call can search from. */
+#define BFS_BATCH_max 64
+
+/** Search from nsrc <= BFS_BATCH_max roots at once. */
+int make_bfs_batch (int64_t *max_vtx_out, const int64_t *srcvtx, int nsrc);
+
+/** Expand the tree of root k of the last batch. */
+int get_bfs_batch_tree (int64_t *bfs_tree_out, int k);
+#endif
+
+#if defined(CSR_CACHE)
+/** create_graph_from_edgelist in two steps, so the plain CSR can be
+    saved to or restored from the graph cache in between. */
+int build_graph_csr (struct packed_edge *IJ, int64_t nedge);
+
+/** Finish the graph (relabeling, compression) from the plain CSR. */
+int finish_graph_csr (void);
+
+/** The arrays of the plain CSR, stored verbatim in the graph cache. */
+void get_graph_csr (int64_t *nv, int64_t **xoff, int64_t *nxoff,
+		    int64_t **xadj, int64_t *nxadj);
+
+/** Adopt a plain CSR from the graph cache in place of building one.
+    The arrays are not freed by destroy_graph. */
+int set_graph_csr (int64_t nv, int64_t *xoff, int64_t nxoff,
+		   int64_t *xadj, int64_t nxadj);
+#endif
+
+/** Time create_graph_from_edgelist spent relabeling vertices, if
+    the implementation does so.  Not counted in construction_time. */
+extern double relabel_time;
+
 /** Clean up. */
 void destroy_graph (void);
 
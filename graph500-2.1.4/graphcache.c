@@ -0,0 +1,270 @@
+/* -*- mode: C; mode: folding; fill-column: 70; -*- */
+/* Copyright 2010,  Georgia Institute of Technology, USA. */
+/* See COPYING for license. */
+#include "compat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "graphcache.h"
+#include "options.h"
+#include "prng.h"
+
+/*
+  A cache file is a header followed by the edge list, the CSR offsets,
+  and the CSR adjacency store, each starting on a CACHE_ALIGN boundary
+  so the arrays can be used in place once the file is mapped.  The
+  header repeats every generator parameter; a file that does not match
+  the current run, or whose checksum over the three arrays does not,
+  is ignored and rewritten.
+*/
+
+#define CACHE_MAGIC "G500GC01"
+#define CACHE_ALIGN ((int64_t)4096)
+
+struct cache_header {
+  char magic[8];
+  int64_t edge_size;
+  int64_t SCALE, edgefactor, use_RMAT;
+  uint64_t userseed;
+  double A, B, C, D;
+  int64_t nedge, nv, nxoff, nxadj;
+  int64_t IJ_pos, xoff_pos, xadj_pos, file_size;
+  uint64_t checksum;
+};
+
+static void *map_base;
+static size_t map_size;
+
+static int64_t
+align_up (int64_t x)
+{
+  return (x + CACHE_ALIGN - 1) & ~(CACHE_ALIGN - 1);
+}
+
+/* Returns -1 if the name does not fit into PATH_MAX bytes. */
+static int
+cache_name (char *name, const char *cachedir)
+{
+  int n = snprintf (name, PATH_MAX, "%s/graph500-s%" PRId64 "-e%" PRId64
+		    "-%016" PRIx64 "%s.gc", cachedir, SCALE, edgefactor,
+		    userseed, (use_RMAT? "-rmat" : ""));
+  return (n < 0 || n >= PATH_MAX)? -1 : 0;
+}
+
+static void
+fill_key (struct cache_header *h)
+{
+  memset (h, 0, sizeof (*h));
+  memcpy (h->magic, CACHE_MAGIC, sizeof (h->magic));
+  h->edge_size = sizeof (struct packed_edge);
+  h->SCALE = SCALE;
+  h->edgefactor = edgefactor;
+  h->use_RMAT = use_RMAT;
+  h->userseed = userseed;
+  if (use_RMAT) {
+    h->A = A;
+    h->B = B;
+    h->C = C;
+    h->D = D;
+  }
+}
+
+static uint64_t
+mix64 (uint64_t x)
+{
+  x ^= x >> 30;
+  x *= UINT64_C(0xbf58476d1ce4e5b9);
+  x ^= x >> 27;
+  x *= UINT64_C(0x94d049bb133111eb);
+  x ^= x >> 31;
+  return x;
+}
+
+/* Order-independent sum of position-salted words, so the threads can
+   each take a slice. */
+static uint64_t
+checksum (const void *p, int64_t len, uint64_t salt)
+{
+  const uint64_t * restrict w = p;
+  const int64_t nw = len / 8;
+  uint64_t sum = 0, tail = 0;
+  int64_t k;
+
+  OMP("omp parallel for reduction(+:sum)")
+    for (k = 0; k < nw; ++k)
+      sum += mix64 (w[k] ^ mix64 (salt + k));
+  if (len % 8)
+    memcpy (&tail, (const char*)p + 8*nw, len % 8);
+  return sum + mix64 (tail ^ mix64 (salt + nw));
+}
+
+static uint64_t
+cache_checksum (const struct graph_cache *gc)
+{
+  return checksum (gc->IJ, gc->nedge * sizeof (*gc->IJ), 1)
+    + checksum (gc->xoff, gc->nxoff * sizeof (*gc->xoff), 2)
+    + checksum (gc->xadj, gc->nxadj * sizeof (*gc->xadj), 3);
+}
+
+static int
+pwrite_all (int fd, const void *p, int64_t len, int64_t pos)
+{
+  const char *c = p;
+  while (len > 0) {
+    ssize_t n = pwrite (fd, c, len, pos);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    c += n;
+    pos += n;
+    len -= n;
+  }
+  return 0;
+}
+
+int
+graph_cache_load (const char *cachedir, struct graph_cache *gc)
+{
+  char name[PATH_MAX];
+  struct cache_header h, key;
+  struct graph_cache g;
+  struct stat st;
+  char *base;
+  int fd;
+
+  if (cache_name (name, cachedir)) return -1;
+  if ((fd = open (name, O_RDONLY)) < 0) return -1;
+  fill_key (&key);
+  if (fstat (fd, &st) || pread (fd, &h, sizeof (h), 0) != sizeof (h)
+      || memcmp (h.magic, key.magic, sizeof (h.magic))
+      || h.edge_size != key.edge_size
+      || h.SCALE != key.SCALE || h.edgefactor != key.edgefactor
+      || h.use_RMAT != key.use_RMAT || h.userseed != key.userseed
+      || h.A != key.A || h.B != key.B || h.C != key.C || h.D != key.D
+      || h.file_size != st.st_size) {
+    fprintf (stderr, "Ignoring mismatched graph cache %s.\n", name);
+    close (fd);
+    return -1;
+  }
+
+  base = mmap (NULL, h.file_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (base == MAP_FAILED) {
+    perror ("Cannot map graph cache");
+    return -1;
+  }
+
+  g.IJ = (struct packed_edge *)(base + h.IJ_pos);
+  g.nedge = h.nedge;
+  g.nv = h.nv;
+  g.xoff = (int64_t *)(base + h.xoff_pos);
+  g.nxoff = h.nxoff;
+  g.xadj = (int64_t *)(base + h.xadj_pos);
+  g.nxadj = h.nxadj;
+  if (cache_checksum (&g) != h.checksum) {
+    fprintf (stderr, "Ignoring graph cache %s with a bad checksum.\n", name);
+    munmap (base, h.file_size);
+    return -1;
+  }
+
+  *gc = g;
+  map_base = base;
+  map_size = h.file_size;
+  if (VERBOSE) fprintf (stderr, "Mapped graph cache %s...", name);
+  return 0;
+}
+
+int
+graph_cache_store (const char *cachedir, const struct graph_cache *gc)
+{
+  char name[PATH_MAX], tmpname[PATH_MAX + 8];
+  struct cache_header h;
+  int fd;
+
+  fill_key (&h);
+  h.nedge = gc->nedge;
+  h.nv = gc->nv;
+  h.nxoff = gc->nxoff;
+  h.nxadj = gc->nxadj;
+  h.IJ_pos = align_up (sizeof (h));
+  h.xoff_pos = align_up (h.IJ_pos + h.nedge * sizeof (*gc->IJ));
+  h.xadj_pos = align_up (h.xoff_pos + h.nxoff * sizeof (*gc->xoff));
+  h.file_size = h.xadj_pos + h.nxadj * sizeof (*gc->xadj);
+  h.checksum = cache_checksum (gc);
+
+  /* Write a temporary and rename it over the old file, so a run
+     mapping the old one or a concurrent writer never sees it torn. */
+  if (cache_name (name, cachedir)) {
+    fprintf (stderr, "Graph cache path too long.\n");
+    return -1;
+  }
+  snprintf (tmpname, sizeof (tmpname), "%s.XXXXXX", name);
+  if ((fd = mkstemp (tmpname)) < 0) {
+    perror ("Cannot create graph cache");
+    return -1;
+  }
+  if (ftruncate (fd, h.file_size)
+      || pwrite_all (fd, &h, sizeof (h), 0)
+      || pwrite_all (fd, gc->IJ, h.nedge * sizeof (*gc->IJ), h.IJ_pos)
+      || pwrite_all (fd, gc->xoff, h.nxoff * sizeof (*gc->xoff), h.xoff_pos)
+      || pwrite_all (fd, gc->xadj, h.nxadj * sizeof (*gc->xadj), h.xadj_pos)
+      || fchmod (fd, 0644)
+      || close (fd)) {
+    perror ("Error writing graph cache");
+    unlink (tmpname);
+    return -1;
+  }
+  if (rename (tmpname, name)) {
+    perror ("Cannot rename graph cache");
+    unlink (tmpname);
+    return -1;
+  }
+  if (VERBOSE) fprintf (stderr, "Wrote graph cache %s...", name);
+  return 0;
+}
+
+struct packed_edge *
+map_edge_file (const char *name, int64_t *nedge)
+{
+  struct stat st;
+  void *base;
+  int fd;
+
+  if ((fd = open (name, O_RDONLY)) < 0) {
+    perror ("Cannot open input graph file");
+    return NULL;
+  }
+  if (fstat (fd, &st) || st.st_size < (off_t)sizeof (struct packed_edge)) {
+    fprintf (stderr, "Input graph file %s is empty.\n", name);
+    close (fd);
+    return NULL;
+  }
+  base = mmap (NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (base == MAP_FAILED) {
+    perror ("Cannot map input graph file");
+    return NULL;
+  }
+  map_base = base;
+  map_size = st.st_size;
+  *nedge = st.st_size / sizeof (struct packed_edge);
+  return base;
+}
+
+void
+graph_cache_unmap (void)
+{
+  if (map_base) {
+    munmap (map_base, map_size);
+    map_base = NULL;
+  }
+}
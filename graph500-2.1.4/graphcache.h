@@ -0,0 +1,37 @@
+/* -*- mode: C; mode: folding; fill-column: 70; -*- */
+/* Copyright 2010,  Georgia Institute of Technology, USA. */
+/* See COPYING for license. */
+#if !defined(GRAPHCACHE_HEADER_)
+#define GRAPHCACHE_HEADER_
+
+#include "generator/graph_generator.h"
+
+/** A generated edge list and, optionally, the CSR an implementation
+    built from it, as held in a graph cache file.  nxoff is zero when
+    the file has no CSR. */
+struct graph_cache {
+  struct packed_edge *IJ;
+  int64_t nedge;
+  int64_t nv;
+  int64_t *xoff;
+  int64_t nxoff;
+  int64_t *xadj;
+  int64_t nxadj;
+};
+
+/** Map the file in cachedir matching the current SCALE, edgefactor,
+    seed, and generator parameters.  Returns 0 and fills *gc if it
+    exists and its checksum matches, -1 otherwise. */
+int graph_cache_load (const char *cachedir, struct graph_cache *gc);
+
+/** Write *gc as the cache file for the current parameters, replacing
+    any previous one.  Returns 0 on success. */
+int graph_cache_store (const char *cachedir, const struct graph_cache *gc);
+
+/** Map a raw edge list as written by make-edgelist. */
+struct packed_edge *map_edge_file (const char *name, int64_t *nedge);
+
+/** Unmap the file mapped by graph_cache_load or map_edge_file. */
+void graph_cache_unmap (void);
+
+#endif /* GRAPHCACHE_HEADER_ */
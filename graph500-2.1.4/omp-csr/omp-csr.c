@@ -14,8 +14,10 @@
 static int64_t int64_fetch_add (int64_t* p, int64_t incr);
 static int64_t int64_casval(int64_t* p, int64_t oldval, int64_t newval);
 static int int64_cas(int64_t* p, int64_t oldval, int64_t newval);
+static uint64_t uint64_fetch_or (uint64_t* p, uint64_t mask);
 
 #include "../graph500.h"
+#include "../options.h"
 #include "../xalloc.h"
 #include "../generator/graph_generator.h"
 
@@ -25,6 +27,23 @@ static int64_t maxvtx, nv, sz;
 static int64_t * restrict xoff; /* Length 2*nv+2 */
 static int64_t * restrict xadjstore; /* Length MINVECT_SIZE + (xoff[nv] == nedge) */
 static int64_t * restrict xadj;
+static int64_t nadj; /* Total adjacency entries after packing */
+static int csr_mapped; /* xoff and xadjstore belong to the graph cache */
+static int64_t * restrict newid; /* Relabeled id of each vertex, or NULL */
+static int64_t * restrict oldid; /* Original id of each relabeled vertex */
+
+/* Compressed adjacency (-z): for each vertex, starting at byte
+   zoff[v] of zadj, its degree and then the gaps between its sorted
+   neighbors, all as little-endian base-128 varints.  Replaces xoff
+   and xadj once built. */
+static int64_t * restrict zoff;
+static uint8_t * restrict zadj;
+
+/* Last batched search: level of each vertex under each root,
+   batch_nsrc bytes per vertex, BATCH_UNREACHED if not reached. */
+#define BATCH_UNREACHED 0xff
+static uint8_t * restrict batch_level;
+static int batch_nsrc;
 
 static void
 find_nv (const struct packed_edge * restrict IJ, const int64_t nedge)
@@ -56,11 +75,36 @@ alloc_graph (int64_t nedge)
   return 0;
 }
 
+/* Release a plain CSR unless it is mapped from the graph cache. */
+static void
+free_csr (int64_t *off, int64_t *adjstore)
+{
+  if (!csr_mapped) {
+    xfree_large (adjstore);
+    xfree_large (off);
+  }
+  csr_mapped = 0;
+}
+
 static void
 free_graph (void)
 {
-  xfree_large (xadjstore);
-  xfree_large (xoff);
+  free_csr (xoff, xadjstore);
+  if (newid) {
+    xfree_large (oldid);
+    xfree_large (newid);
+    newid = oldid = NULL;
+  }
+  if (batch_level) {
+    xfree_large (batch_level);
+    batch_level = NULL;
+  }
+  if (zadj) {
+    xfree_large (zadj);
+    xfree_large (zoff);
+    zadj = NULL;
+    zoff = NULL;
+  }
 }
 
 #define XOFF(k) (xoff[2*(k)])
@@ -101,6 +145,34 @@ prefix_sum (int64_t *buf)
   return buf[nt-1];
 }
 
+/* Turn the vertex degrees in XOFF into padded offsets and allocate
+   xadj.  Called by every thread of a parallel region. */
+static void
+setup_off_from_deg (int64_t *buf, int *err)
+{
+  int64_t k, accum;
+
+  OMP("omp for")
+    for (k = 0; k < nv; ++k)
+      if (XOFF(k) < MINVECT_SIZE) XOFF(k) = MINVECT_SIZE;
+
+  accum = prefix_sum (buf);
+
+  OMP("omp for")
+    for (k = 0; k < nv; ++k)
+      XENDOFF(k) = XOFF(k);
+  OMP("omp single") {
+    XOFF(nv) = accum;
+    if (!(xadjstore = xmalloc_large_ext ((XOFF(nv) + MINVECT_SIZE) * sizeof (*xadjstore))))
+      *err = -1;
+    if (!*err) {
+      xadj = &xadjstore[MINVECT_SIZE]; /* Cheat and permit xadj[-1] to work. */
+      for (k = 0; k < XOFF(nv) + MINVECT_SIZE; ++k)
+	xadjstore[k] = -1;
+    }
+  }
+}
+
 static int
 setup_deg_off (const struct packed_edge * restrict IJ, int64_t nedge)
 {
@@ -108,7 +180,7 @@ setup_deg_off (const struct packed_edge * restrict IJ, int64_t nedge)
   int64_t *buf = NULL;
   xadj = NULL;
   OMP("omp parallel") {
-    int64_t k, accum;
+    int64_t k;
     OMP("omp for")
       for (k = 0; k < 2*nv+2; ++k)
 	xoff[k] = 0;
@@ -132,25 +204,7 @@ setup_deg_off (const struct packed_edge * restrict IJ, int64_t nedge)
 	abort ();
       }
     }
-    OMP("omp for")
-      for (k = 0; k < nv; ++k)
-	if (XOFF(k) < MINVECT_SIZE) XOFF(k) = MINVECT_SIZE;
-
-    accum = prefix_sum (buf);
-
-    OMP("omp for")
-      for (k = 0; k < nv; ++k)
-	XENDOFF(k) = XOFF(k);
-    OMP("omp single") {
-      XOFF(nv) = accum;
-      if (!(xadjstore = xmalloc_large_ext ((XOFF(nv) + MINVECT_SIZE) * sizeof (*xadjstore))))
-	err = -1;
-      if (!err) {
-	xadj = &xadjstore[MINVECT_SIZE]; /* Cheat and permit xadj[-1] to work. */
-	for (k = 0; k < XOFF(nv) + MINVECT_SIZE; ++k)
-	  xadjstore[k] = -1;
-      }
-    }
+    setup_off_from_deg (buf, &err);
   }
   return !xadj;
 }
@@ -219,19 +273,475 @@ gather_edges (const struct packed_edge * restrict IJ, int64_t nedge)
   }
 }
 
-int 
-create_graph_from_edgelist (struct packed_edge *IJ, int64_t nedge)
+/*
+  Sort-based construction: both directions of every edge are packed
+  into a (source, destination) key and radix sorted with per-thread
+  digit histograms, so no atomics are needed.  Each source's run of
+  the sorted keys is then owned by one thread, which counts and emits
+  the deduplicated neighbors straight into xadj in sorted order.
+*/
+
+#define RADIX_BITS 11
+#define RADIX (1 << RADIX_BITS)
+
+/* Static block of [0, n) for the calling thread. */
+static void
+thread_slice (int64_t n, int64_t *begin, int64_t *end)
+{
+  const int nt = omp_get_num_threads ();
+  const int tid = omp_get_thread_num ();
+  const int64_t t1 = n / nt, t2 = n % nt;
+  *begin = t1 * tid + (tid < t2? tid : t2);
+  *end = t1 * (tid+1) + ((tid+1) < t2? (tid+1) : t2);
+}
+
+static int
+sort_edges (const struct packed_edge * restrict IJ, int64_t nedge)
+{
+  int err = 0;
+  int nt = 1;
+  int lgnv = 0, npass;
+  int64_t nkey = 0;
+  int64_t *buf = NULL;
+  int64_t * restrict hist = NULL;
+  uint64_t * restrict key = NULL;
+  uint64_t * restrict tmp = NULL;
+
+  while (((int64_t)1 << lgnv) < nv) ++lgnv;
+  npass = (2*lgnv + RADIX_BITS - 1) / RADIX_BITS;
+  xadj = NULL;
+
+  OMP("omp parallel")
+    OMP("omp single")
+      nt = omp_get_num_threads ();
+  buf = alloca (nt * sizeof (*buf));
+  hist = xmalloc (nt * RADIX * sizeof (*hist));
+
+  /* Count the non-self edges in each thread's block. */
+  OMP("omp parallel") {
+    const int tid = omp_get_thread_num ();
+    int64_t k, kb, ke, cnt = 0;
+    thread_slice (nedge, &kb, &ke);
+    for (k = kb; k < ke; ++k) {
+      const int64_t i = get_v0_from_edge(&IJ[k]);
+      const int64_t j = get_v1_from_edge(&IJ[k]);
+      if (i >= 0 && j >= 0 && i != j) ++cnt;
+    }
+    buf[tid] = cnt;
+    OMP("omp barrier");
+    OMP("omp single") {
+      int t;
+      for (t = 1; t < nt; ++t)
+	buf[t] += buf[t-1];
+      nkey = 2 * buf[nt-1];
+      key = xmalloc_large_ext (nkey * sizeof (*key));
+      tmp = xmalloc_large_ext (nkey * sizeof (*tmp));
+    }
+    if (key && tmp) {
+      /* Pack both directions, keeping the edge order. */
+      int64_t where = 2 * (tid? buf[tid-1] : 0);
+      for (k = kb; k < ke; ++k) {
+	const int64_t i = get_v0_from_edge(&IJ[k]);
+	const int64_t j = get_v1_from_edge(&IJ[k]);
+	if (i >= 0 && j >= 0 && i != j) {
+	  key[where++] = ((uint64_t)i << lgnv) | (uint64_t)j;
+	  key[where++] = ((uint64_t)j << lgnv) | (uint64_t)i;
+	}
+      }
+    }
+  }
+  if (!key || !tmp) {
+    if (tmp) xfree_large (tmp);
+    if (key) xfree_large (key);
+    free (hist);
+    return -1;
+  }
+
+  /* LSD radix sort on the packed keys. */
+  OMP("omp parallel") {
+    const int tid = omp_get_thread_num ();
+    int64_t * restrict myhist = &hist[tid * RADIX];
+    int64_t k, kb, ke;
+    int pass;
+    thread_slice (nkey, &kb, &ke);
+    for (pass = 0; pass < npass; ++pass) {
+      const int shift = pass * RADIX_BITS;
+      int d;
+      for (d = 0; d < RADIX; ++d)
+	myhist[d] = 0;
+      for (k = kb; k < ke; ++k)
+	++myhist[(key[k] >> shift) & (RADIX-1)];
+      OMP("omp barrier");
+      OMP("omp single") {
+	/* Digit-major, thread-minor offsets keep the sort stable. */
+	int64_t accum = 0;
+	int t;
+	for (d = 0; d < RADIX; ++d)
+	  for (t = 0; t < nt; ++t) {
+	    const int64_t c = hist[t * RADIX + d];
+	    hist[t * RADIX + d] = accum;
+	    accum += c;
+	  }
+      }
+      for (k = kb; k < ke; ++k)
+	tmp[myhist[(key[k] >> shift) & (RADIX-1)]++] = key[k];
+      OMP("omp barrier");
+      OMP("omp single") {
+	uint64_t * restrict t = key;
+	key = tmp;
+	tmp = t;
+      }
+    }
+  }
+  xfree_large (tmp);
+  free (hist);
+
+  /* Count unique neighbors per source and fill xadj. */
+  OMP("omp parallel") {
+    const uint64_t mask = ((uint64_t)1 << lgnv) - 1;
+    int64_t k, kb, ke;
+
+    OMP("omp for")
+      for (k = 0; k < 2*nv+2; ++k)
+	xoff[k] = 0;
+
+    /* Move the block edges to the start of a source's run so every
+       source belongs to exactly one thread. */
+    thread_slice (nkey, &kb, &ke);
+    while (kb > 0 && kb < nkey && (key[kb] >> lgnv) == (key[kb-1] >> lgnv))
+      ++kb;
+    while (ke > 0 && ke < nkey && (key[ke] >> lgnv) == (key[ke-1] >> lgnv))
+      ++ke;
+
+    for (k = kb; k < ke; ++k)
+      if (k == 0 || key[k] != key[k-1])
+	++XOFF(key[k] >> lgnv);
+    OMP("omp barrier");
+
+    setup_off_from_deg (buf, &err);
+
+    if (!err)
+      for (k = kb; k < ke; ++k)
+	if (k == 0 || key[k] != key[k-1])
+	  xadj[XENDOFF(key[k] >> lgnv)++] = key[k] & mask;
+  }
+  xfree_large (key);
+
+  return !xadj;
+}
+
+static void
+count_adj (void)
+{
+  int64_t v, accum = 0;
+  OMP("omp parallel for reduction(+:accum)")
+    for (v = 0; v < nv; ++v)
+      accum += XENDOFF(v) - XOFF(v);
+  nadj = accum;
+}
+
+/*
+  Renumber the vertices by non-increasing degree, ties in original
+  order, so the hubs that every BFS level touches share cache lines
+  in bfs_tree and the frontier bitmaps.  The graph is rebuilt in the
+  new ids with each adjacency list sorted again; make_bfs_tree maps
+  roots in and parents back out through newid/oldid.
+*/
+static int
+relabel_vertices (void)
+{
+  const double t0 = omp_get_wtime ();
+  int64_t * restrict oldxoff = xoff;
+  int64_t * restrict oldxadjstore = xadjstore;
+  int64_t * restrict oldxadj = xadj;
+  int64_t * restrict nid, * restrict oid;
+  int64_t *buf = NULL, *bucket;
+  int64_t v, d, maxdeg = 0;
+  int err = 0;
+
+#define OLDXOFF(k) (oldxoff[2*(k)])
+#define OLDXENDOFF(k) (oldxoff[1+2*(k)])
+
+  nid = xmalloc_large (nv * sizeof (*nid));
+  oid = xmalloc_large (nv * sizeof (*oid));
+  if (!nid || !oid) {
+    if (oid) xfree_large (oid);
+    if (nid) xfree_large (nid);
+    return -1;
+  }
+
+  OMP("omp parallel for reduction(max:maxdeg)")
+    for (v = 0; v < nv; ++v)
+      if (OLDXENDOFF(v) - OLDXOFF(v) > maxdeg)
+	maxdeg = OLDXENDOFF(v) - OLDXOFF(v);
+
+  /* Counting sort by degree, highest first. */
+  bucket = xmalloc ((maxdeg+2) * sizeof (*bucket));
+  for (d = 0; d < maxdeg+2; ++d)
+    bucket[d] = 0;
+  for (v = 0; v < nv; ++v)
+    ++bucket[maxdeg - (OLDXENDOFF(v) - OLDXOFF(v)) + 1];
+  for (d = 1; d < maxdeg+2; ++d)
+    bucket[d] += bucket[d-1];
+  for (v = 0; v < nv; ++v) {
+    const int64_t w = bucket[maxdeg - (OLDXENDOFF(v) - OLDXOFF(v))]++;
+    nid[v] = w;
+    oid[w] = v;
+  }
+  free (bucket);
+
+  /* The CSR helpers work on the globals; the old graph is put back
+     below if the new one cannot be built. */
+  xoff = xmalloc_large_ext (sz);
+  xadjstore = xadj = NULL;
+  if (!xoff) {
+    xoff = oldxoff;
+    xadjstore = oldxadjstore;
+    xadj = oldxadj;
+    xfree_large (oid);
+    xfree_large (nid);
+    return -1;
+  }
+
+  OMP("omp parallel") {
+    int64_t k;
+    OMP("omp for")
+      for (k = 0; k < 2*nv+2; ++k)
+	xoff[k] = 0;
+    OMP("omp for")
+      for (k = 0; k < nv; ++k)
+	XOFF(k) = OLDXENDOFF(oid[k]) - OLDXOFF(oid[k]);
+    OMP("omp single") {
+      buf = alloca (omp_get_num_threads () * sizeof (*buf));
+      if (!buf) {
+	perror ("alloca for prefix-sum hosed");
+	abort ();
+      }
+    }
+
+    setup_off_from_deg (buf, &err);
+
+    if (!err) {
+      OMP("omp for schedule(dynamic, 64)")
+	for (k = 0; k < nv; ++k) {
+	  const int64_t o = oid[k];
+	  int64_t vo;
+	  for (vo = OLDXOFF(o); vo < OLDXENDOFF(o); ++vo)
+	    xadj[XENDOFF(k)++] = nid[oldxadj[vo]];
+	  qsort (&xadj[XOFF(k)], XENDOFF(k)-XOFF(k), sizeof(*xadj), i64cmp);
+	}
+    }
+  }
+
+#undef OLDXOFF
+#undef OLDXENDOFF
+
+  if (err) {
+    xfree_large (xoff);
+    xoff = oldxoff;
+    xadjstore = oldxadjstore;
+    xadj = oldxadj;
+    xfree_large (oid);
+    xfree_large (nid);
+    return -1;
+  }
+
+  free_csr (oldxoff, oldxadjstore);
+  newid = nid;
+  oldid = oid;
+
+  relabel_time = omp_get_wtime () - t0;
+  return 0;
+}
+
+static int
+varint_len (uint64_t x)
+{
+  int n = 1;
+  while (x >= 0x80) {
+    x >>= 7;
+    ++n;
+  }
+  return n;
+}
+
+static uint8_t *
+varint_encode (uint8_t *p, uint64_t x)
+{
+  while (x >= 0x80) {
+    *p++ = (uint8_t)(x & 0x7f) | 0x80;
+    x >>= 7;
+  }
+  *p++ = (uint8_t)x;
+  return p;
+}
+
+static inline int64_t
+varint_decode (const uint8_t **pp)
+{
+  const uint8_t *p = *pp;
+  uint64_t x = 0;
+  int shift = 0;
+  uint8_t b;
+  do {
+    b = *p++;
+    x |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  *pp = p;
+  return x;
+}
+
+static inline int64_t
+vtx_degree (int64_t v)
+{
+  if (zadj) {
+    const uint8_t *zp = &zadj[zoff[v]];
+    return varint_decode (&zp);
+  }
+  return XENDOFF(v) - XOFF(v);
+}
+
+/*
+  Delta-encode the sorted adjacency lists into zadj and release xoff
+  and xadj.  Sized in one pass and encoded in a second, both parallel
+  over vertices.
+*/
+static int
+compress_adj (void)
+{
+  int64_t v;
+
+  zoff = xmalloc_large ((nv+1) * sizeof (*zoff));
+  if (!zoff) return -1;
+
+  OMP("omp parallel for schedule(dynamic, 256)")
+    for (v = 0; v < nv; ++v) {
+      int64_t vo, prev = 0, len = varint_len (XENDOFF(v) - XOFF(v));
+      for (vo = XOFF(v); vo < XENDOFF(v); ++vo) {
+	len += varint_len (xadj[vo] - prev);
+	prev = xadj[vo];
+      }
+      zoff[v+1] = len;
+    }
+  zoff[0] = 0;
+  for (v = 0; v < nv; ++v)
+    zoff[v+1] += zoff[v];
+
+  zadj = xmalloc_large_ext (zoff[nv]);
+  if (!zadj) {
+    xfree_large (zoff);
+    zoff = NULL;
+    return -1;
+  }
+
+  OMP("omp parallel for schedule(dynamic, 256)")
+    for (v = 0; v < nv; ++v) {
+      uint8_t *p = &zadj[zoff[v]];
+      int64_t vo, prev = 0;
+      p = varint_encode (p, XENDOFF(v) - XOFF(v));
+      for (vo = XOFF(v); vo < XENDOFF(v); ++vo) {
+	p = varint_encode (p, xadj[vo] - prev);
+	prev = xadj[vo];
+      }
+    }
+
+  if (VERBOSE)
+    fprintf (stderr, "Compressed adjacency from %" PRId64 " to %" PRId64 " bytes...",
+	     (int64_t)((XOFF(nv) + MINVECT_SIZE + 2*nv+2) * sizeof (*xadj)),
+	     (int64_t)(zoff[nv] + (nv+1) * sizeof (*zoff)));
+
+  free_csr (xoff, xadjstore);
+  xadjstore = xadj = xoff = NULL;
+  return 0;
+}
+
+int
+build_graph_csr (struct packed_edge *IJ, int64_t nedge)
 {
   find_nv (IJ, nedge);
   if (alloc_graph (nedge)) return -1;
-  if (setup_deg_off (IJ, nedge)) {
-    xfree_large (xoff);
+  if (sort_csr) {
+    if (sort_edges (IJ, nedge)) {
+      xfree_large (xoff);
+      return -1;
+    }
+  } else {
+    if (setup_deg_off (IJ, nedge)) {
+      xfree_large (xoff);
+      return -1;
+    }
+    gather_edges (IJ, nedge);
+  }
+  return 0;
+}
+
+int
+finish_graph_csr (void)
+{
+  count_adj ();
+  if (relabel_vtx && relabel_vertices ()) {
+    free_graph ();
+    return -1;
+  }
+  if (compressed_csr && compress_adj ()) {
+    free_graph ();
     return -1;
   }
-  gather_edges (IJ, nedge);
   return 0;
 }
 
+int 
+create_graph_from_edgelist (struct packed_edge *IJ, int64_t nedge)
+{
+  if (build_graph_csr (IJ, nedge)) return -1;
+  return finish_graph_csr ();
+}
+
+void
+get_graph_csr (int64_t *nv_out, int64_t **xoff_out, int64_t *nxoff,
+	       int64_t **xadj_out, int64_t *nxadj)
+{
+  *nv_out = nv;
+  *xoff_out = xoff;
+  *nxoff = 2*nv+2;
+  *xadj_out = xadjstore;
+  *nxadj = XOFF(nv) + MINVECT_SIZE;
+}
+
+int
+set_graph_csr (int64_t nv_in, int64_t *xoff_in, int64_t nxoff,
+	       int64_t *xadj_in, int64_t nxadj)
+{
+  if (nxoff != 2*nv_in+2 || nxadj != xoff_in[2*nv_in] + MINVECT_SIZE)
+    return -1;
+  nv = nv_in;
+  maxvtx = nv - 1;
+  sz = (2*nv+2) * sizeof (*xoff);
+  xoff = xoff_in;
+  xadjstore = xadj_in;
+  xadj = &xadjstore[MINVECT_SIZE];
+  csr_mapped = 1;
+  return 0;
+}
+
+#define THREAD_BUF_LEN 16384
+
+#define BITMAP_WORDS(n) (((n) + 63) / 64)
+#define BITMAP_BIT(k) (((uint64_t)1) << ((k) % 64))
+#define BITMAP_TEST(bm, k) ((bm)[(k) / 64] & BITMAP_BIT(k))
+
+/* Append the thread's buffered vertices to the shared queue. */
+static void
+flush_vlist (int64_t * restrict vlist, int64_t *k2,
+	     const int64_t *nbuf, int64_t kbuf)
+{
+  int64_t voff = int64_fetch_add (k2, kbuf), vk;
+  assert (voff + kbuf <= nv);
+  for (vk = 0; vk < kbuf; ++vk)
+    vlist[voff + vk] = nbuf[vk];
+}
+
 int
 make_bfs_tree (int64_t *bfs_tree_out, int64_t *max_vtx_out,
 	       int64_t srcvtx)
@@ -240,20 +750,51 @@ make_bfs_tree (int64_t *bfs_tree_out, int64_t *max_vtx_out,
   int err = 0;
 
   int64_t * restrict vlist = NULL;
+  uint64_t * restrict frontier = NULL;
+  uint64_t * restrict next = NULL;
+  const int64_t nword = BITMAP_WORDS(nv);
   int64_t k1, k2;
+  /* Frontier vertex and edge counts, the same for the level being
+     built, and the edges not yet reached from any visited vertex. */
+  int64_t nf, mf, nf_next, mf_next, mu, nf_prev;
+  int bottom_up = 0, to_bottom_up = 0, to_top_down = 0;
 
   *max_vtx_out = maxvtx;
 
+  if (newid) {
+    /* Search in the relabeled ids, map the tree back at the end. */
+    srcvtx = newid[srcvtx];
+    bfs_tree = xmalloc_large (nv * sizeof (*bfs_tree));
+    if (!bfs_tree) return -1;
+  }
+
   vlist = xmalloc_large (nv * sizeof (*vlist));
-  if (!vlist) return -1;
+  if (!vlist) {
+    if (newid) xfree_large (bfs_tree);
+    return -1;
+  }
+  if (bfs_alpha > 0) {
+    frontier = xmalloc_large (nword * sizeof (*frontier));
+    next = xmalloc_large (nword * sizeof (*next));
+    if (!frontier || !next) {
+      if (next) xfree_large (next);
+      if (frontier) xfree_large (frontier);
+      xfree_large (vlist);
+      if (newid) xfree_large (bfs_tree);
+      return -1;
+    }
+  }
 
   vlist[0] = srcvtx;
   k1 = 0; k2 = 1;
   bfs_tree[srcvtx] = srcvtx;
+  nf_prev = 0;
+  nf = 1;
+  mf = vtx_degree (srcvtx);
+  mu = nadj - mf;
+  nf_next = mf_next = 0;
 
-#define THREAD_BUF_LEN 16384
-
-  OMP("omp parallel shared(k1, k2)") {
+  OMP("omp parallel shared(k1, k2, nf, mf, nf_next, mf_next, mu, nf_prev, bottom_up, to_bottom_up, to_top_down, frontier, next)") {
     int64_t k;
     int64_t nbuf[THREAD_BUF_LEN];
     OMP("omp for")
@@ -263,50 +804,304 @@ make_bfs_tree (int64_t *bfs_tree_out, int64_t *max_vtx_out,
       for (k = srcvtx+1; k < nv; ++k)
 	bfs_tree[k] = -1;
 
-    while (k1 != k2) {
-      const int64_t oldk2 = k2;
-      int64_t kbuf = 0;
-      OMP("omp barrier");
-      OMP("omp for")
-	for (k = k1; k < oldk2; ++k) {
-	  const int64_t v = vlist[k];
-	  const int64_t veo = XENDOFF(v);
-	  int64_t vo;
-	  for (vo = XOFF(v); vo < veo; ++vo) {
-	    const int64_t j = xadj[vo];
-	    if (bfs_tree[j] == -1) {
-	      if (int64_cas (&bfs_tree[j], -1, v)) {
-		if (kbuf < THREAD_BUF_LEN) {
-		  nbuf[kbuf++] = j;
-		} else {
-		  int64_t voff = int64_fetch_add (&k2, THREAD_BUF_LEN), vk;
-		  assert (voff + THREAD_BUF_LEN <= nv);
-		  for (vk = 0; vk < THREAD_BUF_LEN; ++vk)
-		    vlist[voff + vk] = nbuf[vk];
-		  nbuf[0] = j;
-		  kbuf = 1;
+    while (nf) {
+      int64_t kbuf = 0, tnf = 0, tmf = 0;
+
+      /* Pick the direction of this level. */
+      OMP("omp single") {
+	to_bottom_up = !bottom_up && frontier && mf > mu / bfs_alpha;
+	to_top_down = bottom_up && nf < nf_prev && nf < nv / bfs_beta;
+	if (to_bottom_up || to_top_down)
+	  bottom_up = !bottom_up;
+      }
+
+      if (to_bottom_up) {
+	/* Queue [k1, k2) to frontier bitmap. */
+	OMP("omp for")
+	  for (k = 0; k < nword; ++k)
+	    frontier[k] = 0;
+	OMP("omp for")
+	  for (k = k1; k < k2; ++k)
+	    uint64_fetch_or (&frontier[vlist[k] / 64], BITMAP_BIT(vlist[k]));
+	OMP("omp single")
+	  k1 = k2;
+      } else if (to_top_down) {
+	/* Frontier bitmap to queue, appended at k1 == k2. */
+	OMP("omp for")
+	  for (k = 0; k < nword; ++k) {
+	    uint64_t w = frontier[k];
+	    while (w) {
+	      const int64_t v = 64*k + __builtin_ctzll (w);
+	      w &= w - 1;
+	      if (kbuf == THREAD_BUF_LEN) {
+		flush_vlist (vlist, &k2, nbuf, kbuf);
+		kbuf = 0;
+	      }
+	      nbuf[kbuf++] = v;
+	    }
+	  }
+	if (kbuf) flush_vlist (vlist, &k2, nbuf, kbuf);
+	kbuf = 0;
+	OMP("omp barrier");
+      }
+
+      if (!bottom_up) {
+	const int64_t oldk2 = k2;
+	OMP("omp barrier");
+	OMP("omp for")
+	  for (k = k1; k < oldk2; ++k) {
+	    const int64_t v = vlist[k];
+#define TD_VISIT(j)							\
+	    do {							\
+	      if (bfs_tree[j] == -1 && int64_cas (&bfs_tree[j], -1, v)) { \
+		++tnf;							\
+		tmf += vtx_degree (j);					\
+		if (kbuf == THREAD_BUF_LEN) {				\
+		  flush_vlist (vlist, &k2, nbuf, kbuf);			\
+		  kbuf = 0;						\
+		}							\
+		nbuf[kbuf++] = j;					\
+	      }								\
+	    } while (0)
+	    if (zadj) {
+	      const uint8_t *zp = &zadj[zoff[v]];
+	      const int64_t deg = varint_decode (&zp);
+	      int64_t e, j = 0;
+	      for (e = 0; e < deg; ++e) {
+		j += varint_decode (&zp);
+		TD_VISIT(j);
+	      }
+	    } else {
+	      const int64_t veo = XENDOFF(v);
+	      int64_t vo;
+	      for (vo = XOFF(v); vo < veo; ++vo) {
+		const int64_t j = xadj[vo];
+		TD_VISIT(j);
+	      }
+	    }
+#undef TD_VISIT
+	  }
+	if (kbuf) flush_vlist (vlist, &k2, nbuf, kbuf);
+	OMP("omp barrier");
+	OMP("omp single")
+	  k1 = oldk2;
+      } else {
+	/* Each unvisited vertex looks for a parent in the frontier.
+	   Threads own whole bitmap words, so no atomics are needed. */
+	OMP("omp for schedule(dynamic, 64)")
+	  for (k = 0; k < nword; ++k) {
+	    const int64_t vend = (64*(k+1) < nv ? 64*(k+1) : nv);
+	    uint64_t w = 0;
+	    int64_t v;
+	    for (v = 64*k; v < vend; ++v) {
+	      if (bfs_tree[v] != -1) continue;
+	      if (zadj) {
+		const uint8_t *zp = &zadj[zoff[v]];
+		const int64_t deg = varint_decode (&zp);
+		int64_t e, j = 0;
+		for (e = 0; e < deg; ++e) {
+		  j += varint_decode (&zp);
+		  if (BITMAP_TEST(frontier, j)) {
+		    bfs_tree[v] = j;
+		    w |= BITMAP_BIT(v);
+		    ++tnf;
+		    tmf += deg;
+		    break;
+		  }
+		}
+	      } else {
+		const int64_t veo = XENDOFF(v);
+		int64_t vo;
+		for (vo = XOFF(v); vo < veo; ++vo) {
+		  const int64_t j = xadj[vo];
+		  if (BITMAP_TEST(frontier, j)) {
+		    bfs_tree[v] = j;
+		    w |= BITMAP_BIT(v);
+		    ++tnf;
+		    tmf += veo - XOFF(v);
+		    break;
+		  }
 		}
 	      }
 	    }
+	    next[k] = w;
 	  }
+	OMP("omp single") {
+	  uint64_t * restrict t = frontier;
+	  frontier = next;
+	  next = t;
 	}
-      if (kbuf) {
-	int64_t voff = int64_fetch_add (&k2, kbuf), vk;
-	assert (voff + kbuf <= nv);
-	for (vk = 0; vk < kbuf; ++vk)
-	  vlist[voff + vk] = nbuf[vk];
       }
-      OMP("omp single")
-	k1 = oldk2;
+
+      int64_fetch_add (&nf_next, tnf);
+      int64_fetch_add (&mf_next, tmf);
       OMP("omp barrier");
+      OMP("omp single") {
+	nf_prev = nf;
+	nf = nf_next;
+	mf = mf_next;
+	mu -= mf;
+	nf_next = mf_next = 0;
+      }
     }
   }
 
+  if (next) xfree_large (next);
+  if (frontier) xfree_large (frontier);
   xfree_large (vlist);
 
+  if (newid) {
+    int64_t k;
+    OMP("omp parallel for")
+      for (k = 0; k < nv; ++k) {
+	const int64_t p = bfs_tree[newid[k]];
+	bfs_tree_out[k] = (p < 0 ? p : oldid[p]);
+      }
+    xfree_large (bfs_tree);
+  }
+
+  return err;
+}
+
+/*
+  Multi-source BFS: bit i of a vertex's mask stands for root i.  Each
+  level runs bottom-up, so every unfinished vertex reads its adjacency
+  once for all roots, ORs in the neighbors' visit masks, and owns its
+  own seen/next words without atomics.
+*/
+int
+make_bfs_batch (int64_t *max_vtx_out, const int64_t *srcvtx, int nsrc)
+{
+  uint64_t * restrict seen = NULL;
+  uint64_t * restrict visit = NULL;
+  uint64_t * restrict next = NULL;
+  const uint64_t all = (nsrc == 64 ? ~(uint64_t)0 : (((uint64_t)1) << nsrc) - 1);
+  int64_t level = 0, active = 1;
+  int i, err = 0;
+
+  assert (nsrc > 0 && nsrc <= BFS_BATCH_max);
+  if (zadj) return -1; /* Not supported on the compressed graph. */
+  *max_vtx_out = maxvtx;
+
+  if (batch_level) xfree_large (batch_level);
+  batch_nsrc = nsrc;
+  batch_level = xmalloc_large (nv * nsrc * sizeof (*batch_level));
+  seen = xmalloc_large (nv * sizeof (*seen));
+  visit = xmalloc_large (nv * sizeof (*visit));
+  next = xmalloc_large (nv * sizeof (*next));
+  if (!batch_level || !seen || !visit || !next) {
+    if (next) xfree_large (next);
+    if (visit) xfree_large (visit);
+    if (seen) xfree_large (seen);
+    if (batch_level) xfree_large (batch_level);
+    batch_level = NULL;
+    return -1;
+  }
+
+  OMP("omp parallel") {
+    int64_t k;
+    OMP("omp for")
+      for (k = 0; k < nv; ++k)
+	seen[k] = visit[k] = 0;
+    OMP("omp for")
+      for (k = 0; k < nv * nsrc; ++k)
+	batch_level[k] = BATCH_UNREACHED;
+  }
+
+  for (i = 0; i < nsrc; ++i) {
+    const int64_t s = (newid ? newid[srcvtx[i]] : srcvtx[i]);
+    seen[s] |= ((uint64_t)1) << i;
+    visit[s] |= ((uint64_t)1) << i;
+    batch_level[s * nsrc + i] = 0;
+  }
+
+  while (active) {
+    if (level + 1 >= BATCH_UNREACHED) {
+      fprintf (stderr, "Batched BFS is limited to %d levels.\n", BATCH_UNREACHED - 1);
+      err = -1;
+      break;
+    }
+    active = 0;
+    OMP("omp parallel") {
+      int64_t n;
+      OMP("omp for schedule(dynamic, 256) reduction(|:active)")
+	for (n = 0; n < nv; ++n) {
+	  uint64_t want = all & ~seen[n], got = 0;
+	  if (want) {
+	    const int64_t veo = XENDOFF(n);
+	    int64_t vo;
+	    for (vo = XOFF(n); vo < veo; ++vo) {
+	      const uint64_t d = visit[xadj[vo]] & want;
+	      if (d) {
+		got |= d;
+		want &= ~d;
+		if (!want) break;
+	      }
+	    }
+	  }
+	  next[n] = got;
+	  if (got) {
+	    seen[n] |= got;
+	    active = 1;
+	    while (got) {
+	      batch_level[n * nsrc + __builtin_ctzll (got)] = level + 1;
+	      got &= got - 1;
+	    }
+	  }
+	}
+    }
+    {
+      uint64_t * restrict t = visit;
+      visit = next;
+      next = t;
+    }
+    ++level;
+  }
+
+  xfree_large (next);
+  xfree_large (visit);
+  xfree_large (seen);
+  if (err) {
+    /* Do not leave partial levels for get_bfs_batch_tree. */
+    xfree_large (batch_level);
+    batch_level = NULL;
+  }
+
   return err;
 }
 
+int
+get_bfs_batch_tree (int64_t *bfs_tree_out, int k)
+{
+  const int nsrc = batch_nsrc;
+
+  if (!batch_level || k < 0 || k >= nsrc) return -1;
+
+  /* The parent is any neighbor one level closer to the root. */
+  OMP("omp parallel") {
+    int64_t o;
+    OMP("omp for")
+      for (o = 0; o < nv; ++o) {
+	const int64_t n = (newid ? newid[o] : o);
+	const int lvl = batch_level[n * nsrc + k];
+	int64_t p = -1;
+	if (lvl == 0)
+	  p = n;
+	else if (lvl != BATCH_UNREACHED) {
+	  const int64_t veo = XENDOFF(n);
+	  int64_t vo;
+	  for (vo = XOFF(n); vo < veo; ++vo)
+	    if (batch_level[xadj[vo] * nsrc + k] == lvl - 1) {
+	      p = xadj[vo];
+	      break;
+	    }
+	}
+	bfs_tree_out[o] = (p < 0 || !newid ? p : oldid[p]);
+      }
+  }
+  return 0;
+}
+
 void
 destroy_graph (void)
 {
@@ -330,6 +1125,11 @@ int64_cas(int64_t* p, int64_t oldval, int64_t newval)
 {
   return __sync_bool_compare_and_swap (p, oldval, newval);
 }
+uint64_t
+uint64_fetch_or (uint64_t* p, uint64_t mask)
+{
+  return __sync_fetch_and_or (p, mask);
+}
 #else
 /* XXX: These are not correct, but suffice for the above uses. */
 int64_t
@@ -369,6 +1169,17 @@ int64_cas(int64_t* p, int64_t oldval, int64_t newval)
   OMP("omp flush (p)");
   return out;
 }
+uint64_t
+uint64_fetch_or (uint64_t* p, uint64_t mask)
+{
+  uint64_t t;
+  OMP("omp critical (CAS)") {
+    t = *p;
+    *p |= mask;
+  }
+  OMP("omp flush (p)");
+  return t;
+}
 #endif
 #else
 int64_t
@@ -397,4 +1208,11 @@ int64_cas(int64_t* p, int64_t oldval, int64_t newval)
   }
   return out;
 }
+uint64_t
+uint64_fetch_or (uint64_t* p, uint64_t mask)
+{
+  uint64_t t = *p;
+  *p |= mask;
+  return t;
+}
 #endif
@@ -24,6 +24,7 @@ int use_RMAT = 0;
 
 char *dumpname = NULL;
 char *rootname = NULL;
+char *cachedir = NULL;
 
 double A = A_PARAM;
 double B = B_PARAM;
@@ -35,6 +36,14 @@ int NBFS = NBFS_max;
 int64_t SCALE = default_SCALE;
 int64_t edgefactor = default_edgefactor;
 
+int64_t bfs_alpha = default_bfs_alpha;
+int64_t bfs_beta = default_bfs_beta;
+
+int sort_csr = 0;
+int relabel_vtx = 0;
+int batch_bfs = 0;
+int compressed_csr = 0;
+
 void
 get_options (int argc, char **argv) {
   extern int opterr;
@@ -48,7 +57,7 @@ get_options (int argc, char **argv) {
   if (getenv ("VERBOSE"))
     VERBOSE = 1;
 
-  while ((c = getopt (argc, argv, "v?hRs:e:A:a:B:b:C:c:D:d:Vo:r:")) != -1)
+  while ((c = getopt (argc, argv, "v?hRSlmzs:e:A:a:B:b:C:c:D:d:Vo:r:k:x:y:")) != -1)
     switch (c) {
     case 'v':
       printf ("%s version %d\n", NAME, VERSION);
@@ -60,6 +69,10 @@ get_options (int argc, char **argv) {
 	      "  v   : version\n"
 	      "  h|? : this message\n"
 	      "  R   : use R-MAT from SSCA2 (default: use Kronecker generator)\n"
+	      "  S   : build the graph by radix sorting the edge list (omp-csr)\n"
+	      "  l   : relabel vertices by degree after construction (omp-csr)\n"
+	      "  m   : run the BFS searches in batches of up to 64 roots (omp-csr)\n"
+	      "  z   : BFS over delta/varint compressed adjacency lists (omp-csr)\n"
 	      "  s   : R-MAT scale (default %" PRId64 ")\n"
 	      "  e   : R-MAT edge factor (default %" PRId64 ")\n"
 	      "  A|a : R-MAT A (default %lg) >= 0\n"
@@ -72,11 +85,16 @@ get_options (int argc, char **argv) {
 	      "  V   : Enable extra (Verbose) output\n"
 	      "  o   : Read the edge list from (or dump to) the named file\n"
 	      "  r   : Read the BFS roots from (or dump to) the named file\n"
+	      "  k   : Keep generated graphs in the named cache directory\n"
+	      "  x   : BFS top-down to bottom-up threshold alpha (default %" PRId64 ")\n"
+	      "        0 disables the bottom-up steps\n"
+	      "  y   : BFS bottom-up to top-down threshold beta (default %" PRId64 ")\n"
 	      "\n"
 	      "Outputs take the form of \"key: value\", with keys:\n"
 	      "  SCALE\n"
 	      "  edgefactor\n"
-	      "  construction_time\n"
+	      "  construction_time (sort_construction_time with -S)\n"
+	      "  relabel_time (with -l)\n"
 	      "  min_time\n"
 	      "  firstquartile_time\n"
 	      "  median_time\n"
@@ -100,7 +118,8 @@ get_options (int argc, char **argv) {
 	      "  harmonic_stddev_TEPS\n"
 	      , default_SCALE, default_edgefactor,
 	      A_PARAM, B_PARAM, C_PARAM,
-	      (1.0 - (A_PARAM + B_PARAM + C_PARAM))
+	      (1.0 - (A_PARAM + B_PARAM + C_PARAM)),
+	      default_bfs_alpha, default_bfs_beta
 	      );
       exit (EXIT_SUCCESS);
       break;
@@ -110,6 +129,18 @@ get_options (int argc, char **argv) {
     case 'R':
       use_RMAT = 1;
       break;
+    case 'S':
+      sort_csr = 1;
+      break;
+    case 'l':
+      relabel_vtx = 1;
+      break;
+    case 'm':
+      batch_bfs = 1;
+      break;
+    case 'z':
+      compressed_csr = 1;
+      break;
     case 'o':
       dumpname = strdup (optarg);
       if (!dumpname) {
@@ -148,6 +179,37 @@ get_options (int argc, char **argv) {
 	err = -1;
       }
       break;
+    case 'k':
+      cachedir = strdup (optarg);
+      if (!cachedir) {
+	fprintf (stderr, "Cannot copy graph cache directory name.\n");
+	err = 1;
+      }
+      break;
+    case 'x':
+      errno = 0;
+      bfs_alpha = strtol (optarg, NULL, 10);
+      if (errno) {
+	fprintf (stderr, "Error parsing BFS alpha %s\n", optarg);
+	err = -1;
+      }
+      if (bfs_alpha < 0) {
+	fprintf (stderr, "BFS alpha must be non-negative.\n");
+	err = -1;
+      }
+      break;
+    case 'y':
+      errno = 0;
+      bfs_beta = strtol (optarg, NULL, 10);
+      if (errno) {
+	fprintf (stderr, "Error parsing BFS beta %s\n", optarg);
+	err = -1;
+      }
+      if (bfs_beta <= 0) {
+	fprintf (stderr, "BFS beta must be positive.\n");
+	err = -1;
+      }
+      break;
     case 'A':
     case 'a':
       errno = 0;
@@ -229,6 +291,35 @@ get_options (int argc, char **argv) {
       err = -1;
     }
 
+  if (dumpname && cachedir) {
+    fprintf (stderr, "The o and k options cannot be combined.\n");
+    err = -1;
+  }
+
+  if (batch_bfs && compressed_csr) {
+    fprintf (stderr, "The m and z options cannot be combined.\n");
+    err = -1;
+  }
+
+#if !defined(SORTED_CSR)
+  if (sort_csr) {
+    fprintf (stderr, "Sorted CSR construction is not supported by this implementation.\n");
+    err = -1;
+  }
+#endif
+#if !defined(RELABEL_CSR)
+  if (relabel_vtx) {
+    fprintf (stderr, "Vertex relabeling is not supported by this implementation.\n");
+    err = -1;
+  }
+#endif
+#if !defined(COMPRESSED_CSR)
+  if (compressed_csr) {
+    fprintf (stderr, "Compressed adjacency lists are not supported by this implementation.\n");
+    err = -1;
+  }
+#endif
+
   if (err)
     exit (EXIT_FAILURE);
   if (nset == 3) {
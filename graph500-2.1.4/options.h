@@ -8,6 +8,7 @@ extern int VERBOSE;
 extern int use_RMAT;
 extern char *dumpname;
 extern char *rootname;
+extern char *cachedir;
 
 #define A_PARAM 0.57
 #define B_PARAM 0.19
@@ -25,6 +26,28 @@ extern int NBFS;
 extern int64_t SCALE;
 extern int64_t edgefactor;
 
+/* Direction-optimizing BFS: switch to bottom-up when the frontier's
+   edges exceed the unexplored edges / alpha, and back to top-down
+   when the frontier holds fewer than nvtx / beta vertices.  An alpha
+   of zero keeps the BFS purely top-down. */
+#define default_bfs_alpha ((int64_t)14)
+#define default_bfs_beta ((int64_t)24)
+
+extern int64_t bfs_alpha;
+extern int64_t bfs_beta;
+
+/* Build the CSR graph by radix sorting the edge list (omp-csr). */
+extern int sort_csr;
+
+/* Renumber vertices by degree after construction (omp-csr). */
+extern int relabel_vtx;
+
+/* Search from up to 64 roots at once (omp-csr). */
+extern int batch_bfs;
+
+/* Delta/varint compress the adjacency lists (omp-csr). */
+extern int compressed_csr;
+
 void get_options (int argc, char **argv);
 
 #endif /* OPTIONS_HEADER_ */
@@ -41,6 +41,7 @@ Domain::Domain(Int_t numRanks, Index_t colLoc,
    Index_t edgeElems = nx ;
    Index_t edgeNodes = edgeElems+1 ;
    this->cost() = cost;
+   m_colorAssembly = 0;
 
    m_tp       = tp ;
    m_numRanks = numRanks ;
@@ -109,6 +110,8 @@ Domain::Domain(Int_t numRanks, Index_t colLoc,
    // These arrays are not used if we're not threaded
    m_nodeElemStart = NULL;
    m_nodeElemCornerList = NULL;
+   m_colorElemStart = NULL;
+   m_colorElemList = NULL;
 #endif
 
    // Setup region index sets. For now, these are constant sized
@@ -116,6 +119,9 @@ Domain::Domain(Int_t numRanks, Index_t colLoc,
    // simulate effects of ALE on the lagrange solver
    CreateRegionIndexSets(nr, balance);
 
+   // Setup the arena for per-cycle temporaries (needs region sizes)
+   SetupScratchArena();
+
    // Setup symmetry nodesets
    SetupSymmetryPlanes(edgeNodes);
 
@@ -304,11 +310,116 @@ Domain::SetupThreadSupportStructures()
     }
 
     delete [] nodeElemCount ;
+
+    // color elements by the parity of their lattice position; element
+    // zidx sits at col + sizeX*(row + sizeY*plane) (see BuildMesh)
+    m_colorElemStart = new Index_t[8+1] ;
+    m_colorElemList = new Index_t[numElem()] ;
+
+    Index_t colorCount[8] ;
+    for (Int_t c=0; c < 8; ++c) {
+      colorCount[c] = 0 ;
+    }
+    for (Index_t plane=0; plane < sizeZ(); ++plane) {
+      for (Index_t row=0; row < sizeY(); ++row) {
+        for (Index_t col=0; col < sizeX(); ++col) {
+          ++colorCount[(col & 1) | ((row & 1) << 1) | ((plane & 1) << 2)] ;
+        }
+      }
+    }
+
+    m_colorElemStart[0] = 0 ;
+    for (Int_t c=1; c <= 8; ++c) {
+      m_colorElemStart[c] = m_colorElemStart[c-1] + colorCount[c-1] ;
+      colorCount[c-1] = 0 ;
+    }
+
+    Index_t zidx = 0 ;
+    for (Index_t plane=0; plane < sizeZ(); ++plane) {
+      for (Index_t row=0; row < sizeY(); ++row) {
+        for (Index_t col=0; col < sizeX(); ++col) {
+          Int_t c = (col & 1) | ((row & 1) << 1) | ((plane & 1) << 2) ;
+          m_colorElemList[m_colorElemStart[c] + colorCount[c]] = zidx ;
+          ++colorCount[c] ;
+          ++zidx ;
+        }
+      }
+    }
   }
   else {
     // These arrays are not used if we're not threaded
     m_nodeElemStart = NULL;
     m_nodeElemCornerList = NULL;
+    m_colorElemStart = NULL;
+    m_colorElemList = NULL;
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Zero a scratch sub-array of numElem*stride reals, with the same loop
+// bounds and (static) partition over elements as the loops that use it
+static void
+TouchScratch(Real_t *arr, Index_t numElem, Index_t stride)
+{
+#pragma omp parallel for firstprivate(numElem, stride)
+  for (Index_t i=0 ; i<numElem ; ++i) {
+    for (Index_t j=0 ; j<stride ; ++j) {
+      arr[i*stride + j] = Real_t(0.0) ;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+Domain::SetupScratchArena()
+{
+  // Size for the deepest nesting of temporaries in either phase.  The
+  // force phase holds sigxx/sigyy/sigzz/determ, the six hourglass arrays
+  // and the three per-corner force arrays; the element phase holds vnew
+  // plus the sixteen EOS arrays of the largest region.
+  size_t elem  = CACHE_ALIGN_REAL(size_t(numElem())) ;
+  size_t elem8 = CACHE_ALIGN_REAL(size_t(numElem())*8) ;
+  size_t maxReg = 0 ;
+  for (Int_t r=0 ; r<numReg() ; ++r) {
+    size_t regSize = CACHE_ALIGN_REAL(size_t(regElemSize(r))) ;
+    if (regSize > maxReg) {
+      maxReg = regSize ;
+    }
+  }
+  size_t forceSize = 4*elem + 9*elem8 ;
+  size_t elemSize  = elem + 16*maxReg ;
+
+  m_scratchSize = (forceSize > elemSize) ? forceSize : elemSize ;
+  m_scratchTop = 0 ;
+
+  void *ptr = NULL ;
+  if (posix_memalign(&ptr, CACHE_COHERENCE_PAD_REAL*sizeof(Real_t),
+                     m_scratchSize*sizeof(Real_t)) != 0) {
+    fprintf(stderr, "Unable to allocate scratch arena\n") ;
+#if USE_MPI
+    MPI_Abort(MPI_COMM_WORLD, ScratchError) ;
+#else
+    exit(ScratchError);
+#endif
+  }
+  m_scratch = static_cast<Real_t *>(ptr) ;
+
+  // Touch the pages from the threads that will use them.  Each sub-array
+  // of the force phase is touched with the element partition of the loops
+  // that fill it, in the order AllocateScratch carves them.  vnew of the
+  // element phase shares the placement of sigxx; the EOS arrays are sized
+  // per region and cannot match any single layout.
+  Index_t numElemLoc = numElem() ;
+  for (Int_t a=0 ; a<4 ; ++a) {
+    TouchScratch(&m_scratch[a*elem], numElemLoc, 1) ;
+  }
+  for (Int_t a=0 ; a<9 ; ++a) {
+    TouchScratch(&m_scratch[4*elem + a*elem8], numElemLoc, 8) ;
+  }
+  if (elemSize > forceSize) {
+    Index_t tail = Index_t(elemSize - forceSize) ;
+    TouchScratch(&m_scratch[forceSize], tail, 1) ;
   }
 }
 
@@ -39,6 +39,8 @@ static void PrintCommandLineOptions(char *execname, int myRank)
       printf(" -c <cost>       : Extra cost of more expensive regions (def: 1)\n");
       printf(" -f <numfiles>   : Number of files to split viz dump into (def: (np+10)/9)\n");
       printf(" -p              : Print out progress\n");
+      printf(" -a              : Threaded force assembly scatters by element color\n");
+      printf("                   instead of gathering per-corner copies\n");
       printf(" -v              : Output viz file (requires compiling with -DVIZ_MESH\n");
       printf(" -h              : This message\n");
       printf("\n\n");
@@ -114,6 +116,11 @@ void ParseCommandLineOptions(int argc, char *argv[],
             opts->showProg = 1;
             i++;
          }
+         /* -a */
+         else if (strcmp(argv[i], "-a") == 0) {
+            opts->colorAssembly = 1;
+            i++;
+         }
          /* -q */
          else if (strcmp(argv[i], "-q") == 0) {
             opts->quiet = 1;
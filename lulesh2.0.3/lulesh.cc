@@ -519,6 +519,58 @@ void SumElemStressesToNodeForces( const Real_t B[][8],
 
 /******************************************/
 
+// Threaded alternative to the per-element force copies below: process the
+// elements one color at a time, so no two threads touch the same node,
+// and add each element's forces straight into fx/fy/fz.
+static inline
+void IntegrateStressForElemsColored( Domain &domain,
+                                     Real_t *sigxx, Real_t *sigyy, Real_t *sigzz,
+                                     Real_t *determ)
+{
+  for (Int_t c=0 ; c<domain.numColors() ; ++c)
+  {
+    Index_t colorSize = domain.colorElemSize(c) ;
+    const Index_t *colorList = domain.colorElemList(c) ;
+
+#pragma omp parallel for firstprivate(colorSize)
+    for( Index_t ii=0 ; ii<colorSize ; ++ii )
+    {
+      const Index_t k = colorList[ii] ;
+      const Index_t* const elemToNode = domain.nodelist(k);
+      Real_t B[3][8] ;// shape function derivatives
+      Real_t x_local[8] ;
+      Real_t y_local[8] ;
+      Real_t z_local[8] ;
+      Real_t fx_local[8] ;
+      Real_t fy_local[8] ;
+      Real_t fz_local[8] ;
+
+      // get nodal coordinates from global arrays and copy into local arrays.
+      CollectDomainNodesToElemNodes(domain, elemToNode, x_local, y_local, z_local);
+
+      // Volume calculation involves extra work for numerical consistency
+      CalcElemShapeFunctionDerivatives(x_local, y_local, z_local,
+                                           B, &determ[k]);
+
+      CalcElemNodeNormals( B[0] , B[1], B[2],
+                            x_local, y_local, z_local );
+
+      SumElemStressesToNodeForces( B, sigxx[k], sigyy[k], sigzz[k],
+                                   fx_local, fy_local, fz_local ) ;
+
+      // no other element of this color shares these nodes
+      for( Index_t lnode=0 ; lnode<8 ; ++lnode ) {
+         Index_t gnode = elemToNode[lnode];
+         domain.fx(gnode) += fx_local[lnode];
+         domain.fy(gnode) += fy_local[lnode];
+         domain.fz(gnode) += fz_local[lnode];
+      }
+    }
+  }
+}
+
+/******************************************/
+
 static inline
 void IntegrateStressForElems( Domain &domain,
                               Real_t *sigxx, Real_t *sigyy, Real_t *sigzz,
@@ -531,18 +583,23 @@ void IntegrateStressForElems( Domain &domain,
 #endif
 
    Index_t numElem8 = numElem * 8 ;
-   Real_t *fx_elem;
-   Real_t *fy_elem;
-   Real_t *fz_elem;
+   Real_t *fx_elem = NULL ;
+   Real_t *fy_elem = NULL ;
+   Real_t *fz_elem = NULL ;
    Real_t fx_local[8] ;
    Real_t fy_local[8] ;
    Real_t fz_local[8] ;
 
+  if (numthreads > 1 && domain.colorAssembly() && domain.numColors() > 0) {
+     IntegrateStressForElemsColored(domain, sigxx, sigyy, sigzz, determ) ;
+     return ;
+  }
 
+  size_t scratchMark = domain.scratchMark() ;
   if (numthreads > 1) {
-     fx_elem = Allocate<Real_t>(numElem8) ;
-     fy_elem = Allocate<Real_t>(numElem8) ;
-     fz_elem = Allocate<Real_t>(numElem8) ;
+     fx_elem = domain.AllocateScratch(numElem8) ;
+     fy_elem = domain.AllocateScratch(numElem8) ;
+     fz_elem = domain.AllocateScratch(numElem8) ;
   }
   // loop over all elements
 
@@ -608,9 +665,7 @@ void IntegrateStressForElems( Domain &domain,
         domain.fy(gnode) = fy_tmp ;
         domain.fz(gnode) = fz_tmp ;
      }
-     Release(&fz_elem) ;
-     Release(&fy_elem) ;
-     Release(&fx_elem) ;
+     domain.ReleaseScratch(scratchMark) ;
   }
 }
 
@@ -735,6 +790,165 @@ void CalcElemFBHourglassForce(Real_t *xd, Real_t *yd, Real_t *zd,  Real_t hourga
 
 /******************************************/
 
+static inline
+void CalcElemFBHourglassForceForElem( Domain &domain, Index_t i2,
+                                      Real_t gamma[4][8], Real_t *determ,
+                                      Real_t *x8n, Real_t *y8n, Real_t *z8n,
+                                      Real_t *dvdx, Real_t *dvdy, Real_t *dvdz,
+                                      Real_t hourg,
+                                      Real_t hgfx[8], Real_t hgfy[8], Real_t hgfz[8])
+{
+   Real_t coefficient;
+
+   Real_t hourgam[8][4];
+   Real_t xd1[8], yd1[8], zd1[8] ;
+
+   const Index_t *elemToNode = domain.nodelist(i2);
+   Index_t i3=8*i2;
+   Real_t volinv=Real_t(1.0)/determ[i2];
+   Real_t ss1, mass1, volume13 ;
+   for(Index_t i1=0;i1<4;++i1){
+
+      Real_t hourmodx =
+         x8n[i3] * gamma[i1][0] + x8n[i3+1] * gamma[i1][1] +
+         x8n[i3+2] * gamma[i1][2] + x8n[i3+3] * gamma[i1][3] +
+         x8n[i3+4] * gamma[i1][4] + x8n[i3+5] * gamma[i1][5] +
+         x8n[i3+6] * gamma[i1][6] + x8n[i3+7] * gamma[i1][7];
+
+      Real_t hourmody =
+         y8n[i3] * gamma[i1][0] + y8n[i3+1] * gamma[i1][1] +
+         y8n[i3+2] * gamma[i1][2] + y8n[i3+3] * gamma[i1][3] +
+         y8n[i3+4] * gamma[i1][4] + y8n[i3+5] * gamma[i1][5] +
+         y8n[i3+6] * gamma[i1][6] + y8n[i3+7] * gamma[i1][7];
+
+      Real_t hourmodz =
+         z8n[i3] * gamma[i1][0] + z8n[i3+1] * gamma[i1][1] +
+         z8n[i3+2] * gamma[i1][2] + z8n[i3+3] * gamma[i1][3] +
+         z8n[i3+4] * gamma[i1][4] + z8n[i3+5] * gamma[i1][5] +
+         z8n[i3+6] * gamma[i1][6] + z8n[i3+7] * gamma[i1][7];
+
+      hourgam[0][i1] = gamma[i1][0] -  volinv*(dvdx[i3  ] * hourmodx +
+                                               dvdy[i3  ] * hourmody +
+                                               dvdz[i3  ] * hourmodz );
+
+      hourgam[1][i1] = gamma[i1][1] -  volinv*(dvdx[i3+1] * hourmodx +
+                                               dvdy[i3+1] * hourmody +
+                                               dvdz[i3+1] * hourmodz );
+
+      hourgam[2][i1] = gamma[i1][2] -  volinv*(dvdx[i3+2] * hourmodx +
+                                               dvdy[i3+2] * hourmody +
+                                               dvdz[i3+2] * hourmodz );
+
+      hourgam[3][i1] = gamma[i1][3] -  volinv*(dvdx[i3+3] * hourmodx +
+                                               dvdy[i3+3] * hourmody +
+                                               dvdz[i3+3] * hourmodz );
+
+      hourgam[4][i1] = gamma[i1][4] -  volinv*(dvdx[i3+4] * hourmodx +
+                                               dvdy[i3+4] * hourmody +
+                                               dvdz[i3+4] * hourmodz );
+
+      hourgam[5][i1] = gamma[i1][5] -  volinv*(dvdx[i3+5] * hourmodx +
+                                               dvdy[i3+5] * hourmody +
+                                               dvdz[i3+5] * hourmodz );
+
+      hourgam[6][i1] = gamma[i1][6] -  volinv*(dvdx[i3+6] * hourmodx +
+                                               dvdy[i3+6] * hourmody +
+                                               dvdz[i3+6] * hourmodz );
+
+      hourgam[7][i1] = gamma[i1][7] -  volinv*(dvdx[i3+7] * hourmodx +
+                                               dvdy[i3+7] * hourmody +
+                                               dvdz[i3+7] * hourmodz );
+
+   }
+
+   /* compute forces */
+   /* store forces into h arrays (force arrays) */
+
+   ss1=domain.ss(i2);
+   mass1=domain.elemMass(i2);
+   volume13=CBRT(determ[i2]);
+
+   Index_t n0si2 = elemToNode[0];
+   Index_t n1si2 = elemToNode[1];
+   Index_t n2si2 = elemToNode[2];
+   Index_t n3si2 = elemToNode[3];
+   Index_t n4si2 = elemToNode[4];
+   Index_t n5si2 = elemToNode[5];
+   Index_t n6si2 = elemToNode[6];
+   Index_t n7si2 = elemToNode[7];
+
+   xd1[0] = domain.xd(n0si2);
+   xd1[1] = domain.xd(n1si2);
+   xd1[2] = domain.xd(n2si2);
+   xd1[3] = domain.xd(n3si2);
+   xd1[4] = domain.xd(n4si2);
+   xd1[5] = domain.xd(n5si2);
+   xd1[6] = domain.xd(n6si2);
+   xd1[7] = domain.xd(n7si2);
+
+   yd1[0] = domain.yd(n0si2);
+   yd1[1] = domain.yd(n1si2);
+   yd1[2] = domain.yd(n2si2);
+   yd1[3] = domain.yd(n3si2);
+   yd1[4] = domain.yd(n4si2);
+   yd1[5] = domain.yd(n5si2);
+   yd1[6] = domain.yd(n6si2);
+   yd1[7] = domain.yd(n7si2);
+
+   zd1[0] = domain.zd(n0si2);
+   zd1[1] = domain.zd(n1si2);
+   zd1[2] = domain.zd(n2si2);
+   zd1[3] = domain.zd(n3si2);
+   zd1[4] = domain.zd(n4si2);
+   zd1[5] = domain.zd(n5si2);
+   zd1[6] = domain.zd(n6si2);
+   zd1[7] = domain.zd(n7si2);
+
+   coefficient = - hourg * Real_t(0.01) * ss1 * mass1 / volume13;
+
+   CalcElemFBHourglassForce(xd1,yd1,zd1,
+                   hourgam,
+                   coefficient, hgfx, hgfy, hgfz);
+}
+
+/******************************************/
+
+// Threaded alternative to the per-element force copies used by
+// CalcFBHourglassForceForElems: scatter one element color at a time.
+static inline
+void CalcFBHourglassForceForElemsColored( Domain &domain,
+                                          Real_t gamma[4][8], Real_t *determ,
+                                          Real_t *x8n, Real_t *y8n, Real_t *z8n,
+                                          Real_t *dvdx, Real_t *dvdy, Real_t *dvdz,
+                                          Real_t hourg)
+{
+   for (Int_t c=0 ; c<domain.numColors() ; ++c) {
+      Index_t colorSize = domain.colorElemSize(c) ;
+      const Index_t *colorList = domain.colorElemList(c) ;
+
+#pragma omp parallel for firstprivate(colorSize, hourg)
+      for(Index_t ii=0;ii<colorSize;++ii){
+         const Index_t i2 = colorList[ii] ;
+         Real_t hgfx[8], hgfy[8], hgfz[8] ;
+
+         CalcElemFBHourglassForceForElem(domain, i2, gamma, determ,
+                                         x8n, y8n, z8n, dvdx, dvdy, dvdz,
+                                         hourg, hgfx, hgfy, hgfz);
+
+         // no other element of this color shares these nodes
+         const Index_t *elemToNode = domain.nodelist(i2);
+         for(Index_t lnode=0;lnode<8;++lnode){
+            Index_t gnode = elemToNode[lnode];
+            domain.fx(gnode) += hgfx[lnode];
+            domain.fy(gnode) += hgfy[lnode];
+            domain.fz(gnode) += hgfz[lnode];
+         }
+      }
+   }
+}
+
+/******************************************/
+
 static inline
 void CalcFBHourglassForceForElems( Domain &domain,
                                    Real_t *determ,
@@ -758,14 +972,18 @@ void CalcFBHourglassForceForElems( Domain &domain,
   
    Index_t numElem8 = numElem * 8 ;
 
-   Real_t *fx_elem; 
-   Real_t *fy_elem; 
-   Real_t *fz_elem; 
+   Real_t *fx_elem = NULL ; 
+   Real_t *fy_elem = NULL ; 
+   Real_t *fz_elem = NULL ; 
+
+   bool colored = (numthreads > 1 && domain.colorAssembly() &&
+                   domain.numColors() > 0) ;
 
-   if(numthreads > 1) {
-      fx_elem = Allocate<Real_t>(numElem8) ;
-      fy_elem = Allocate<Real_t>(numElem8) ;
-      fz_elem = Allocate<Real_t>(numElem8) ;
+   size_t scratchMark = domain.scratchMark() ;
+   if(numthreads > 1 && !colored) {
+      fx_elem = domain.AllocateScratch(numElem8) ;
+      fy_elem = domain.AllocateScratch(numElem8) ;
+      fz_elem = domain.AllocateScratch(numElem8) ;
    }
 
    Real_t  gamma[4][8];
@@ -803,6 +1021,13 @@ void CalcFBHourglassForceForElems( Domain &domain,
    gamma[3][6] = Real_t( 1.);
    gamma[3][7] = Real_t(-1.);
 
+   if (colored) {
+      CalcFBHourglassForceForElemsColored(domain, gamma, determ,
+                                          x8n, y8n, z8n, dvdx, dvdy, dvdz,
+                                          hourg) ;
+      return ;
+   }
+
 /*************************************************/
 /*    compute the hourglass modes */
 
@@ -812,117 +1037,12 @@ void CalcFBHourglassForceForElems( Domain &domain,
       Real_t *fx_local, *fy_local, *fz_local ;
       Real_t hgfx[8], hgfy[8], hgfz[8] ;
 
-      Real_t coefficient;
-
-      Real_t hourgam[8][4];
-      Real_t xd1[8], yd1[8], zd1[8] ;
-
       const Index_t *elemToNode = domain.nodelist(i2);
       Index_t i3=8*i2;
-      Real_t volinv=Real_t(1.0)/determ[i2];
-      Real_t ss1, mass1, volume13 ;
-      for(Index_t i1=0;i1<4;++i1){
-
-         Real_t hourmodx =
-            x8n[i3] * gamma[i1][0] + x8n[i3+1] * gamma[i1][1] +
-            x8n[i3+2] * gamma[i1][2] + x8n[i3+3] * gamma[i1][3] +
-            x8n[i3+4] * gamma[i1][4] + x8n[i3+5] * gamma[i1][5] +
-            x8n[i3+6] * gamma[i1][6] + x8n[i3+7] * gamma[i1][7];
-
-         Real_t hourmody =
-            y8n[i3] * gamma[i1][0] + y8n[i3+1] * gamma[i1][1] +
-            y8n[i3+2] * gamma[i1][2] + y8n[i3+3] * gamma[i1][3] +
-            y8n[i3+4] * gamma[i1][4] + y8n[i3+5] * gamma[i1][5] +
-            y8n[i3+6] * gamma[i1][6] + y8n[i3+7] * gamma[i1][7];
-
-         Real_t hourmodz =
-            z8n[i3] * gamma[i1][0] + z8n[i3+1] * gamma[i1][1] +
-            z8n[i3+2] * gamma[i1][2] + z8n[i3+3] * gamma[i1][3] +
-            z8n[i3+4] * gamma[i1][4] + z8n[i3+5] * gamma[i1][5] +
-            z8n[i3+6] * gamma[i1][6] + z8n[i3+7] * gamma[i1][7];
-
-         hourgam[0][i1] = gamma[i1][0] -  volinv*(dvdx[i3  ] * hourmodx +
-                                                  dvdy[i3  ] * hourmody +
-                                                  dvdz[i3  ] * hourmodz );
-
-         hourgam[1][i1] = gamma[i1][1] -  volinv*(dvdx[i3+1] * hourmodx +
-                                                  dvdy[i3+1] * hourmody +
-                                                  dvdz[i3+1] * hourmodz );
-
-         hourgam[2][i1] = gamma[i1][2] -  volinv*(dvdx[i3+2] * hourmodx +
-                                                  dvdy[i3+2] * hourmody +
-                                                  dvdz[i3+2] * hourmodz );
-
-         hourgam[3][i1] = gamma[i1][3] -  volinv*(dvdx[i3+3] * hourmodx +
-                                                  dvdy[i3+3] * hourmody +
-                                                  dvdz[i3+3] * hourmodz );
-
-         hourgam[4][i1] = gamma[i1][4] -  volinv*(dvdx[i3+4] * hourmodx +
-                                                  dvdy[i3+4] * hourmody +
-                                                  dvdz[i3+4] * hourmodz );
-
-         hourgam[5][i1] = gamma[i1][5] -  volinv*(dvdx[i3+5] * hourmodx +
-                                                  dvdy[i3+5] * hourmody +
-                                                  dvdz[i3+5] * hourmodz );
-
-         hourgam[6][i1] = gamma[i1][6] -  volinv*(dvdx[i3+6] * hourmodx +
-                                                  dvdy[i3+6] * hourmody +
-                                                  dvdz[i3+6] * hourmodz );
-
-         hourgam[7][i1] = gamma[i1][7] -  volinv*(dvdx[i3+7] * hourmodx +
-                                                  dvdy[i3+7] * hourmody +
-                                                  dvdz[i3+7] * hourmodz );
 
-      }
-
-      /* compute forces */
-      /* store forces into h arrays (force arrays) */
-
-      ss1=domain.ss(i2);
-      mass1=domain.elemMass(i2);
-      volume13=CBRT(determ[i2]);
-
-      Index_t n0si2 = elemToNode[0];
-      Index_t n1si2 = elemToNode[1];
-      Index_t n2si2 = elemToNode[2];
-      Index_t n3si2 = elemToNode[3];
-      Index_t n4si2 = elemToNode[4];
-      Index_t n5si2 = elemToNode[5];
-      Index_t n6si2 = elemToNode[6];
-      Index_t n7si2 = elemToNode[7];
-
-      xd1[0] = domain.xd(n0si2);
-      xd1[1] = domain.xd(n1si2);
-      xd1[2] = domain.xd(n2si2);
-      xd1[3] = domain.xd(n3si2);
-      xd1[4] = domain.xd(n4si2);
-      xd1[5] = domain.xd(n5si2);
-      xd1[6] = domain.xd(n6si2);
-      xd1[7] = domain.xd(n7si2);
-
-      yd1[0] = domain.yd(n0si2);
-      yd1[1] = domain.yd(n1si2);
-      yd1[2] = domain.yd(n2si2);
-      yd1[3] = domain.yd(n3si2);
-      yd1[4] = domain.yd(n4si2);
-      yd1[5] = domain.yd(n5si2);
-      yd1[6] = domain.yd(n6si2);
-      yd1[7] = domain.yd(n7si2);
-
-      zd1[0] = domain.zd(n0si2);
-      zd1[1] = domain.zd(n1si2);
-      zd1[2] = domain.zd(n2si2);
-      zd1[3] = domain.zd(n3si2);
-      zd1[4] = domain.zd(n4si2);
-      zd1[5] = domain.zd(n5si2);
-      zd1[6] = domain.zd(n6si2);
-      zd1[7] = domain.zd(n7si2);
-
-      coefficient = - hourg * Real_t(0.01) * ss1 * mass1 / volume13;
-
-      CalcElemFBHourglassForce(xd1,yd1,zd1,
-                      hourgam,
-                      coefficient, hgfx, hgfy, hgfz);
+      CalcElemFBHourglassForceForElem(domain, i2, gamma, determ,
+                                      x8n, y8n, z8n, dvdx, dvdy, dvdz,
+                                      hourg, hgfx, hgfy, hgfz);
 
       // With the threaded version, we write into local arrays per elem
       // so we don't have to worry about race conditions
@@ -958,37 +1078,12 @@ void CalcFBHourglassForceForElems( Domain &domain,
          fz_local[7] = hgfz[7];
       }
       else {
-         domain.fx(n0si2) += hgfx[0];
-         domain.fy(n0si2) += hgfy[0];
-         domain.fz(n0si2) += hgfz[0];
-
-         domain.fx(n1si2) += hgfx[1];
-         domain.fy(n1si2) += hgfy[1];
-         domain.fz(n1si2) += hgfz[1];
-
-         domain.fx(n2si2) += hgfx[2];
-         domain.fy(n2si2) += hgfy[2];
-         domain.fz(n2si2) += hgfz[2];
-
-         domain.fx(n3si2) += hgfx[3];
-         domain.fy(n3si2) += hgfy[3];
-         domain.fz(n3si2) += hgfz[3];
-
-         domain.fx(n4si2) += hgfx[4];
-         domain.fy(n4si2) += hgfy[4];
-         domain.fz(n4si2) += hgfz[4];
-
-         domain.fx(n5si2) += hgfx[5];
-         domain.fy(n5si2) += hgfy[5];
-         domain.fz(n5si2) += hgfz[5];
-
-         domain.fx(n6si2) += hgfx[6];
-         domain.fy(n6si2) += hgfy[6];
-         domain.fz(n6si2) += hgfz[6];
-
-         domain.fx(n7si2) += hgfx[7];
-         domain.fy(n7si2) += hgfy[7];
-         domain.fz(n7si2) += hgfz[7];
+         for(Index_t lnode=0;lnode<8;++lnode){
+            Index_t gnode = elemToNode[lnode];
+            domain.fx(gnode) += hgfx[lnode];
+            domain.fy(gnode) += hgfy[lnode];
+            domain.fz(gnode) += hgfz[lnode];
+         }
       }
    }
 
@@ -1012,9 +1107,7 @@ void CalcFBHourglassForceForElems( Domain &domain,
          domain.fy(gnode) += fy_tmp ;
          domain.fz(gnode) += fz_tmp ;
       }
-      Release(&fz_elem) ;
-      Release(&fy_elem) ;
-      Release(&fx_elem) ;
+      domain.ReleaseScratch(scratchMark) ;
    }
 }
 
@@ -1026,12 +1119,13 @@ void CalcHourglassControlForElems(Domain& domain,
 {
    Index_t numElem = domain.numElem() ;
    Index_t numElem8 = numElem * 8 ;
-   Real_t *dvdx = Allocate<Real_t>(numElem8) ;
-   Real_t *dvdy = Allocate<Real_t>(numElem8) ;
-   Real_t *dvdz = Allocate<Real_t>(numElem8) ;
-   Real_t *x8n  = Allocate<Real_t>(numElem8) ;
-   Real_t *y8n  = Allocate<Real_t>(numElem8) ;
-   Real_t *z8n  = Allocate<Real_t>(numElem8) ;
+   size_t scratchMark = domain.scratchMark() ;
+   Real_t *dvdx = domain.AllocateScratch(numElem8) ;
+   Real_t *dvdy = domain.AllocateScratch(numElem8) ;
+   Real_t *dvdz = domain.AllocateScratch(numElem8) ;
+   Real_t *x8n  = domain.AllocateScratch(numElem8) ;
+   Real_t *y8n  = domain.AllocateScratch(numElem8) ;
+   Real_t *z8n  = domain.AllocateScratch(numElem8) ;
 
    /* start loop over elements */
 #pragma omp parallel for firstprivate(numElem)
@@ -1074,12 +1168,7 @@ void CalcHourglassControlForElems(Domain& domain,
                                     hgcoef, numElem, domain.numNode()) ;
    }
 
-   Release(&z8n) ;
-   Release(&y8n) ;
-   Release(&x8n) ;
-   Release(&dvdz) ;
-   Release(&dvdy) ;
-   Release(&dvdx) ;
+   domain.ReleaseScratch(scratchMark) ;
 
    return ;
 }
@@ -1092,10 +1181,11 @@ void CalcVolumeForceForElems(Domain& domain)
    Index_t numElem = domain.numElem() ;
    if (numElem != 0) {
       Real_t  hgcoef = domain.hgcoef() ;
-      Real_t *sigxx  = Allocate<Real_t>(numElem) ;
-      Real_t *sigyy  = Allocate<Real_t>(numElem) ;
-      Real_t *sigzz  = Allocate<Real_t>(numElem) ;
-      Real_t *determ = Allocate<Real_t>(numElem) ;
+      size_t scratchMark = domain.scratchMark() ;
+      Real_t *sigxx  = domain.AllocateScratch(numElem) ;
+      Real_t *sigyy  = domain.AllocateScratch(numElem) ;
+      Real_t *sigzz  = domain.AllocateScratch(numElem) ;
+      Real_t *determ = domain.AllocateScratch(numElem) ;
 
       /* Sum contributions to total stress tensor */
       InitStressTermsForElems(domain, sigxx, sigyy, sigzz, numElem);
@@ -1120,10 +1210,7 @@ void CalcVolumeForceForElems(Domain& domain)
 
       CalcHourglassControlForElems(domain, determ, hgcoef) ;
 
-      Release(&determ) ;
-      Release(&sigzz) ;
-      Release(&sigyy) ;
-      Release(&sigxx) ;
+      domain.ReleaseScratch(scratchMark) ;
    }
 }
 
@@ -2040,167 +2127,135 @@ void CalcQForElems(Domain& domain, Real_t vnew[])
 
 /******************************************/
 
+// The EOS kernels below work on region-compressed temporaries: every
+// array, including the relative volume, is gathered into its own
+// unit-stride array before the kernels run, so the loops carry no
+// indirection.  The e_cut/p_cut/q_cut clamps and the compression and
+// expansion cases are written as selects rather than branches so that
+// the loops vectorize.  The kernels are templated on the floating point
+// type so single and double precision builds take the same path.
+
+template <typename T>
 static inline
-void CalcPressureForElems(Real_t* p_new, Real_t* bvc,
-                          Real_t* pbvc, Real_t* e_old,
-                          Real_t* compression, Real_t *vnewc,
-                          Real_t pmin,
-                          Real_t p_cut, Real_t eosvmax,
-                          Index_t length, Index_t *regElemList)
+T CalcEOSSoundSpeed(T ssc)
 {
-#pragma omp parallel for firstprivate(length)
-   for (Index_t i = 0; i < length ; ++i) {
-      Real_t c1s = Real_t(2.0)/Real_t(3.0) ;
-      bvc[i] = c1s * (compression[i] + Real_t(1.));
-      pbvc[i] = c1s;
-   }
+   // Take the root of a safe argument in every lane, then pick the floor
+   // for lanes below the cutoff
+   const T sscMin = T(.1111111e-36) ;
+   bool small = (ssc <= sscMin) ;
+   T root = SQRT(small ? T(1.) : ssc) ;
+   return small ? T(.3333333e-18) : root ;
+}
 
-#pragma omp parallel for firstprivate(length, pmin, p_cut, eosvmax)
-   for (Index_t i = 0 ; i < length ; ++i){
-      Index_t elem = regElemList[i];
-      
-      p_new[i] = bvc[i] * e_old[i] ;
+/******************************************/
 
-      if    (FABS(p_new[i]) <  p_cut   )
-         p_new[i] = Real_t(0.0) ;
+template <typename T>
+static inline
+void CalcPressureForElems(T* p_new, T* bvc,
+                          T* pbvc, T* e_old,
+                          T* compression, T *vnewc,
+                          T pmin,
+                          T p_cut, T eosvmax,
+                          Index_t length)
+{
+#pragma omp parallel for simd firstprivate(length, pmin, p_cut, eosvmax)
+   for (Index_t i = 0 ; i < length ; ++i){
+      const T c1s = T(2.0)/T(3.0) ;
+      T bv = c1s * (compression[i] + T(1.)) ;
+      T p  = bv * e_old[i] ;
 
-      if    ( vnewc[elem] >= eosvmax ) /* impossible condition here? */
-         p_new[i] = Real_t(0.0) ;
+      p = (FABS(p) < p_cut)       ? T(0.0) : p ;
+      p = (vnewc[i] >= eosvmax)   ? T(0.0) : p ; /* impossible condition here? */
+      p = (p < pmin)              ? pmin   : p ;
 
-      if    (p_new[i]       <  pmin)
-         p_new[i]   = pmin ;
+      bvc[i]   = bv ;
+      pbvc[i]  = c1s ;
+      p_new[i] = p ;
    }
 }
 
 /******************************************/
 
+template <typename T>
 static inline
-void CalcEnergyForElems(Real_t* p_new, Real_t* e_new, Real_t* q_new,
-                        Real_t* bvc, Real_t* pbvc,
-                        Real_t* p_old, Real_t* e_old, Real_t* q_old,
-                        Real_t* compression, Real_t* compHalfStep,
-                        Real_t* vnewc, Real_t* work, Real_t* delvc, Real_t pmin,
-                        Real_t p_cut, Real_t  e_cut, Real_t q_cut, Real_t emin,
-                        Real_t* qq_old, Real_t* ql_old,
-                        Real_t rho0,
-                        Real_t eosvmax,
-                        Index_t length, Index_t *regElemList)
+void CalcEnergyForElems(T* p_new, T* e_new, T* q_new,
+                        T* bvc, T* pbvc,
+                        T* p_old, T* e_old, T* q_old,
+                        T* compression, T* compHalfStep,
+                        T* pHalfStep,
+                        T* vnewc, T* work, T* delvc, T pmin,
+                        T p_cut, T  e_cut, T q_cut, T emin,
+                        T* qq_old, T* ql_old,
+                        T rho0,
+                        T eosvmax,
+                        Index_t length)
 {
-   Real_t *pHalfStep = Allocate<Real_t>(length) ;
-
-#pragma omp parallel for firstprivate(length, emin)
+#pragma omp parallel for simd firstprivate(length, emin)
    for (Index_t i = 0 ; i < length ; ++i) {
-      e_new[i] = e_old[i] - Real_t(0.5) * delvc[i] * (p_old[i] + q_old[i])
-         + Real_t(0.5) * work[i];
+      T e = e_old[i] - T(0.5) * delvc[i] * (p_old[i] + q_old[i])
+         + T(0.5) * work[i];
 
-      if (e_new[i]  < emin ) {
-         e_new[i] = emin ;
-      }
+      e_new[i] = (e < emin) ? emin : e ;
    }
 
    CalcPressureForElems(pHalfStep, bvc, pbvc, e_new, compHalfStep, vnewc,
-                        pmin, p_cut, eosvmax, length, regElemList);
+                        pmin, p_cut, eosvmax, length);
 
-#pragma omp parallel for firstprivate(length, rho0)
+#pragma omp parallel for simd firstprivate(length, rho0)
    for (Index_t i = 0 ; i < length ; ++i) {
-      Real_t vhalf = Real_t(1.) / (Real_t(1.) + compHalfStep[i]) ;
-
-      if ( delvc[i] > Real_t(0.) ) {
-         q_new[i] /* = qq_old[i] = ql_old[i] */ = Real_t(0.) ;
-      }
-      else {
-         Real_t ssc = ( pbvc[i] * e_new[i]
-                 + vhalf * vhalf * bvc[i] * pHalfStep[i] ) / rho0 ;
-
-         if ( ssc <= Real_t(.1111111e-36) ) {
-            ssc = Real_t(.3333333e-18) ;
-         } else {
-            ssc = SQRT(ssc) ;
-         }
+      T vhalf = T(1.) / (T(1.) + compHalfStep[i]) ;
+      T ssc = CalcEOSSoundSpeed(( pbvc[i] * e_new[i]
+                 + vhalf * vhalf * bvc[i] * pHalfStep[i] ) / rho0) ;
 
-         q_new[i] = (ssc*ql_old[i] + qq_old[i]) ;
-      }
+      T q = (delvc[i] > T(0.)) ? T(0.) : (ssc*ql_old[i] + qq_old[i]) ;
 
-      e_new[i] = e_new[i] + Real_t(0.5) * delvc[i]
-         * (  Real_t(3.0)*(p_old[i]     + q_old[i])
-              - Real_t(4.0)*(pHalfStep[i] + q_new[i])) ;
+      q_new[i] = q ;
+      e_new[i] = e_new[i] + T(0.5) * delvc[i]
+         * (  T(3.0)*(p_old[i]     + q_old[i])
+              - T(4.0)*(pHalfStep[i] + q)) ;
    }
 
-#pragma omp parallel for firstprivate(length, emin, e_cut)
+#pragma omp parallel for simd firstprivate(length, emin, e_cut)
    for (Index_t i = 0 ; i < length ; ++i) {
+      T e = e_new[i] + T(0.5) * work[i];
 
-      e_new[i] += Real_t(0.5) * work[i];
-
-      if (FABS(e_new[i]) < e_cut) {
-         e_new[i] = Real_t(0.)  ;
-      }
-      if (     e_new[i]  < emin ) {
-         e_new[i] = emin ;
-      }
+      e = (FABS(e) < e_cut) ? T(0.) : e ;
+      e_new[i] = (e < emin) ? emin : e ;
    }
 
    CalcPressureForElems(p_new, bvc, pbvc, e_new, compression, vnewc,
-                        pmin, p_cut, eosvmax, length, regElemList);
+                        pmin, p_cut, eosvmax, length);
 
-#pragma omp parallel for firstprivate(length, rho0, emin, e_cut)
+#pragma omp parallel for simd firstprivate(length, rho0, emin, e_cut)
    for (Index_t i = 0 ; i < length ; ++i){
-      const Real_t sixth = Real_t(1.0) / Real_t(6.0) ;
-      Index_t elem = regElemList[i];
-      Real_t q_tilde ;
+      const T sixth = T(1.0) / T(6.0) ;
+      T ssc = CalcEOSSoundSpeed(( pbvc[i] * e_new[i]
+                 + vnewc[i] * vnewc[i] * bvc[i] * p_new[i] ) / rho0) ;
 
-      if (delvc[i] > Real_t(0.)) {
-         q_tilde = Real_t(0.) ;
-      }
-      else {
-         Real_t ssc = ( pbvc[i] * e_new[i]
-                 + vnewc[elem] * vnewc[elem] * bvc[i] * p_new[i] ) / rho0 ;
-
-         if ( ssc <= Real_t(.1111111e-36) ) {
-            ssc = Real_t(.3333333e-18) ;
-         } else {
-            ssc = SQRT(ssc) ;
-         }
+      T q_tilde = (delvc[i] > T(0.)) ? T(0.) : (ssc*ql_old[i] + qq_old[i]) ;
 
-         q_tilde = (ssc*ql_old[i] + qq_old[i]) ;
-      }
-
-      e_new[i] = e_new[i] - (  Real_t(7.0)*(p_old[i]     + q_old[i])
-                               - Real_t(8.0)*(pHalfStep[i] + q_new[i])
-                               + (p_new[i] + q_tilde)) * delvc[i]*sixth ;
+      T e = e_new[i] - (  T(7.0)*(p_old[i]     + q_old[i])
+                        - T(8.0)*(pHalfStep[i] + q_new[i])
+                        + (p_new[i] + q_tilde)) * delvc[i]*sixth ;
 
-      if (FABS(e_new[i]) < e_cut) {
-         e_new[i] = Real_t(0.)  ;
-      }
-      if (     e_new[i]  < emin ) {
-         e_new[i] = emin ;
-      }
+      e = (FABS(e) < e_cut) ? T(0.) : e ;
+      e_new[i] = (e < emin) ? emin : e ;
    }
 
    CalcPressureForElems(p_new, bvc, pbvc, e_new, compression, vnewc,
-                        pmin, p_cut, eosvmax, length, regElemList);
+                        pmin, p_cut, eosvmax, length);
 
-#pragma omp parallel for firstprivate(length, rho0, q_cut)
+#pragma omp parallel for simd firstprivate(length, rho0, q_cut)
    for (Index_t i = 0 ; i < length ; ++i){
-      Index_t elem = regElemList[i];
-
-      if ( delvc[i] <= Real_t(0.) ) {
-         Real_t ssc = ( pbvc[i] * e_new[i]
-                 + vnewc[elem] * vnewc[elem] * bvc[i] * p_new[i] ) / rho0 ;
+      T ssc = CalcEOSSoundSpeed(( pbvc[i] * e_new[i]
+                 + vnewc[i] * vnewc[i] * bvc[i] * p_new[i] ) / rho0) ;
 
-         if ( ssc <= Real_t(.1111111e-36) ) {
-            ssc = Real_t(.3333333e-18) ;
-         } else {
-            ssc = SQRT(ssc) ;
-         }
-
-         q_new[i] = (ssc*ql_old[i] + qq_old[i]) ;
+      T q = ssc*ql_old[i] + qq_old[i] ;
+      q = (FABS(q) < q_cut) ? T(0.) : q ;
 
-         if (FABS(q_new[i]) < q_cut) q_new[i] = Real_t(0.) ;
-      }
+      q_new[i] = (delvc[i] <= T(0.)) ? q : q_new[i] ;
    }
 
-   Release(&pHalfStep) ;
-
    return ;
 }
 
@@ -2216,15 +2271,8 @@ void CalcSoundSpeedForElems(Domain &domain,
 #pragma omp parallel for firstprivate(rho0, ss4o3)
    for (Index_t i = 0; i < len ; ++i) {
       Index_t elem = regElemList[i];
-      Real_t ssTmp = (pbvc[i] * enewc[i] + vnewc[elem] * vnewc[elem] *
-                 bvc[i] * pnewc[i]) / rho0;
-      if (ssTmp <= Real_t(.1111111e-36)) {
-         ssTmp = Real_t(.3333333e-18);
-      }
-      else {
-         ssTmp = SQRT(ssTmp);
-      }
-      domain.ss(elem) = ssTmp ;
+      domain.ss(elem) = CalcEOSSoundSpeed((pbvc[i] * enewc[i] +
+                           vnewc[i] * vnewc[i] * bvc[i] * pnewc[i]) / rho0) ;
    }
 }
 
@@ -2248,20 +2296,29 @@ void EvalEOSForElems(Domain& domain, Real_t *vnewc,
    // These temporaries will be of different size for 
    // each call (due to different sized region element
    // lists)
-   Real_t *e_old = Allocate<Real_t>(numElemReg) ;
-   Real_t *delvc = Allocate<Real_t>(numElemReg) ;
-   Real_t *p_old = Allocate<Real_t>(numElemReg) ;
-   Real_t *q_old = Allocate<Real_t>(numElemReg) ;
-   Real_t *compression = Allocate<Real_t>(numElemReg) ;
-   Real_t *compHalfStep = Allocate<Real_t>(numElemReg) ;
-   Real_t *qq_old = Allocate<Real_t>(numElemReg) ;
-   Real_t *ql_old = Allocate<Real_t>(numElemReg) ;
-   Real_t *work = Allocate<Real_t>(numElemReg) ;
-   Real_t *p_new = Allocate<Real_t>(numElemReg) ;
-   Real_t *e_new = Allocate<Real_t>(numElemReg) ;
-   Real_t *q_new = Allocate<Real_t>(numElemReg) ;
-   Real_t *bvc = Allocate<Real_t>(numElemReg) ;
-   Real_t *pbvc = Allocate<Real_t>(numElemReg) ;
+   size_t scratchMark = domain.scratchMark() ;
+   Real_t *e_old = domain.AllocateScratch(numElemReg) ;
+   Real_t *delvc = domain.AllocateScratch(numElemReg) ;
+   Real_t *p_old = domain.AllocateScratch(numElemReg) ;
+   Real_t *q_old = domain.AllocateScratch(numElemReg) ;
+   Real_t *compression = domain.AllocateScratch(numElemReg) ;
+   Real_t *compHalfStep = domain.AllocateScratch(numElemReg) ;
+   Real_t *qq_old = domain.AllocateScratch(numElemReg) ;
+   Real_t *ql_old = domain.AllocateScratch(numElemReg) ;
+   Real_t *work = domain.AllocateScratch(numElemReg) ;
+   Real_t *p_new = domain.AllocateScratch(numElemReg) ;
+   Real_t *e_new = domain.AllocateScratch(numElemReg) ;
+   Real_t *q_new = domain.AllocateScratch(numElemReg) ;
+   Real_t *bvc = domain.AllocateScratch(numElemReg) ;
+   Real_t *pbvc = domain.AllocateScratch(numElemReg) ;
+   Real_t *pHalfStep = domain.AllocateScratch(numElemReg) ;
+   Real_t *vnewc_reg = domain.AllocateScratch(numElemReg) ;
+
+   // The relative volume does not change across repetitions
+#pragma omp parallel for firstprivate(numElemReg)
+   for (Index_t i=0; i<numElemReg; ++i) {
+      vnewc_reg[i] = vnewc[regElemList[i]] ;
+   }
  
    //loop to add load imbalance based on region number 
    for(Int_t j = 0; j < rep; j++) {
@@ -2281,32 +2338,24 @@ void EvalEOSForElems(Domain& domain, Real_t *vnewc,
 
 #pragma omp for firstprivate(numElemReg)
          for (Index_t i = 0; i < numElemReg ; ++i) {
-            Index_t elem = regElemList[i];
             Real_t vchalf ;
-            compression[i] = Real_t(1.) / vnewc[elem] - Real_t(1.);
-            vchalf = vnewc[elem] - delvc[i] * Real_t(.5);
+            compression[i] = Real_t(1.) / vnewc_reg[i] - Real_t(1.);
+            vchalf = vnewc_reg[i] - delvc[i] * Real_t(.5);
             compHalfStep[i] = Real_t(1.) / vchalf - Real_t(1.);
          }
 
-      /* Check for v > eosvmax or v < eosvmin */
-         if ( eosvmin != Real_t(0.) ) {
-#pragma omp for nowait firstprivate(numElemReg, eosvmin)
-            for(Index_t i=0 ; i<numElemReg ; ++i) {
-               Index_t elem = regElemList[i];
-               if (vnewc[elem] <= eosvmin) { /* impossible due to calling func? */
-                  compHalfStep[i] = compression[i] ;
-               }
-            }
-         }
-         if ( eosvmax != Real_t(0.) ) {
-#pragma omp for nowait firstprivate(numElemReg, eosvmax)
+      /* Check for v > eosvmax or v < eosvmin, in one loop so that both
+         checks of an element are made by the same thread */
+         if ( eosvmin != Real_t(0.) || eosvmax != Real_t(0.) ) {
+#pragma omp for simd nowait firstprivate(numElemReg, eosvmin, eosvmax)
             for(Index_t i=0 ; i<numElemReg ; ++i) {
-               Index_t elem = regElemList[i];
-               if (vnewc[elem] >= eosvmax) { /* impossible due to calling func? */
-                  p_old[i]        = Real_t(0.) ;
-                  compression[i]  = Real_t(0.) ;
-                  compHalfStep[i] = Real_t(0.) ;
-               }
+               /* impossible due to calling func? */
+               bool low  = (eosvmin != Real_t(0.)) && (vnewc_reg[i] <= eosvmin) ;
+               bool high = (eosvmax != Real_t(0.)) && (vnewc_reg[i] >= eosvmax) ;
+               compHalfStep[i] = low  ? compression[i] : compHalfStep[i] ;
+               p_old[i]        = high ? Real_t(0.) : p_old[i] ;
+               compression[i]  = high ? Real_t(0.) : compression[i] ;
+               compHalfStep[i] = high ? Real_t(0.) : compHalfStep[i] ;
             }
          }
 
@@ -2317,10 +2366,10 @@ void EvalEOSForElems(Domain& domain, Real_t *vnewc,
       }
       CalcEnergyForElems(p_new, e_new, q_new, bvc, pbvc,
                          p_old, e_old,  q_old, compression, compHalfStep,
-                         vnewc, work,  delvc, pmin,
+                         pHalfStep, vnewc_reg, work,  delvc, pmin,
                          p_cut, e_cut, q_cut, emin,
                          qq_old, ql_old, rho0, eosvmax,
-                         numElemReg, regElemList);
+                         numElemReg);
    }
 
 #pragma omp parallel for firstprivate(numElemReg)
@@ -2332,24 +2381,11 @@ void EvalEOSForElems(Domain& domain, Real_t *vnewc,
    }
 
    CalcSoundSpeedForElems(domain,
-                          vnewc, rho0, e_new, p_new,
+                          vnewc_reg, rho0, e_new, p_new,
                           pbvc, bvc, ss4o3,
                           numElemReg, regElemList) ;
 
-   Release(&pbvc) ;
-   Release(&bvc) ;
-   Release(&q_new) ;
-   Release(&e_new) ;
-   Release(&p_new) ;
-   Release(&work) ;
-   Release(&ql_old) ;
-   Release(&qq_old) ;
-   Release(&compHalfStep) ;
-   Release(&compression) ;
-   Release(&q_old) ;
-   Release(&p_old) ;
-   Release(&delvc) ;
-   Release(&e_old) ;
+   domain.ReleaseScratch(scratchMark) ;
 }
 
 /******************************************/
@@ -2453,7 +2489,8 @@ void UpdateVolumesForElems(Domain &domain, Real_t *vnew,
 static inline
 void LagrangeElements(Domain& domain, Index_t numElem)
 {
-  Real_t *vnew = Allocate<Real_t>(numElem) ;  /* new relative vol -- temp */
+  size_t scratchMark = domain.scratchMark() ;
+  Real_t *vnew = domain.AllocateScratch(numElem) ;  /* new relative vol -- temp */
 
   CalcLagrangeElements(domain, vnew) ;
 
@@ -2465,7 +2502,7 @@ void LagrangeElements(Domain& domain, Index_t numElem)
   UpdateVolumesForElems(domain, vnew,
                         domain.v_cut(), numElem) ;
 
-  Release(&vnew);
+  domain.ReleaseScratch(scratchMark) ;
 }
 
 /******************************************/
@@ -2714,6 +2751,7 @@ int main(int argc, char *argv[])
    opts.viz = 0;
    opts.balance = 1;
    opts.cost = 1;
+   opts.colorAssembly = 0;
 
    ParseCommandLineOptions(argc, argv, myRank, &opts);
 
@@ -2740,6 +2778,7 @@ int main(int argc, char *argv[])
    // Build the main data structure and initialize it
    locDom = new Domain(numRanks, col, row, plane, opts.nx,
                        side, opts.numReg, opts.balance, opts.cost) ;
+   locDom->colorAssembly() = opts.colorAssembly ;
 
 
 #if USE_MPI   
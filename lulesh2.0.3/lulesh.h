@@ -22,6 +22,8 @@
 #endif
 
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <vector>
 
 //**************************************************
@@ -40,7 +42,7 @@ typedef int    Index_t ; // array subscript and loop index
 typedef real8  Real_t ;  // floating point representation
 typedef int    Int_t ;   // integer representation
 
-enum { VolumeError = -1, QStopError = -2 } ;
+enum { VolumeError = -1, QStopError = -2, ScratchError = -3 } ;
 
 inline real4  SQRT(real4  arg) { return sqrtf(arg) ; }
 inline real8  SQRT(real8  arg) { return sqrt(arg) ; }
@@ -343,6 +345,38 @@ class Domain {
    Index_t *nodeElemCornerList(Index_t idx)
    { return &m_nodeElemCornerList[m_nodeElemStart[idx]] ; }
 
+   // Elements grouped into 8 colors by the parity of their (col,row,plane)
+   // position.  Elements of one color share no nodes, so their forces can
+   // be scattered straight into fx/fy/fz by threads without races.
+   Int_t numColors() const          { return (m_colorElemStart != NULL) ? 8 : 0 ; }
+   Index_t colorElemSize(Int_t c)
+   { return m_colorElemStart[c+1] - m_colorElemStart[c] ; }
+   Index_t *colorElemList(Int_t c)  { return &m_colorElemList[m_colorElemStart[c]] ; }
+   Int_t&  colorAssembly()          { return m_colorAssembly ; }
+
+   // Per-cycle temporaries come from one arena allocated at setup instead
+   // of a malloc/free pair per call.  Use is strictly LIFO: take a mark,
+   // carve arrays off the top, and pop back to the mark when done.  Each
+   // array starts on a cache-line boundary.
+   Real_t *AllocateScratch(size_t size)
+   {
+      size_t top = m_scratchTop + CACHE_ALIGN_REAL(size) ;
+      if (top > m_scratchSize) {
+         fprintf(stderr, "Scratch arena exhausted (%lu of %lu reals)\n",
+                 (unsigned long) top, (unsigned long) m_scratchSize) ;
+#if USE_MPI
+         MPI_Abort(MPI_COMM_WORLD, ScratchError) ;
+#else
+         exit(ScratchError);
+#endif
+      }
+      Real_t *ptr = &m_scratch[m_scratchTop] ;
+      m_scratchTop = top ;
+      return ptr ;
+   }
+   size_t scratchMark() const           { return m_scratchTop ; }
+   void   ReleaseScratch(size_t mark)   { m_scratchTop = mark ; }
+
    // Parameters 
 
    // Cutoffs
@@ -417,6 +451,7 @@ class Domain {
 
    void BuildMesh(Int_t nx, Int_t edgeNodes, Int_t edgeElems);
    void SetupThreadSupportStructures();
+   void SetupScratchArena();
    void CreateRegionIndexSets(Int_t nreg, Int_t balance);
    void SetupCommBuffers(Int_t edgeNodes);
    void SetupSymmetryPlanes(Int_t edgeNodes);
@@ -558,6 +593,16 @@ class Domain {
    Index_t *m_nodeElemStart ;
    Index_t *m_nodeElemCornerList ;
 
+   // Element coloring for the -a force assembly
+   Int_t    m_colorAssembly ;
+   Index_t *m_colorElemStart ;
+   Index_t *m_colorElemList ;
+
+   // Scratch arena for per-cycle temporaries
+   Real_t  *m_scratch ;
+   size_t   m_scratchSize ;
+   size_t   m_scratchTop ;
+
    // Used in setup
    Index_t m_rowMin, m_rowMax;
    Index_t m_colMin, m_colMax;
@@ -577,6 +622,7 @@ struct cmdLineOpts {
    Int_t viz; // -v 
    Int_t cost; // -c
    Int_t balance; // -b
+   Int_t colorAssembly; // -a
 };
 
 
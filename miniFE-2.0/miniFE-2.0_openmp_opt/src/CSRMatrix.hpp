@@ -31,6 +31,7 @@
 #include <cstddef>
 #include <vector>
 #include <algorithm>
+#include <FirstTouchAllocator.hpp>
 #ifdef HAVE_MPI
 #include <mpi.h>
 #endif
@@ -62,11 +63,11 @@ CSRMatrix {
   typedef GlobalOrdinal GlobalOrdinalType;
 
   bool                       has_local_indices;
-  std::vector<GlobalOrdinal> rows;
-  std::vector<LocalOrdinal>  row_offsets;
+  std::vector<GlobalOrdinal, FirstTouchAllocator<GlobalOrdinal> > rows;
+  std::vector<LocalOrdinal, FirstTouchAllocator<LocalOrdinal> >   row_offsets;
   std::vector<LocalOrdinal>  row_offsets_external;
-  std::vector<GlobalOrdinal> packed_cols;
-  std::vector<Scalar>        packed_coefs;
+  std::vector<GlobalOrdinal, FirstTouchAllocator<GlobalOrdinal> > packed_cols;
+  std::vector<Scalar, FirstTouchAllocator<Scalar> >               packed_coefs;
   LocalOrdinal               num_cols;
 
 #ifdef HAVE_MPI
@@ -87,24 +88,27 @@ CSRMatrix {
 
   void reserve_space(unsigned nrows, unsigned ncols_per_row)
   {
+    //None of these resizes touch the new elements (see FirstTouchAllocator),
+    //so the first writes below decide page placement. They use the same
+    //static schedule as the matvec loop over rows.
     rows.resize(nrows);
     row_offsets.resize(nrows+1);
 
     const MINIFE_GLOBAL_ORDINAL nrows_max = nrows * ncols_per_row;
-    packed_cols.reserve(nrows_max);
-    packed_coefs.reserve(nrows_max);
+    packed_cols.resize(nrows_max);
+    packed_coefs.resize(nrows_max);
 
-    #pragma omp parallel for
+    #pragma omp parallel for schedule(static)
     for(MINIFE_GLOBAL_ORDINAL i = 0; i < nrows; ++i) {
 	rows[i] = 0;
     }
 
-    #pragma omp parallel for
+    #pragma omp parallel for schedule(static)
     for(MINIFE_GLOBAL_ORDINAL i = 0; i < nrows + 1; ++i) {
 	row_offsets[i] = 0;
     }
 
-    #pragma omp parallel for
+    #pragma omp parallel for schedule(static)
     for(MINIFE_GLOBAL_ORDINAL i = 0; i < nrows_max; ++i) {
 	packed_cols[i] = 0;
 	packed_coefs[i] = 0;
@@ -127,7 +131,7 @@ CSRMatrix {
     //if we didn't get the local-row index using direct lookup, try a
     //more expensive binary-search:
     if (local_row == -1) {
-      typename std::vector<GlobalOrdinal>::iterator row_iter =
+      typename std::vector<GlobalOrdinal, FirstTouchAllocator<GlobalOrdinal> >::iterator row_iter =
           std::lower_bound(rows.begin(), rows.end(), row);
   
       //if we still haven't found row, it's not local so jump out:
@@ -0,0 +1,131 @@
+#ifndef _FirstTouchAllocator_hpp_
+#define _FirstTouchAllocator_hpp_
+
+//@HEADER
+// ************************************************************************
+//
+// MiniFE: Simple Finite Element Assembly and Solve
+// Copyright (2006-2013) Sandia Corporation
+//
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+//
+// This library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 2.1 of the
+// License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+//
+// ************************************************************************
+//@HEADER
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <YAML_Doc.hpp>
+
+namespace miniFE {
+
+//Allocator whose no-argument construct() default-initializes, so that
+//std::vector::resize leaves plain-old-data untouched instead of zeroing
+//it on the calling thread. The owner is expected to first-touch the new
+//elements in an OpenMP loop with the same schedule as the compute loops,
+//which puts each page on the NUMA node of the thread that will use it.
+template<typename T>
+class FirstTouchAllocator : public std::allocator<T> {
+public:
+  template<typename U>
+  struct rebind {
+    typedef FirstTouchAllocator<U> other;
+  };
+
+  FirstTouchAllocator() {}
+  FirstTouchAllocator(const FirstTouchAllocator& src) : std::allocator<T>(src) {}
+  template<typename U>
+  FirstTouchAllocator(const FirstTouchAllocator<U>& src) : std::allocator<T>(src) {}
+
+  template<typename U>
+  void construct(U* ptr)
+  {
+    ::new(static_cast<void*>(ptr)) U;
+  }
+
+  template<typename U, typename Arg>
+  void construct(U* ptr, const Arg& arg)
+  {
+    ::new(static_cast<void*>(ptr)) U(arg);
+  }
+};
+
+//Add to 'ydoc' the number of pages of [ptr, ptr+nbytes) that reside on
+//each NUMA node, sampling at most 4096 pages. Uses the move_pages query
+//mode directly so no libnuma is needed.
+inline void
+report_numa_placement(const char* name, const void* ptr, size_t nbytes,
+                      YAML_Doc& ydoc)
+{
+  if (ydoc.get("NUMA placement") == NULL) ydoc.add("NUMA placement","");
+  YAML_Element* elem = ydoc.get("NUMA placement")->add(name,"");
+
+#if defined(__linux__) && defined(SYS_move_pages)
+  if (ptr == NULL || nbytes == 0) {
+    elem->add("Not available","");
+    return;
+  }
+
+  const size_t max_samples = 4096;
+  const size_t max_nodes = 64;
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t first_page = reinterpret_cast<size_t>(ptr)/page_size;
+  const size_t last_page = (reinterpret_cast<size_t>(ptr)+nbytes-1)/page_size;
+  const size_t num_pages = last_page - first_page + 1;
+  const size_t num_samples = num_pages < max_samples ? num_pages : max_samples;
+
+  std::vector<void*> pages(num_samples);
+  std::vector<int> status(num_samples, -1);
+  for(size_t i=0; i<num_samples; ++i) {
+    pages[i] = reinterpret_cast<void*>((first_page + (num_pages*i)/num_samples)*page_size);
+  }
+
+  std::vector<int> pages_per_node(max_nodes, 0);
+  size_t num_nodes = 0;
+  if (syscall(SYS_move_pages, 0, num_samples, &pages[0],
+              static_cast<const int*>(NULL), &status[0], 0) == 0) {
+    for(size_t i=0; i<num_samples; ++i) {
+      if (status[i] < 0 || static_cast<size_t>(status[i]) >= max_nodes) continue;
+      ++pages_per_node[status[i]];
+      if (static_cast<size_t>(status[i])+1 > num_nodes) num_nodes = status[i]+1;
+    }
+  }
+
+  if (num_nodes == 0) elem->add("Not available","");
+  for(size_t n=0; n<num_nodes; ++n) {
+    std::ostringstream osstr;
+    osstr << "Node " << n << " pages";
+    elem->add(osstr.str(), pages_per_node[n]);
+  }
+#else
+  elem->add("Not available","");
+#endif
+}
+
+}//namespace miniFE
+
+#endif
+
@@ -514,7 +514,7 @@ void operator()(MatrixType& A,
         const ScalarType* const xcoefs __attribute__((aligned(64))) = &x.coefs[0];
         ScalarType* ycoefs __attribute__((aligned(64))) = &y.coefs[0];
 
-        #pragma omp parallel for
+        #pragma omp parallel for schedule(static)
         for(MINIFE_GLOBAL_ORDINAL row = 0; row < rows_size; ++row) {
                 const MINIFE_GLOBAL_ORDINAL row_start = Arowoffsets[row];
                 const MINIFE_GLOBAL_ORDINAL row_end   = Arowoffsets[row+1];
@@ -553,7 +553,7 @@ void operator()(MatrixType& A,
         ScalarType* ycoefs = &y.coefs[0];
   ScalarType beta = 0;
 
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(static)
   for(int row=0; row<n; ++row) {
     ScalarType sum = beta*ycoefs[row];
 
@@ -592,7 +592,7 @@ void operator()(MatrixType& A,
         ScalarType* ycoefs                        = &y.coefs[0];
         const ScalarType beta                     = 0;
 
-        #pragma omp parallel for
+        #pragma omp parallel for schedule(static)
         for(MINIFE_GLOBAL_ORDINAL row = 0; row < rows_size; ++row) {
                 const MINIFE_GLOBAL_ORDINAL row_start = Arowoffsets[row];
                 const MINIFE_GLOBAL_ORDINAL row_end   = Arowoffsets[row+1];
@@ -630,7 +630,7 @@ void operator()(MatrixType& A,
         ScalarType* ycoefs = &y.coefs[0];
   ScalarType beta = 0;
 
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(static)
   for(int row=0; row<n; ++row) {
     ScalarType sum = beta*ycoefs[row];
 
@@ -84,7 +84,9 @@ struct Vector {
 	coefs = coefs + (((unsigned long long int )coefs) % 64);
     }
 
-    #pragma omp parallel for
+    //First touch with the same static schedule as the vector kernels so
+    //each page lands on the NUMA node of the thread that updates it.
+    #pragma omp parallel for schedule(static)
     for(MINIFE_LOCAL_ORDINAL i = 0; i < local_size; ++i) {
 	coefs[i] = 0;
     }
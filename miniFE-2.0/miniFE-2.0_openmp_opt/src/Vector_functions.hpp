@@ -155,14 +155,14 @@ void
 
   if(beta == 0.0) {
 	if(alpha == 1.0) {
-  		#pragma omp parallel for
+  		#pragma omp parallel for schedule(static)
 		#pragma vector nontemporal
 		#pragma unroll(8)
   		for(int i=0; i<n; ++i) {
     			wcoefs[i] = xcoefs[i];
   		}
   	} else {
-  		#pragma omp parallel for
+  		#pragma omp parallel for schedule(static)
 		#pragma vector nontemporal
 		#pragma unroll(8)
   		for(int i=0; i<n; ++i) {
@@ -171,14 +171,14 @@ void
   	}
   } else {
 	if(alpha == 1.0) {
-  		#pragma omp parallel for
+  		#pragma omp parallel for schedule(static)
 		#pragma vector nontemporal
 		#pragma unroll(8)
   		for(int i=0; i<n; ++i) {
     			wcoefs[i] = xcoefs[i] + beta * ycoefs[i];
   		}
   	} else {
-  		#pragma omp parallel for
+  		#pragma omp parallel for schedule(static)
 		#pragma vector nontemporal
 		#pragma unroll(8)
   		for(int i=0; i<n; ++i) {
@@ -205,35 +205,35 @@ void
         MINIFE_SCALAR* MINIFE_RESTRICT ycoefs __attribute__ ((aligned (64))) = &y.coefs[0];
 
   if(alpha == 1.0 && beta == 1.0) {
-	  #pragma omp parallel for
+	  #pragma omp parallel for schedule(static)
 	  #pragma vector nontemporal
 	  #pragma unroll(8)
 	  for(int i = 0; i < n; ++i) {
 	    ycoefs[i] += xcoefs[i];
   	  }
   } else if (beta == 1.0) {
-	  #pragma omp parallel for
+	  #pragma omp parallel for schedule(static)
 	  #pragma vector nontemporal
 	  #pragma unroll(8)
 	  for(int i = 0; i < n; ++i) {
 	    ycoefs[i] += alpha * xcoefs[i];
   	  }
   } else if (alpha == 1.0) {
-	  #pragma omp parallel for
+	  #pragma omp parallel for schedule(static)
 	  #pragma vector nontemporal
 	  #pragma unroll(8)
 	  for(int i = 0; i < n; ++i) {
 	    ycoefs[i] = xcoefs[i] + beta * ycoefs[i];
   	  }
   } else if (beta == 0.0) {
-	  #pragma omp parallel for
+	  #pragma omp parallel for schedule(static)
 	  #pragma vector nontemporal
 	  #pragma unroll(8)
 	  for(int i = 0; i < n; ++i) {
 	    ycoefs[i] = alpha * xcoefs[i];
   	  }
   } else {
-	  #pragma omp parallel for
+	  #pragma omp parallel for schedule(static)
 	  #pragma vector nontemporal
 	  #pragma unroll(8)
 	  for(int i = 0; i < n; ++i) {
@@ -264,7 +264,7 @@ MINIFE_SCALAR dot(const Vector& x,
 
   MINIFE_SCALAR result = 0;
 
-  #pragma omp parallel for reduction(+:result)
+  #pragma omp parallel for schedule(static) reduction(+:result)
   for(int i=0; i<n; ++i) {
   	result += xcoefs[i] * ycoefs[i];
   }
@@ -303,7 +303,7 @@ MINIFE_SCALAR dot_r2(const Vector& x)
   const MINIFE_SCALAR* MINIFE_RESTRICT xcoefs __attribute__ ((aligned (64))) = &x.coefs[0];
   MINIFE_SCALAR result = 0;
 
-  #pragma omp parallel for reduction(+:result)
+  #pragma omp parallel for schedule(static) reduction(+:result)
   #pragma unroll(8)
   for(MINIFE_LOCAL_ORDINAL i = 0; i < n; ++i) {
   	result += xcoefs[i] * xcoefs[i];
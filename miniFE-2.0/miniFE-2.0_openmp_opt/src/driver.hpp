@@ -37,6 +37,10 @@
 
 #include <box_utils.hpp>
 #include <Vector.hpp>
+#include <FirstTouchAllocator.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifdef MINIFE_CSR_MATRIX
 #include <CSRMatrix.hpp>
@@ -236,6 +240,25 @@ driver(const Box& global_box, Box& my_box,
 
   size_t global_nnz = compute_matrix_stats(A, myproc, numprocs, ydoc);
 
+  //Report where rank 0's matrix and vector pages ended up after first touch:
+  if (myproc == 0) {
+    ydoc.add("NUMA placement","");
+#if defined(_OPENMP) && _OPENMP >= 201307
+    const char* bind_names[] = {"false", "true", "master", "close", "spread"};
+    const int bind = static_cast<int>(omp_get_proc_bind());
+    ydoc.get("NUMA placement")->add("OpenMP proc bind",
+                     std::string(bind >= 0 && bind < 5 ? bind_names[bind] : "unknown"));
+#endif
+#ifdef MINIFE_ELL_MATRIX
+    report_numa_placement("Matrix coefs", A.coefs.empty() ? NULL : &A.coefs[0],
+                          A.coefs.size()*sizeof(Scalar), ydoc);
+#else
+    report_numa_placement("Matrix coefs", A.packed_coefs.empty() ? NULL : &A.packed_coefs[0],
+                          A.packed_coefs.size()*sizeof(Scalar), ydoc);
+#endif
+    report_numa_placement("Vector x", x.coefs, x.local_size*sizeof(Scalar), ydoc);
+  }
+
   //Prepare to perform conjugate gradient solve:
 
   LocalOrdinal max_iters = 200;
@@ -12,12 +12,14 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 
 #include "decoder.h"
 #include "dedupdef.h"
 #include "config.h"
 #include "util.h"
 #include "hashtable.h"
+#include "fpstore.h"
 #include "mbuffer.h"
 #include "debug.h"
 
@@ -50,6 +52,48 @@ static int keys_equal_fn ( void *key1, void *key2 ) {
   return (memcmp(key1, key2, SHA1_LEN) == 0);
 }
 
+//Persistent index of earlier archives (optional) and file descriptors of the archives opened so far
+static struct fpstore *store;
+static int *archive_fds;
+static u_int32 narchive_fds;
+
+
+
+/*
+ * Helper function which reads the compressed data of a chunk stored in an
+ * earlier archive, which is found with the persistent index
+ */
+static void read_reference(chunk_t *chunk) {
+  fpstore_location_t loc;
+  const char *name;
+  int fd, r;
+
+  if(store == NULL) EXIT_TRACE("Input file refers to earlier archives, specify their index with -x.\n");
+  if(!fpstore_lookup(store, chunk->sha1, &loc)) EXIT_TRACE("Referenced chunk not found in index.\n");
+  name = fpstore_archive_name(store, loc.archive);
+
+  //Open archive on first use
+  if(loc.archive >= narchive_fds) {
+    u_int32 i;
+    archive_fds = realloc(archive_fds, (loc.archive+1) * sizeof(int));
+    if(archive_fds == NULL) EXIT_TRACE("Memory allocation failed.\n");
+    for(i=narchive_fds; i<=loc.archive; i++) archive_fds[i] = -1;
+    narchive_fds = loc.archive+1;
+  }
+  if(archive_fds[loc.archive] < 0) {
+    archive_fds[loc.archive] = open(name, O_RDONLY|O_LARGEFILE);
+    if(archive_fds[loc.archive] < 0) EXIT_TRACE("Cannot open archive %s: %s\n", name, strerror(errno));
+  }
+  fd = archive_fds[loc.archive];
+
+  if(loc.len<=0) EXIT_TRACE("illegal size of data chunk\n");
+  r = mbuffer_create(&chunk->compressed_data, loc.len);
+  if(r != 0) EXIT_TRACE("Creation of input buffer failed.\n");
+  if(pread(fd, chunk->compressed_data.ptr, loc.len, loc.offset) != loc.len) {
+    EXIT_TRACE("Cannot read referenced chunk from archive %s\n", name);
+  }
+}
+
 
 
 /*
@@ -89,6 +133,16 @@ static int read_chunk(int fd, chunk_t *chunk) {
     if(r < 0) EXIT_TRACE("xread data chunk fails\n")
     else if(r == 0) EXIT_TRACE("incomplete chunk\n");
     chunk->header.isDuplicate = FALSE;
+    chunk->header.state = CHUNK_STATE_COMPRESSED;
+    break;
+  case TYPE_REFERENCE:
+    if(len!=SHA1_LEN) EXIT_TRACE("incorrect size of SHA1 sum\n");
+    r=xread(fd, (unsigned char *)(chunk->sha1), SHA1_LEN);
+    if(r < 0) EXIT_TRACE("xread SHA1 sum fails\n")
+    else if(r == 0) EXIT_TRACE("incomplete chunk\n");
+    read_reference(chunk);
+    chunk->header.isDuplicate = FALSE;
+    chunk->header.state = CHUNK_STATE_REFERENCED;
     break;
   default:
     EXIT_TRACE("unknown chunk type\n");
@@ -199,6 +253,14 @@ void Decode(config_t * _conf) {
   }
   //Ignore any compression settings given at the command line, use type used during encoding
   conf->compress_type = compress_type;
+
+  //Open persistent index, all archives in it use the same compression type
+  store = NULL;
+  archive_fds = NULL;
+  narchive_fds = 0;
+  if(strlen(conf->indexfile) > 0) {
+    store = fpstore_open(conf->indexfile, conf->compress_type);
+  }
   fd_out = open(conf->outfile, O_CREAT|O_WRONLY|O_TRUNC, ~(S_ISUID | S_ISGID |S_IXGRP | S_IXUSR | S_IXOTH));
   if (fd_out < 0) {
     perror("outfile open");
@@ -226,11 +288,17 @@ void Decode(config_t * _conf) {
     //process input data & assing chunk with corresponding uncompresse data to 'entry' variable
     chunk_t *entry;
     if(!chunk->header.isDuplicate) {
+      unsigned int sha1[SHA1_LEN/sizeof(unsigned int)];
       //We got the compressed data, use it to get original data back
       r=uncompress_chunk(chunk);
       if(r<=0) EXIT_TRACE("error uncompressing data")
       //Compute SHA1 sum and add new chunk with uncompressed data to cache
+      memcpy(sha1, chunk->sha1, SHA1_LEN);
       SHA1_Digest(chunk->uncompressed_data.ptr, chunk->uncompressed_data.n, (unsigned char *)(chunk->sha1));
+      //Data from an earlier archive must match the reference, the archive might have been modified
+      if(chunk->header.state == CHUNK_STATE_REFERENCED && memcmp(sha1, chunk->sha1, SHA1_LEN) != 0) {
+        EXIT_TRACE("Referenced chunk does not match data in archive.\n");
+      }
       if(hashtable_insert(cache, (void *)(chunk->sha1), (void *)chunk) == 0) {
         EXIT_TRACE("hashtable_insert failed");
       }
@@ -256,6 +324,15 @@ void Decode(config_t * _conf) {
   close(fd_in);
   close(fd_out);
 
+  if(store != NULL) {
+    u_int32 i;
+    for(i=0; i<narchive_fds; i++) {
+      if(archive_fds[i] >= 0) close(archive_fds[i]);
+    }
+    free(archive_fds);
+    fpstore_close(store);
+  }
+
   free(chunk);
   mbuffer_system_destroy();
   //NOTE: Would have to iterate through hashtable and manually free all buffers. Calling
@@ -30,13 +30,16 @@ config_t * conf;
 static void
 usage(char* prog)
 {
-  printf("usage: %s [-cusfvh] [-w gzip/bzip2/none] [-i file] [-o file] [-t number_of_threads]\n",prog);
+  printf("usage: %s [-cusfmvh] [-w gzip/bzip2/none] [-s rabin/gear] [-i file] [-o file] [-x file] [-t number_of_threads]\n",prog);
   printf("-c \t\t\tcompress\n");
   printf("-u \t\t\tuncompress\n");
   printf("-p \t\t\tpreloading (for benchmarking purposes)\n");
+  printf("-m \t\t\tmap the input file instead of reading it (compress only)\n");
   printf("-w \t\t\tcompression type: gzip/bzip2/none\n");
+  printf("-s \t\t\tchunking algorithm: rabin/gear\n");
   printf("-i file\t\t\tthe input file\n");
   printf("-o file\t\t\tthe output file\n");
+  printf("-x file\t\t\tpersistent index of earlier archives (incremental mode)\n");
   printf("-t \t\t\tnumber of threads per stage \n");
   printf("-v \t\t\tverbose output\n");
   printf("-h \t\t\thelp\n");
@@ -65,8 +68,11 @@ int main(int argc, char** argv) {
   }
 
   strcpy(conf->outfile, "");
+  strcpy(conf->indexfile, "");
   conf->compress_type = COMPRESS_GZIP;
+  conf->chunker = CHUNKER_RABIN;
   conf->preloading = 0;
+  conf->mmap_input = 0;
   conf->nthreads = 1;
   conf->verbose = 0;
 
@@ -74,7 +80,7 @@ int main(int argc, char** argv) {
   int ch;
   opterr = 0;
   optind = 1;
-  while (-1 != (ch = getopt(argc, argv, "cupvo:i:w:t:h"))) {
+  while (-1 != (ch = getopt(argc, argv, "cupmvo:i:w:s:t:x:h"))) {
     switch (ch) {
     case 'c':
       compress = TRUE;
@@ -99,18 +105,35 @@ int main(int argc, char** argv) {
         return -1;
       }
       break;
+    case 's':
+      if (strcmp(optarg, "rabin") == 0)
+        conf->chunker = CHUNKER_RABIN;
+      else if (strcmp(optarg, "gear") == 0)
+        conf->chunker = CHUNKER_GEAR;
+      else {
+        fprintf(stdout, "Unknown chunking algorithm `%s'.\n", optarg);
+        usage(argv[0]);
+        return -1;
+      }
+      break;
     case 'o':
       strcpy(conf->outfile, optarg);
       break;
     case 'i':
       strcpy(conf->infile, optarg);
       break;
+    case 'x':
+      strcpy(conf->indexfile, optarg);
+      break;
     case 'h':
       usage(argv[0]);
       return -1;
     case 'p':
       conf->preloading = TRUE;
       break;
+    case 'm':
+      conf->mmap_input = TRUE;
+      break;
     case 't':
       conf->nthreads = atoi(optarg);
       break;
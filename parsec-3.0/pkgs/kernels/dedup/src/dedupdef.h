@@ -77,7 +77,8 @@ typedef int64_t  int64;
 typedef enum {
   CHUNK_STATE_UNCOMPRESSED=0,  //only uncompressed data available
   CHUNK_STATE_COMPRESSED=1,    //compressed data available, but nothing else
-  CHUNK_STATE_FLUSHED=2        //no data available because chunk has already been flushed
+  CHUNK_STATE_FLUSHED=2,       //no data available because chunk has already been flushed
+  CHUNK_STATE_REFERENCED=3     //no data available because it is stored in an earlier archive
 } chunk_state_t;
 
 #ifdef ENABLE_PTHREADS
@@ -182,6 +183,7 @@ typedef struct _chunk_t {
 #define TYPE_FINGERPRINT 0
 #define TYPE_COMPRESS 1
 #define TYPE_ORIGINAL 2
+#define TYPE_REFERENCE 3
 
 #define QUEUE_SIZE 1024UL*1024
 
@@ -191,11 +193,14 @@ typedef struct _chunk_t {
 
 #define MAX_PER_FETCH 10000
 
-#define ITEM_PER_FETCH 20
-#define ITEM_PER_INSERT 20
+//Upper bounds for the number of items moved per queue operation. Producers
+//hand over smaller batches whenever consumers are idle and consumers leave a
+//share to each other, see queue_shouldFlush() and queue_dequeue().
+#define ITEM_PER_FETCH 64
+#define ITEM_PER_INSERT 64
 
-#define CHUNK_ANCHOR_PER_FETCH 20
-#define CHUNK_ANCHOR_PER_INSERT 20
+#define CHUNK_ANCHOR_PER_FETCH 64
+#define CHUNK_ANCHOR_PER_INSERT 64
 
 #define ANCHOR_DATA_PER_INSERT 1
 
@@ -203,8 +208,11 @@ typedef struct _chunk_t {
 typedef struct {
   char infile[LEN_FILENAME];
   char outfile[LEN_FILENAME];
+  char indexfile[LEN_FILENAME];
   int compress_type;
+  int chunker;
   int preloading;
+  int mmap_input;
   int nthreads;
   int verbose;
 } config_t;
@@ -213,6 +221,9 @@ typedef struct {
 #define COMPRESS_BZIP2 1
 #define COMPRESS_NONE 2
 
+#define CHUNKER_RABIN 0
+#define CHUNKER_GEAR 1
+
 #define UNCOMPRESS_BOUND 10000000
 
 #endif //_DEDUPDEF_H_
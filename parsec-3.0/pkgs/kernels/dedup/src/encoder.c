@@ -25,15 +25,19 @@
 #include <unistd.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "util.h"
 #include "dedupdef.h"
 #include "encoder.h"
 #include "debug.h"
-#include "hashtable.h"
+#include "fpindex.h"
+#include "fpstore.h"
 #include "config.h"
 #include "rabin.h"
+#include "gear.h"
 #include "mbuffer.h"
+#include "slab.h"
 
 #ifdef ENABLE_PTHREADS
 #include "queue.h"
@@ -64,17 +68,15 @@
 //The configuration block defined in main
 config_t * conf;
 
-//Hash table data structure & utility functions
-struct hashtable *cache;
+//Index of all unique chunks seen so far, keyed by SHA1 sum
+static struct fpindex *cache;
 
-static unsigned int hash_from_key_fn( void *k ) {
-  //NOTE: sha1 sum is integer-aligned
-  return ((unsigned int *)k)[0];
-}
+//Memory for all chunk_t structures of the encoder
+static slab_t chunk_slab;
 
-static int keys_equal_fn ( void *key1, void *key2 ) {
-  return (memcmp(key1, key2, SHA1_LEN) == 0);
-}
+//Persistent index of the chunks stored in earlier archives (optional), and the id of the output archive in it
+static struct fpstore *store;
+static u_int32 store_archive;
 
 //Arguments to pass to each thread
 struct thread_args {
@@ -84,7 +86,7 @@ struct thread_args {
   int nqueues;
   //file descriptor, first pipeline stage only
   int fd;
-  //input file buffer, first pipeline stage & preloading only
+  //input file buffer, first pipeline stage & preloading or mapped input only
   struct {
     void *buffer;
     size_t size;
@@ -244,13 +246,44 @@ static int create_output_file(char *outfile) {
   return fd;
 }
 
+/*
+ * Helper function to close the output file. Its data must be on disk
+ * before the persistent index can refer to it.
+ */
+static void close_output_file(int fd) {
+  if(store != NULL && fsync(fd) < 0) {
+    EXIT_TRACE("Cannot sync output file: %s\n", strerror(errno));
+  }
+  close(fd);
+}
+
 
 
+/*
+ * Helper function that writes the compressed data of a chunk to an output
+ * file and adds the chunk to the persistent index, if there is one
+ */
+static void write_chunk_data(int fd, chunk_t *chunk) {
+  off_t offset = 0;
+
+  if(store != NULL) {
+    //The data follows the type and length of the record
+    offset = lseek(fd, 0, SEEK_CUR);
+    if(offset < 0) EXIT_TRACE("Cannot determine output file position.\n");
+    offset += sizeof(u_char) + sizeof(u_long);
+  }
+  write_file(fd, TYPE_COMPRESS, chunk->compressed_data.n, chunk->compressed_data.ptr);
+  if(store != NULL) {
+    fpstore_add_chunk(store, chunk->sha1, store_archive, offset, chunk->compressed_data.n);
+  }
+}
+
 /*
  * Helper function that writes a chunk to an output file depending on
  * its state. The function will write the SHA1 sum if the chunk has
  * already been written before, or it will write the compressed data
- * of the chunk if it has not been written yet.
+ * of the chunk if it has not been written yet. Chunks stored in an
+ * earlier archive are written as a reference to it.
  *
  * This function will block if the compressed data is not available yet.
  * This function might update the state of the chunk if there are any changes.
@@ -269,12 +302,16 @@ static void write_chunk_to_file(int fd, chunk_t *chunk) {
     pthread_cond_wait(&chunk->header.update, &chunk->header.lock);
   }
 
-  //state is now guaranteed to be either COMPRESSED or FLUSHED
+  //state is now guaranteed to be either COMPRESSED, REFERENCED or FLUSHED
   if(chunk->header.state == CHUNK_STATE_COMPRESSED) {
     //Chunk data has not been written yet, do so now
-    write_file(fd, TYPE_COMPRESS, chunk->compressed_data.n, chunk->compressed_data.ptr);
+    write_chunk_data(fd, chunk);
     mbuffer_free(&chunk->compressed_data);
     chunk->header.state = CHUNK_STATE_FLUSHED;
+  } else if(chunk->header.state == CHUNK_STATE_REFERENCED) {
+    //Chunk data is stored in an earlier archive, write SHA1 to refer to it
+    write_file(fd, TYPE_REFERENCE, SHA1_LEN, (unsigned char *)(chunk->sha1));
+    chunk->header.state = CHUNK_STATE_FLUSHED;
   } else {
     //Chunk data has been written to file before, just write SHA1
     write_file(fd, TYPE_FINGERPRINT, SHA1_LEN, (unsigned char *)(chunk->sha1));
@@ -287,9 +324,12 @@ static void write_chunk_to_file(int fd, chunk_t *chunk) {
 static void write_chunk_to_file(int fd, chunk_t *chunk) {
   assert(chunk!=NULL);
 
-  if(!chunk->header.isDuplicate) {
+  if(!chunk->header.isDuplicate && chunk->header.state == CHUNK_STATE_REFERENCED) {
+    //Unique chunk whose data is stored in an earlier archive, write SHA1 to refer to it
+    write_file(fd, TYPE_REFERENCE, SHA1_LEN, (unsigned char *)(chunk->sha1));
+  } else if(!chunk->header.isDuplicate) {
     //Unique chunk, data has not been written yet, do so now
-    write_file(fd, TYPE_COMPRESS, chunk->compressed_data.n, chunk->compressed_data.ptr);
+    write_chunk_data(fd, chunk);
     mbuffer_free(&chunk->compressed_data);
   } else {
     //Duplicate chunk, data has been written to file before, just write SHA1
@@ -301,6 +341,12 @@ static void write_chunk_to_file(int fd, chunk_t *chunk) {
 int rf_win;
 int rf_win_dataprocess;
 
+//Find the first chunk boundary in a buffer with the selected chunking algorithm
+static inline int chunkseg(uchar *p, int n, int winlen, u32int *rabintab, u32int *rabinwintab) {
+  if(conf->chunker == CHUNKER_GEAR) return gearseg(p, n);
+  return rabinseg(p, n, winlen, rabintab, rabinwintab);
+}
+
 /*
  * Computational kernel of compression stage
  *
@@ -434,7 +480,7 @@ void *Compress(void * targs) {
     assert(r==0);
 
     //put the item in the next queue for the write thread
-    if (ringbuffer_isFull(&send_buf)) {
+    if (queue_shouldFlush(&reorder_que[qid], &send_buf)) {
       r = queue_enqueue(&reorder_que[qid], &send_buf, ITEM_PER_INSERT);
       assert(r>=1);
     }
@@ -468,7 +514,7 @@ void *Compress(void * targs) {
  * Actions performed:
  *  - Calculate SHA1 signature for each incoming data chunk
  *  - Perform database lookup to determine chunk redundancy status
- *  - On miss add chunk to database
+ *  - On miss add chunk to database and look it up in the persistent index
  *  - Returns chunk redundancy status
  */
 int sub_Deduplicate(chunk_t *chunk) {
@@ -480,32 +526,42 @@ int sub_Deduplicate(chunk_t *chunk) {
 
   SHA1_Digest(chunk->uncompressed_data.ptr, chunk->uncompressed_data.n, (unsigned char *)(chunk->sha1));
 
-  //Query database to determine whether we've seen the data chunk before
+  //The chunk becomes globally viewable the moment it is added to the
+  //database, so it has to be fully set up as an original chunk before
+  chunk->header.isDuplicate = FALSE;
 #ifdef ENABLE_PTHREADS
-  pthread_mutex_t *ht_lock = hashtable_getlock(cache, (void *)(chunk->sha1));
-  pthread_mutex_lock(ht_lock);
+  pthread_mutex_init(&chunk->header.lock, NULL);
+  pthread_cond_init(&chunk->header.update, NULL);
 #endif
-  entry = (chunk_t *)hashtable_search(cache, (void *)(chunk->sha1));
+
+  //Query database to determine whether we've seen the data chunk before,
+  //on a miss the chunk is added and forwarded to the compression stage
+  //NOTE: chunk->compressed_data.buffer will be computed in compression stage
+  entry = (chunk_t *)fpindex_insert(cache, chunk->sha1, (void *)chunk);
   isDuplicate = (entry != NULL);
-  chunk->header.isDuplicate = isDuplicate;
-  if (!isDuplicate) {
-    // Cache miss: Create entry in hash table and forward data to compression stage
+  if (isDuplicate) {
+    // Cache hit: Skipping compression stage
 #ifdef ENABLE_PTHREADS
-    pthread_mutex_init(&chunk->header.lock, NULL);
-    pthread_cond_init(&chunk->header.update, NULL);
+    pthread_mutex_destroy(&chunk->header.lock);
+    pthread_cond_destroy(&chunk->header.update);
 #endif
-    //NOTE: chunk->compressed_data.buffer will be computed in compression stage
-    if (hashtable_insert(cache, (void *)(chunk->sha1), (void *)chunk) == 0) {
-      EXIT_TRACE("hashtable_insert failed");
-    }
-  } else {
-    // Cache hit: Skipping compression stage
+    chunk->header.isDuplicate = TRUE;
     chunk->compressed_data_ref = entry;
     mbuffer_free(&chunk->uncompressed_data);
-  }
+  } else if(store != NULL && fpstore_lookup(store, chunk->sha1, NULL)) {
+    // Hit in an earlier archive: The chunk stays the original of this run,
+    // but it is not compressed and the caller treats it like a duplicate
 #ifdef ENABLE_PTHREADS
-  pthread_mutex_unlock(ht_lock);
+    pthread_mutex_lock(&chunk->header.lock);
 #endif
+    chunk->header.state = CHUNK_STATE_REFERENCED;
+#ifdef ENABLE_PTHREADS
+    pthread_cond_broadcast(&chunk->header.update);
+    pthread_mutex_unlock(&chunk->header.lock);
+#endif
+    mbuffer_free(&chunk->uncompressed_data);
+    isDuplicate = TRUE;
+  }
 
   return isDuplicate;
 }
@@ -567,14 +623,14 @@ void * Deduplicate(void * targs) {
     if(!isDuplicate) {
       r = ringbuffer_insert(&send_buf_compress, chunk);
       assert(r==0);
-      if (ringbuffer_isFull(&send_buf_compress)) {
+      if (queue_shouldFlush(&compress_que[qid], &send_buf_compress)) {
         r = queue_enqueue(&compress_que[qid], &send_buf_compress, ITEM_PER_INSERT);
         assert(r>=1);
       }
     } else {
       r = ringbuffer_insert(&send_buf_reorder, chunk);
       assert(r==0);
-      if (ringbuffer_isFull(&send_buf_reorder)) {
+      if (queue_shouldFlush(&reorder_que[qid], &send_buf_reorder)) {
         r = queue_enqueue(&reorder_que[qid], &send_buf_reorder, ITEM_PER_INSERT);
         assert(r>=1);
       }
@@ -611,7 +667,7 @@ void * Deduplicate(void * targs) {
  *
  * Actions performed:
  *  - Take coarse chunks from fragmentation stage
- *  - Partition data block into smaller chunks with Rabin rolling fingerprints
+ *  - Partition data block into smaller chunks with content-defined chunking (Rabin or Gear)
  *  - Send resulting data chunks to deduplication stage
  *
  * Notes:
@@ -622,6 +678,7 @@ void *FragmentRefine(void * targs) {
   struct thread_args *args = (struct thread_args *)targs;
   const int qid = args->tid / MAX_THREADS_PER_QUEUE;
   ringbuffer_t recv_buf, send_buf;
+  slab_cache_t chunk_cache;
   int r;
 
   chunk_t *temp;
@@ -636,6 +693,7 @@ void *FragmentRefine(void * targs) {
   r += ringbuffer_init(&recv_buf, MAX_PER_FETCH);
   r += ringbuffer_init(&send_buf, CHUNK_ANCHOR_PER_INSERT);
   assert(r==0);
+  slab_cache_init(&chunk_cache);
 
 #ifdef ENABLE_STATISTICS
   stats_t *thread_stats = malloc(sizeof(stats_t));
@@ -663,12 +721,12 @@ void *FragmentRefine(void * targs) {
     int split;
     sequence_number_t chcount = 0;
     do {
-      //Find next anchor with Rabin fingerprint
-      int offset = rabinseg(chunk->uncompressed_data.ptr, chunk->uncompressed_data.n, rf_win, rabintab, rabinwintab);
+      //Find next anchor with the rolling hash
+      int offset = chunkseg(chunk->uncompressed_data.ptr, chunk->uncompressed_data.n, rf_win, rabintab, rabinwintab);
       //Can we split the buffer?
       if(offset < chunk->uncompressed_data.n) {
         //Allocate a new chunk and create a new memory buffer
-        temp = (chunk_t *)malloc(sizeof(chunk_t));
+        temp = (chunk_t *)slab_alloc(&chunk_slab, &chunk_cache);
         if(temp==NULL) EXIT_TRACE("Memory allocation failed.\n");
         temp->header.state = chunk->header.state;
         temp->sequence.l1num = chunk->sequence.l1num;
@@ -690,7 +748,7 @@ void *FragmentRefine(void * targs) {
         //put it into send buffer
         r = ringbuffer_insert(&send_buf, chunk);
         assert(r==0);
-        if (ringbuffer_isFull(&send_buf)) {
+        if (queue_shouldFlush(&deduplicate_que[qid], &send_buf)) {
           r = queue_enqueue(&deduplicate_que[qid], &send_buf, CHUNK_ANCHOR_PER_INSERT);
           assert(r>=1);
         }
@@ -712,7 +770,7 @@ void *FragmentRefine(void * targs) {
         //put it into send buffer
         r = ringbuffer_insert(&send_buf, chunk);
         assert(r==0);
-        if (ringbuffer_isFull(&send_buf)) {
+        if (queue_shouldFlush(&deduplicate_que[qid], &send_buf)) {
           r = queue_enqueue(&deduplicate_que[qid], &send_buf, CHUNK_ANCHOR_PER_INSERT);
           assert(r>=1);
         }
@@ -753,6 +811,7 @@ void *SerialIntegratedPipeline(void * targs) {
   size_t preloading_buffer_seek = 0;
   int fd = args->fd;
   int fd_out = create_output_file(conf->outfile);
+  slab_cache_t chunk_cache;
   int r;
 
   chunk_t *temp = NULL;
@@ -765,6 +824,7 @@ void *SerialIntegratedPipeline(void * targs) {
 
   rf_win_dataprocess = 0;
   rabininit(rf_win_dataprocess, rabintab, rabinwintab);
+  slab_cache_init(&chunk_cache);
 
   //Sanity check
   if(MAXBUF < 8 * ANCHOR_JUMP) {
@@ -774,80 +834,101 @@ void *SerialIntegratedPipeline(void * targs) {
 
   //read from input file / buffer
   while (1) {
-    size_t bytes_left; //amount of data left over in last_mbuffer from previous iteration
+    size_t bytes_read=0;
 
-    //Check how much data left over from previous iteration resp. create an initial chunk
-    if(temp != NULL) {
-      bytes_left = temp->uncompressed_data.n;
+    if(conf->mmap_input) {
+      //The rest of the mapped input becomes the next buffer, no data is copied
+      if(temp != NULL) {
+        //No split location in the rest of the input, process it as the last chunk
+        chunk = temp;
+        temp = NULL;
+      } else {
+        if(preloading_buffer_seek == args->input_file.size) break;
+        chunk = (chunk_t *)slab_alloc(&chunk_slab, &chunk_cache);
+        if(chunk==NULL) EXIT_TRACE("Memory allocation failed.\n");
+        r = mbuffer_wrap(&chunk->uncompressed_data, args->input_file.buffer+preloading_buffer_seek, args->input_file.size-preloading_buffer_seek);
+        if(r!=0) {
+          EXIT_TRACE("Unable to initialize memory buffer.\n");
+        }
+        chunk->header.state = CHUNK_STATE_UNCOMPRESSED;
+        bytes_read = args->input_file.size-preloading_buffer_seek;
+        preloading_buffer_seek = args->input_file.size;
+      }
     } else {
-      bytes_left = 0;
-    }
+      size_t bytes_left; //amount of data left over in last_mbuffer from previous iteration
 
-    //Make sure that system supports new buffer size
-    if(MAXBUF+bytes_left > SSIZE_MAX) {
-      EXIT_TRACE("Input buffer size exceeds system maximum.\n");
-    }
-    //Allocate a new chunk and create a new memory buffer
-    chunk = (chunk_t *)malloc(sizeof(chunk_t));
-    if(chunk==NULL) EXIT_TRACE("Memory allocation failed.\n");
-    r = mbuffer_create(&chunk->uncompressed_data, MAXBUF+bytes_left);
-    if(r!=0) {
-      EXIT_TRACE("Unable to initialize memory buffer.\n");
-    }
-    chunk->header.state = CHUNK_STATE_UNCOMPRESSED;
-    if(bytes_left > 0) {
-      //FIXME: Short-circuit this if no more data available
-
-      //"Extension" of existing buffer, copy sequence number and left over data to beginning of new buffer
-      //NOTE: We cannot safely extend the current memory region because it has already been given to another thread
-      memcpy(chunk->uncompressed_data.ptr, temp->uncompressed_data.ptr, temp->uncompressed_data.n);
-      mbuffer_free(&temp->uncompressed_data);
-      free(temp);
-      temp = NULL;
-    }
-    //Read data until buffer full
-    size_t bytes_read=0;
-    if(conf->preloading) {
-      size_t max_read = MIN(MAXBUF, args->input_file.size-preloading_buffer_seek);
-      memcpy(chunk->uncompressed_data.ptr+bytes_left, args->input_file.buffer+preloading_buffer_seek, max_read);
-      bytes_read = max_read;
-      preloading_buffer_seek += max_read;
-    } else {
-      while(bytes_read < MAXBUF) {
-        r = read(fd, chunk->uncompressed_data.ptr+bytes_left+bytes_read, MAXBUF-bytes_read);
-        if(r<0) switch(errno) {
-          case EAGAIN:
-            EXIT_TRACE("I/O error: No data available\n");break;
-          case EBADF:
-            EXIT_TRACE("I/O error: Invalid file descriptor\n");break;
-          case EFAULT:
-            EXIT_TRACE("I/O error: Buffer out of range\n");break;
-          case EINTR:
-            EXIT_TRACE("I/O error: Interruption\n");break;
-          case EINVAL:
-            EXIT_TRACE("I/O error: Unable to read from file descriptor\n");break;
-          case EIO:
-            EXIT_TRACE("I/O error: Generic I/O error\n");break;
-          case EISDIR:
-            EXIT_TRACE("I/O error: Cannot read from a directory\n");break;
-          default:
-            EXIT_TRACE("I/O error: Unrecognized error\n");break;
+      //Check how much data left over from previous iteration resp. create an initial chunk
+      if(temp != NULL) {
+        bytes_left = temp->uncompressed_data.n;
+      } else {
+        bytes_left = 0;
+      }
+
+      //Make sure that system supports new buffer size
+      if(MAXBUF+bytes_left > SSIZE_MAX) {
+        EXIT_TRACE("Input buffer size exceeds system maximum.\n");
+      }
+      //Allocate a new chunk and create a new memory buffer
+      chunk = (chunk_t *)slab_alloc(&chunk_slab, &chunk_cache);
+      if(chunk==NULL) EXIT_TRACE("Memory allocation failed.\n");
+      r = mbuffer_create(&chunk->uncompressed_data, MAXBUF+bytes_left);
+      if(r!=0) {
+        EXIT_TRACE("Unable to initialize memory buffer.\n");
+      }
+      chunk->header.state = CHUNK_STATE_UNCOMPRESSED;
+      if(bytes_left > 0) {
+        //FIXME: Short-circuit this if no more data available
+
+        //"Extension" of existing buffer, copy sequence number and left over data to beginning of new buffer
+        //NOTE: We cannot safely extend the current memory region because it has already been given to another thread
+        memcpy(chunk->uncompressed_data.ptr, temp->uncompressed_data.ptr, temp->uncompressed_data.n);
+        mbuffer_free(&temp->uncompressed_data);
+        slab_free(&chunk_slab, &chunk_cache, temp);
+        temp = NULL;
+      }
+      //Read data until buffer full
+      if(conf->preloading) {
+        size_t max_read = MIN(MAXBUF, args->input_file.size-preloading_buffer_seek);
+        memcpy(chunk->uncompressed_data.ptr+bytes_left, args->input_file.buffer+preloading_buffer_seek, max_read);
+        bytes_read = max_read;
+        preloading_buffer_seek += max_read;
+      } else {
+        while(bytes_read < MAXBUF) {
+          r = read(fd, chunk->uncompressed_data.ptr+bytes_left+bytes_read, MAXBUF-bytes_read);
+          if(r<0) switch(errno) {
+            case EAGAIN:
+              EXIT_TRACE("I/O error: No data available\n");break;
+            case EBADF:
+              EXIT_TRACE("I/O error: Invalid file descriptor\n");break;
+            case EFAULT:
+              EXIT_TRACE("I/O error: Buffer out of range\n");break;
+            case EINTR:
+              EXIT_TRACE("I/O error: Interruption\n");break;
+            case EINVAL:
+              EXIT_TRACE("I/O error: Unable to read from file descriptor\n");break;
+            case EIO:
+              EXIT_TRACE("I/O error: Generic I/O error\n");break;
+            case EISDIR:
+              EXIT_TRACE("I/O error: Cannot read from a directory\n");break;
+            default:
+              EXIT_TRACE("I/O error: Unrecognized error\n");break;
+          }
+          if(r==0) break;
+          bytes_read += r;
         }
-        if(r==0) break;
-        bytes_read += r;
       }
-    }
-    //No data left over from last iteration and also nothing new read in, simply clean up and quit
-    if(bytes_left + bytes_read == 0) {
-      mbuffer_free(&chunk->uncompressed_data);
-      free(chunk);
-      chunk = NULL;
-      break;
-    }
-    //Shrink buffer to actual size
-    if(bytes_left+bytes_read < chunk->uncompressed_data.n) {
-      r = mbuffer_realloc(&chunk->uncompressed_data, bytes_left+bytes_read);
-      assert(r == 0);
+      //No data left over from last iteration and also nothing new read in, simply clean up and quit
+      if(bytes_left + bytes_read == 0) {
+        mbuffer_free(&chunk->uncompressed_data);
+        slab_free(&chunk_slab, &chunk_cache, chunk);
+        chunk = NULL;
+        break;
+      }
+      //Shrink buffer to actual size
+      if(bytes_left+bytes_read < chunk->uncompressed_data.n) {
+        r = mbuffer_realloc(&chunk->uncompressed_data, bytes_left+bytes_read);
+        assert(r == 0);
+      }
     }
 
     //Check whether any new data was read in, process last chunk if not
@@ -877,7 +958,7 @@ void *SerialIntegratedPipeline(void * targs) {
 
       write_chunk_to_file(fd_out, chunk);
       if(chunk->header.isDuplicate) {
-        free(chunk);
+        slab_free(&chunk_slab, &chunk_cache, chunk);
         chunk=NULL;
       }
 
@@ -889,8 +970,8 @@ void *SerialIntegratedPipeline(void * targs) {
     int split;
     do {
       split = 0;
-      //Try to split the buffer
-      int offset = rabinseg(chunk->uncompressed_data.ptr, chunk->uncompressed_data.n, rf_win_dataprocess, rabintab, rabinwintab);
+      //Try to split the buffer, a mapped input can be too large to be scanned in one go
+      int offset = chunkseg(chunk->uncompressed_data.ptr, MIN(chunk->uncompressed_data.n, MAXBUF), rf_win_dataprocess, rabintab, rabinwintab);
       //Did we find a split location?
       if(offset == 0) {
         //Split found at the very beginning of the buffer (should never happen due to technical limitations)
@@ -899,7 +980,7 @@ void *SerialIntegratedPipeline(void * targs) {
       } else if(offset < chunk->uncompressed_data.n) {
         //Split found somewhere in the middle of the buffer
         //Allocate a new chunk and create a new memory buffer
-        temp = (chunk_t *)malloc(sizeof(chunk_t));
+        temp = (chunk_t *)slab_alloc(&chunk_slab, &chunk_cache);
         if(temp==NULL) EXIT_TRACE("Memory allocation failed.\n");
 
         //split it into two pieces
@@ -932,7 +1013,7 @@ void *SerialIntegratedPipeline(void * targs) {
 
         write_chunk_to_file(fd_out, chunk);
         if(chunk->header.isDuplicate){
-          free(chunk);
+          slab_free(&chunk_slab, &chunk_cache, chunk);
           chunk=NULL;
         }
 
@@ -953,7 +1034,7 @@ void *SerialIntegratedPipeline(void * targs) {
   free(rabintab);
   free(rabinwintab);
 
-  close(fd_out);
+  close_output_file(fd_out);
 
   return NULL;
 }
@@ -962,7 +1043,7 @@ void *SerialIntegratedPipeline(void * targs) {
  * Pipeline stage function of fragmentation stage
  *
  * Actions performed:
- *  - Read data from file (or preloading buffer)
+ *  - Read data from file (or preloading buffer, or take views of the mapped input)
  *  - Perform coarse-grained chunking
  *  - Send coarse chunks to refinement stages for further processing
  *
@@ -984,6 +1065,7 @@ void *Fragment(void * targs){
   int i;
 
   ringbuffer_t send_buf;
+  slab_cache_t chunk_cache;
   sequence_number_t anchorcount = 0;
   int r;
 
@@ -1000,6 +1082,7 @@ void *Fragment(void * targs){
 
   rf_win_dataprocess = 0;
   rabininit(rf_win_dataprocess, rabintab, rabinwintab);
+  slab_cache_init(&chunk_cache);
 
   //Sanity check
   if(MAXBUF < 8 * ANCHOR_JUMP) {
@@ -1009,87 +1092,110 @@ void *Fragment(void * targs){
 
   //read from input file / buffer
   while (1) {
-    size_t bytes_left; //amount of data left over in last_mbuffer from previous iteration
+    size_t bytes_read=0;
 
-    //Check how much data left over from previous iteration resp. create an initial chunk
-    if(temp != NULL) {
-      bytes_left = temp->uncompressed_data.n;
+    if(conf->mmap_input) {
+      //The rest of the mapped input becomes the next buffer, no data is copied
+      if(temp != NULL) {
+        //No split location in the rest of the input, process it as the last chunk
+        chunk = temp;
+        temp = NULL;
+      } else {
+        if(preloading_buffer_seek == args->input_file.size) break;
+        chunk = (chunk_t *)slab_alloc(&chunk_slab, &chunk_cache);
+        if(chunk==NULL) EXIT_TRACE("Memory allocation failed.\n");
+        r = mbuffer_wrap(&chunk->uncompressed_data, args->input_file.buffer+preloading_buffer_seek, args->input_file.size-preloading_buffer_seek);
+        if(r!=0) {
+          EXIT_TRACE("Unable to initialize memory buffer.\n");
+        }
+        chunk->header.state = CHUNK_STATE_UNCOMPRESSED;
+        chunk->sequence.l1num = anchorcount;
+        anchorcount++;
+        bytes_read = args->input_file.size-preloading_buffer_seek;
+        preloading_buffer_seek = args->input_file.size;
+      }
     } else {
-      bytes_left = 0;
-    }
+      size_t bytes_left; //amount of data left over in last_mbuffer from previous iteration
 
-    //Make sure that system supports new buffer size
-    if(MAXBUF+bytes_left > SSIZE_MAX) {
-      EXIT_TRACE("Input buffer size exceeds system maximum.\n");
-    }
-    //Allocate a new chunk and create a new memory buffer
-    chunk = (chunk_t *)malloc(sizeof(chunk_t));
-    if(chunk==NULL) EXIT_TRACE("Memory allocation failed.\n");
-    r = mbuffer_create(&chunk->uncompressed_data, MAXBUF+bytes_left);
-    if(r!=0) {
-      EXIT_TRACE("Unable to initialize memory buffer.\n");
-    }
-    if(bytes_left > 0) {
-      //FIXME: Short-circuit this if no more data available
+      //Check how much data left over from previous iteration resp. create an initial chunk
+      if(temp != NULL) {
+        bytes_left = temp->uncompressed_data.n;
+      } else {
+        bytes_left = 0;
+      }
 
-      //"Extension" of existing buffer, copy sequence number and left over data to beginning of new buffer
-      chunk->header.state = CHUNK_STATE_UNCOMPRESSED;
-      chunk->sequence.l1num = temp->sequence.l1num;
+      //Make sure that system supports new buffer size
+      if(MAXBUF+bytes_left > SSIZE_MAX) {
+        EXIT_TRACE("Input buffer size exceeds system maximum.\n");
+      }
+      //Allocate a new chunk and create a new memory buffer
+      chunk = (chunk_t *)slab_alloc(&chunk_slab, &chunk_cache);
+      if(chunk==NULL) EXIT_TRACE("Memory allocation failed.\n");
+      r = mbuffer_create(&chunk->uncompressed_data, MAXBUF+bytes_left);
+      if(r!=0) {
+        EXIT_TRACE("Unable to initialize memory buffer.\n");
+      }
+      if(bytes_left > 0) {
+        //FIXME: Short-circuit this if no more data available
 
-      //NOTE: We cannot safely extend the current memory region because it has already been given to another thread
-      memcpy(chunk->uncompressed_data.ptr, temp->uncompressed_data.ptr, temp->uncompressed_data.n);
-      mbuffer_free(&temp->uncompressed_data);
-      free(temp);
-      temp = NULL;
-    } else {
-      //brand new mbuffer, increment sequence number
-      chunk->header.state = CHUNK_STATE_UNCOMPRESSED;
-      chunk->sequence.l1num = anchorcount;
-      anchorcount++;
-    }
-    //Read data until buffer full
-    size_t bytes_read=0;
-    if(conf->preloading) {
-      size_t max_read = MIN(MAXBUF, args->input_file.size-preloading_buffer_seek);
-      memcpy(chunk->uncompressed_data.ptr+bytes_left, args->input_file.buffer+preloading_buffer_seek, max_read);
-      bytes_read = max_read;
-      preloading_buffer_seek += max_read;
-    } else {
-      while(bytes_read < MAXBUF) {
-        r = read(fd, chunk->uncompressed_data.ptr+bytes_left+bytes_read, MAXBUF-bytes_read);
-        if(r<0) switch(errno) {
-          case EAGAIN:
-            EXIT_TRACE("I/O error: No data available\n");break;
-          case EBADF:
-            EXIT_TRACE("I/O error: Invalid file descriptor\n");break;
-          case EFAULT:
-            EXIT_TRACE("I/O error: Buffer out of range\n");break;
-          case EINTR:
-            EXIT_TRACE("I/O error: Interruption\n");break;
-          case EINVAL:
-            EXIT_TRACE("I/O error: Unable to read from file descriptor\n");break;
-          case EIO:
-            EXIT_TRACE("I/O error: Generic I/O error\n");break;
-          case EISDIR:
-            EXIT_TRACE("I/O error: Cannot read from a directory\n");break;
-          default:
-            EXIT_TRACE("I/O error: Unrecognized error\n");break;
+        //"Extension" of existing buffer, copy sequence number and left over data to beginning of new buffer
+        chunk->header.state = CHUNK_STATE_UNCOMPRESSED;
+        chunk->sequence.l1num = temp->sequence.l1num;
+
+        //NOTE: We cannot safely extend the current memory region because it has already been given to another thread
+        memcpy(chunk->uncompressed_data.ptr, temp->uncompressed_data.ptr, temp->uncompressed_data.n);
+        mbuffer_free(&temp->uncompressed_data);
+        slab_free(&chunk_slab, &chunk_cache, temp);
+        temp = NULL;
+      } else {
+        //brand new mbuffer, increment sequence number
+        chunk->header.state = CHUNK_STATE_UNCOMPRESSED;
+        chunk->sequence.l1num = anchorcount;
+        anchorcount++;
+      }
+      //Read data until buffer full
+      if(conf->preloading) {
+        size_t max_read = MIN(MAXBUF, args->input_file.size-preloading_buffer_seek);
+        memcpy(chunk->uncompressed_data.ptr+bytes_left, args->input_file.buffer+preloading_buffer_seek, max_read);
+        bytes_read = max_read;
+        preloading_buffer_seek += max_read;
+      } else {
+        while(bytes_read < MAXBUF) {
+          r = read(fd, chunk->uncompressed_data.ptr+bytes_left+bytes_read, MAXBUF-bytes_read);
+          if(r<0) switch(errno) {
+            case EAGAIN:
+              EXIT_TRACE("I/O error: No data available\n");break;
+            case EBADF:
+              EXIT_TRACE("I/O error: Invalid file descriptor\n");break;
+            case EFAULT:
+              EXIT_TRACE("I/O error: Buffer out of range\n");break;
+            case EINTR:
+              EXIT_TRACE("I/O error: Interruption\n");break;
+            case EINVAL:
+              EXIT_TRACE("I/O error: Unable to read from file descriptor\n");break;
+            case EIO:
+              EXIT_TRACE("I/O error: Generic I/O error\n");break;
+            case EISDIR:
+              EXIT_TRACE("I/O error: Cannot read from a directory\n");break;
+            default:
+              EXIT_TRACE("I/O error: Unrecognized error\n");break;
+          }
+          if(r==0) break;
+          bytes_read += r;
         }
-        if(r==0) break;
-        bytes_read += r;
       }
-    }
-    //No data left over from last iteration and also nothing new read in, simply clean up and quit
-    if(bytes_left + bytes_read == 0) {
-      mbuffer_free(&chunk->uncompressed_data);
-      free(chunk);
-      chunk = NULL;
-      break;
-    }
-    //Shrink buffer to actual size
-    if(bytes_left+bytes_read < chunk->uncompressed_data.n) {
-      r = mbuffer_realloc(&chunk->uncompressed_data, bytes_left+bytes_read);
-      assert(r == 0);
+      //No data left over from last iteration and also nothing new read in, simply clean up and quit
+      if(bytes_left + bytes_read == 0) {
+        mbuffer_free(&chunk->uncompressed_data);
+        slab_free(&chunk_slab, &chunk_cache, chunk);
+        chunk = NULL;
+        break;
+      }
+      //Shrink buffer to actual size
+      if(bytes_left+bytes_read < chunk->uncompressed_data.n) {
+        r = mbuffer_realloc(&chunk->uncompressed_data, bytes_left+bytes_read);
+        assert(r == 0);
+      }
     }
     //Check whether any new data was read in, enqueue last chunk if not
     if(bytes_read == 0) {
@@ -1105,7 +1211,9 @@ void *Fragment(void * targs){
       split = 0;
       //Try to split the buffer at least ANCHOR_JUMP bytes away from its beginning
       if(ANCHOR_JUMP < chunk->uncompressed_data.n) {
-        int offset = rabinseg(chunk->uncompressed_data.ptr + ANCHOR_JUMP, chunk->uncompressed_data.n - ANCHOR_JUMP, rf_win_dataprocess, rabintab, rabinwintab);
+        //NOTE: Without a split location a coarse chunk is cut after ANCHOR_JUMP+MAXBUF bytes, so the
+        //      scanned window stays small even for a mapped input and both inputs are split the same way
+        int offset = chunkseg(chunk->uncompressed_data.ptr + ANCHOR_JUMP, MIN(chunk->uncompressed_data.n - ANCHOR_JUMP, MAXBUF), rf_win_dataprocess, rabintab, rabinwintab);
         //Did we find a split location?
         if(offset == 0) {
           //Split found at the very beginning of the buffer (should never happen due to technical limitations)
@@ -1114,7 +1222,7 @@ void *Fragment(void * targs){
         } else if(offset + ANCHOR_JUMP < chunk->uncompressed_data.n) {
           //Split found somewhere in the middle of the buffer
           //Allocate a new chunk and create a new memory buffer
-          temp = (chunk_t *)malloc(sizeof(chunk_t));
+          temp = (chunk_t *)slab_alloc(&chunk_slab, &chunk_cache);
           if(temp==NULL) EXIT_TRACE("Memory allocation failed.\n");
 
           //split it into two pieces
@@ -1196,6 +1304,7 @@ void *Reorder(void * targs) {
   int fd = 0;
 
   ringbuffer_t recv_buf;
+  slab_cache_t chunk_cache;
   chunk_t *chunk;
 
   SearchTree T;
@@ -1219,6 +1328,7 @@ void *Reorder(void * targs) {
 
   r = ringbuffer_init(&recv_buf, ITEM_PER_FETCH);
   assert(r==0);
+  slab_cache_init(&chunk_cache);
 
   fd = create_output_file(conf->outfile);
 
@@ -1269,7 +1379,7 @@ void *Reorder(void * targs) {
     do {
       write_chunk_to_file(fd, chunk);
       if(chunk->header.isDuplicate) {
-        free(chunk);
+        slab_free(&chunk_slab, &chunk_cache, chunk);
         chunk=NULL;
       }
       sequence_inc_l2(&next);
@@ -1320,7 +1430,7 @@ void *Reorder(void * targs) {
     }
     write_chunk_to_file(fd, chunk);
     if(chunk->header.isDuplicate) {
-      free(chunk);
+      slab_free(&chunk_slab, &chunk_cache, chunk);
       chunk=NULL;
     }
     sequence_inc_l2(&next);
@@ -1328,7 +1438,7 @@ void *Reorder(void * targs) {
 
   }
 
-  close(fd);
+  close_output_file(fd);
 
   ringbuffer_destroy(&recv_buf);
   free(chunks_per_anchor);
@@ -1357,12 +1467,38 @@ void Encode(config_t * _conf) {
   init_stats(&stats);
 #endif
 
+  gearinit();
+
   //Create chunk cache
-  cache = hashtable_create(65536, hash_from_key_fn, keys_equal_fn, FALSE);
+  cache = fpindex_create(65536);
   if(cache == NULL) {
     printf("ERROR: Out of memory\n");
     exit(1);
   }
+  if(slab_init(&chunk_slab, sizeof(chunk_t)) != 0) {
+    printf("ERROR: Unable to initialize chunk allocator\n");
+    exit(1);
+  }
+
+  //Open persistent index and add the output file to it as a new archive
+  //NOTE: Archives are identified by their absolute path, which requires the output file to exist
+  store = NULL;
+  if(strlen(conf->indexfile) > 0) {
+    char archive[PATH_MAX];
+    int fd_out;
+
+    store = fpstore_open(conf->indexfile, conf->compress_type);
+    fd_out = open(conf->outfile, O_CREAT|O_WRONLY, S_IRGRP | S_IWUSR | S_IRUSR | S_IROTH);
+    if(fd_out < 0 || realpath(conf->outfile, archive) == NULL) {
+      EXIT_TRACE("Cannot open output file.\n");
+    }
+    close(fd_out);
+    //Overwriting an archive would break all references to it
+    if(fpstore_find_archive(store, archive) >= 0) {
+      EXIT_TRACE("%s is referenced by index %s, use a different output file.\n", archive, conf->indexfile);
+    }
+    store_archive = fpstore_add_archive(store, archive);
+  }
 
 #ifdef ENABLE_PTHREADS
   struct thread_args data_process_args;
@@ -1415,9 +1551,38 @@ void Encode(config_t * _conf) {
   if((fd = open(conf->infile, O_RDONLY | O_LARGEFILE)) < 0) 
     EXIT_TRACE("%s file open error %s\n", conf->infile, strerror(errno));
 
+  //Map the input file instead of reading it if requested by user
+  //The chunks will be views of the mapping, so the input data is never copied
+  void *mapping = NULL;
+  if(conf->mmap_input) {
+    if(filestat.st_size > 0) {
+      mapping = mmap(NULL, filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(mapping == MAP_FAILED)
+        EXIT_TRACE("mmap() %s failed: %s\n", conf->infile, strerror(errno));
+      posix_madvise(mapping, filestat.st_size, POSIX_MADV_SEQUENTIAL);
+
+      //Fault in the entire mapping if preloading is requested
+      if(conf->preloading) {
+        volatile uchar sum = 0;
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t i;
+        for(i=0; i<filestat.st_size; i+=page) {
+          sum += ((uchar *)mapping)[i];
+        }
+      }
+    }
+#ifdef ENABLE_PTHREADS
+    data_process_args.input_file.size = filestat.st_size;
+    data_process_args.input_file.buffer = mapping;
+#else
+    generic_args.input_file.size = filestat.st_size;
+    generic_args.input_file.buffer = mapping;
+#endif //ENABLE_PTHREADS
+  }
+
   //Load entire file into memory if requested by user
   void *preloading_buffer = NULL;
-  if(conf->preloading) {
+  if(conf->preloading && !conf->mmap_input) {
     size_t bytes_read=0;
     int r;
 
@@ -1572,17 +1737,28 @@ void Encode(config_t * _conf) {
 #endif //ENABLE_PTHREADS
 
   //clean up after preloading
-  if(conf->preloading) {
+  if(conf->preloading && !conf->mmap_input) {
     free(preloading_buffer);
   }
 
+  //All chunks have been written, nothing refers to the mapping anymore
+  if(mapping != NULL) {
+    munmap(mapping, filestat.st_size);
+  }
+
   /* clean up with the src file */
   if (conf->infile != NULL)
     close(fd);
 
   assert(!mbuffer_system_destroy());
 
-  hashtable_destroy(cache, TRUE);
+  //The chunks in the index are released together with the slab
+  fpindex_destroy(cache, FALSE);
+  slab_destroy(&chunk_slab);
+
+  if(store != NULL) {
+    fpstore_close(store);
+  }
 
 #ifdef ENABLE_STATISTICS
   /* dest file stat */
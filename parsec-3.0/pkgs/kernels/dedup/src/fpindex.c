@@ -0,0 +1,239 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "util.h"
+#include "debug.h"
+#include "fpindex.h"
+
+#ifdef ENABLE_PTHREADS
+#include <sched.h>
+#endif //ENABLE_PTHREADS
+
+#define SHA1_WORDS (SHA1_LEN/sizeof(unsigned int))
+
+//Special values of a slot: never used, claimed by an inserter which is still
+//writing the SHA1 sum, and closed to insertions because the table is resized
+#define SLOT_EMPTY ((void *)0)
+#define SLOT_BUSY ((void *)1)
+#define SLOT_SEALED ((void *)2)
+#define SLOT_ISVALUE(v) ((uintptr_t)(v) > (uintptr_t)SLOT_SEALED)
+
+//Only every FPINDEX_SAMPLE-th insertion (by SHA1 sum) updates the entry count
+//of a table, which keeps the shared counter from becoming a hot spot
+#define FPINDEX_SAMPLE 16
+
+//A table is resized once it is half full or a probe gets longer than this
+#define FPINDEX_MAX_PROBE 256
+
+//Number of old slots a thread moves whenever it uses a table being resized
+#define FPINDEX_MIGRATE_CHUNK 256
+
+typedef struct {
+  unsigned int sha1[SHA1_WORDS];
+  void *value;
+} fpindex_entry_t;
+
+struct fpindex_table {
+  fpindex_entry_t *entries;
+  size_t mask;
+  //Sampled number of entries
+  size_t count;
+  //Table the entries are being moved to, NULL unless resizing
+  struct fpindex_table *next;
+  //Next slot to move and number of slots moved so far
+  size_t migrate_pos;
+  size_t migrated;
+  //Previous (retired) table
+  struct fpindex_table *prev;
+};
+
+struct fpindex {
+  struct fpindex_table *current;
+};
+
+static struct fpindex_table *table_create(size_t capacity) {
+  struct fpindex_table *t;
+
+  t = (struct fpindex_table *)malloc(sizeof(struct fpindex_table));
+  if(t == NULL) EXIT_TRACE("Memory allocation failed.\n");
+  //Slots start out empty, so the table can be zero-filled lazily by calloc
+  t->entries = (fpindex_entry_t *)calloc(capacity, sizeof(fpindex_entry_t));
+  if(t->entries == NULL) EXIT_TRACE("Memory allocation failed.\n");
+  t->mask = capacity - 1;
+  t->count = 0;
+  t->next = NULL;
+  t->migrate_pos = 0;
+  t->migrated = 0;
+  t->prev = NULL;
+  return t;
+}
+
+static inline int sha1_equal(const unsigned int *a, const unsigned int *b) {
+  int i;
+
+  for(i=0; i<SHA1_WORDS; i++) {
+    if(a[i] != b[i]) return 0;
+  }
+  return 1;
+}
+
+//Wait for an inserter to finish writing the SHA1 sum of slot `e'
+static inline void *slot_wait(fpindex_entry_t *e) {
+  void *v;
+
+  while((v = __atomic_load_n(&e->value, __ATOMIC_ACQUIRE)) == SLOT_BUSY) {
+#ifdef ENABLE_PTHREADS
+    sched_yield();
+#endif
+  }
+  return v;
+}
+
+//Attach a table of twice the size to `t' unless it already has one
+static void table_grow(struct fpindex_table *t) {
+  struct fpindex_table *nt, *expected = NULL;
+
+  if(__atomic_load_n(&t->next, __ATOMIC_ACQUIRE) != NULL) return;
+  nt = table_create(2 * (t->mask + 1));
+  nt->prev = t;
+  if(!__atomic_compare_exchange_n(&t->next, &expected, nt, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    free(nt->entries);
+    free(nt);
+  }
+}
+
+/* Probe `t' for a SHA1 sum. Returns the value if it is found.
+ * Otherwise, if `value' is non-NULL and the table is not being resized the
+ * SHA1 sum is inserted and NULL is returned. If the table is being resized
+ * the first empty slot of the probe sequence is sealed instead, so no thread
+ * can add the SHA1 sum to this table anymore, and SLOT_SEALED is returned. */
+static void *table_probe(struct fpindex_table *t, const unsigned int *sha1, void *value) {
+  size_t i, n;
+
+  i = sha1[0];
+  for(n=0; n<=t->mask; n++, i++) {
+    fpindex_entry_t *e = &t->entries[i & t->mask];
+    void *v = __atomic_load_n(&e->value, __ATOMIC_ACQUIRE);
+
+    if(v == SLOT_EMPTY) {
+      if(n >= FPINDEX_MAX_PROBE) table_grow(t);
+      if(value == NULL || __atomic_load_n(&t->next, __ATOMIC_ACQUIRE) != NULL) {
+        if(__atomic_compare_exchange_n(&e->value, &v, SLOT_SEALED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return SLOT_SEALED;
+      } else {
+        if(__atomic_compare_exchange_n(&e->value, &v, SLOT_BUSY, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+          memcpy(e->sha1, sha1, SHA1_LEN);
+          __atomic_store_n(&e->value, value, __ATOMIC_RELEASE);
+          if((sha1[SHA1_WORDS-1] & (FPINDEX_SAMPLE-1)) == 0) {
+            size_t count = __atomic_add_fetch(&t->count, 1, __ATOMIC_RELAXED);
+            if(count * FPINDEX_SAMPLE >= (t->mask + 1) / 2) table_grow(t);
+          }
+          return NULL;
+        }
+      }
+      //Lost the race for the slot, v now holds its new value
+    }
+    if(v == SLOT_BUSY) v = slot_wait(e);
+    if(v == SLOT_SEALED) return SLOT_SEALED;
+    if(sha1_equal(e->sha1, sha1)) return v;
+  }
+  //Table full (only possible for tiny tables due to sampling), nothing can be
+  //added to it anymore
+  table_grow(t);
+  return SLOT_SEALED;
+}
+
+static void *insert_from(struct fpindex *idx, struct fpindex_table *t, const unsigned int *sha1, void *value);
+
+//Move one slot of `t' to its next table
+static void migrate_slot(struct fpindex *idx, struct fpindex_table *t, fpindex_entry_t *e) {
+  void *v = SLOT_EMPTY;
+
+  if(__atomic_compare_exchange_n(&e->value, &v, SLOT_SEALED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return;
+  if(v == SLOT_BUSY) v = slot_wait(e);
+  if(v == SLOT_SEALED) return;
+  //Entries are never modified once written, so it is safe to copy them while they stay readable here
+  insert_from(idx, __atomic_load_n(&t->next, __ATOMIC_ACQUIRE), e->sha1, v);
+}
+
+//Make the first table that is not completely migrated the current one
+static void advance(struct fpindex *idx) {
+  struct fpindex_table *c = __atomic_load_n(&idx->current, __ATOMIC_ACQUIRE);
+
+  while(__atomic_load_n(&c->next, __ATOMIC_ACQUIRE) != NULL && __atomic_load_n(&c->migrated, __ATOMIC_ACQUIRE) > c->mask) {
+    __atomic_compare_exchange_n(&idx->current, &c, __atomic_load_n(&c->next, __ATOMIC_ACQUIRE), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    c = __atomic_load_n(&idx->current, __ATOMIC_ACQUIRE);
+  }
+}
+
+//Move a chunk of slots of `t', which is being resized, to its next table.
+//Returns 0 once there is nothing left to claim.
+static int migrate(struct fpindex *idx, struct fpindex_table *t) {
+  size_t first, i, n;
+
+  first = __atomic_fetch_add(&t->migrate_pos, FPINDEX_MIGRATE_CHUNK, __ATOMIC_RELAXED);
+  if(first > t->mask) return 0;
+  n = t->mask + 1 - first;
+  if(n > FPINDEX_MIGRATE_CHUNK) n = FPINDEX_MIGRATE_CHUNK;
+  for(i=first; i<first+n; i++) {
+    migrate_slot(idx, t, &t->entries[i]);
+  }
+  if(__atomic_add_fetch(&t->migrated, n, __ATOMIC_ACQ_REL) > t->mask) advance(idx);
+  return 1;
+}
+
+//Look up or insert a SHA1 sum, starting with table `t'
+static void *insert_from(struct fpindex *idx, struct fpindex_table *t, const unsigned int *sha1, void *value) {
+  void *v;
+
+  while(1) {
+    //Tables being resized are only searched, new entries go to the newest one
+    if(__atomic_load_n(&t->next, __ATOMIC_ACQUIRE) != NULL) {
+      migrate(idx, t);
+      v = table_probe(t, sha1, NULL);
+      if(v != SLOT_SEALED) return v;
+      t = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+      continue;
+    }
+    v = table_probe(t, sha1, value);
+    //Table started resizing while we were probing, continue with its next table
+    if(v != SLOT_SEALED) return v;
+  }
+}
+
+struct fpindex *fpindex_create(size_t size) {
+  struct fpindex *idx;
+  size_t capacity;
+
+  idx = (struct fpindex *)malloc(sizeof(struct fpindex));
+  if(idx == NULL) return NULL;
+  for(capacity=1; capacity<2*size; capacity*=2);
+  idx->current = table_create(capacity);
+  return idx;
+}
+
+void *fpindex_insert(struct fpindex *idx, const unsigned int *sha1, void *value) {
+  assert(value != NULL && SLOT_ISVALUE(value));
+  return insert_from(idx, __atomic_load_n(&idx->current, __ATOMIC_ACQUIRE), sha1, value);
+}
+
+void fpindex_destroy(struct fpindex *idx, int free_values) {
+  struct fpindex_table *t, *prev;
+  size_t i;
+
+  //Finish any pending resize so the newest table holds every entry
+  for(t=idx->current; t->next!=NULL; t=t->next) {
+    while(migrate(idx, t));
+  }
+  if(free_values) {
+    for(i=0; i<=t->mask; i++) {
+      if(SLOT_ISVALUE(t->entries[i].value)) free(t->entries[i].value);
+    }
+  }
+  for(; t!=NULL; t=prev) {
+    prev = t->prev;
+    free(t->entries);
+    free(t);
+  }
+  free(idx);
+}
@@ -0,0 +1,39 @@
+/* This file contains the fingerprint index used by the deduplication stage:
+ * A hash table which maps the SHA1 sum of a chunk to the first chunk seen
+ * with that content.
+ *
+ * The table uses open addressing with linear probing and stores the SHA1
+ * sums inline, so a lookup usually touches a single cache line. Entries are
+ * never removed. Lookups do not lock, and new entries are claimed with a CAS
+ * on the value of an empty slot.
+ *
+ * Note on resizing:
+ * Once a table is half full, a table of twice the size is attached to it.
+ * Every thread that uses the index while it is being resized moves a few old
+ * entries over, so no thread has to wait for the whole table to be copied.
+ * Old tables are kept until the index is destroyed, because threads may
+ * still be reading them.
+ */
+
+#ifndef _FPINDEX_H_
+#define _FPINDEX_H_
+
+#include <stdlib.h>
+
+#include "sha.h"
+
+struct fpindex;
+
+//Create an index with room for about `size' entries before its first resize
+struct fpindex *fpindex_create(size_t size);
+
+//Destroy an index, freeing all values still in it if free_values is set
+void fpindex_destroy(struct fpindex *idx, int free_values);
+
+//Look up a SHA1 sum and add it with `value' if it is not in the index yet.
+//Returns the value stored for the SHA1 sum before the call, or NULL if
+//`value' was inserted. Values must be pointers to objects that are at least
+//integer-aligned.
+void *fpindex_insert(struct fpindex *idx, const unsigned int *sha1, void *value);
+
+#endif //_FPINDEX_H_
@@ -0,0 +1,456 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "util.h"
+#include "debug.h"
+#include "fpstore.h"
+
+#define SHA1_WORDS (SHA1_LEN/sizeof(unsigned int))
+
+#define FPSTORE_MAGIC 0x78647064
+#define FPSTORE_DIR_MAGIC 0x72647064
+#define FPSTORE_VERSION 1
+
+//Types of log records
+#define RECORD_CHUNK 1
+#define RECORD_ARCHIVE 2
+
+//Initial number of directory slots, must be a power of two
+#define FPSTORE_MIN_SLOTS 65536
+
+//Initial size of the buffer for records not written to the log yet, and
+//maximum size of a record
+#define FPSTORE_BUFFER (64*1024)
+
+//A directory slot holds the offset of a chunk record in the low bits and 16
+//bits of its SHA1 sum in the high bits, 0 marks an empty slot
+#define SLOT_OFFSET_BITS 48
+#define SLOT_OFFSET(v) ((v) & (((u_int64)1 << SLOT_OFFSET_BITS) - 1))
+#define SLOT_TAG(sha1) ((u_int64)((sha1)[1] & 0xffff) << SLOT_OFFSET_BITS)
+
+typedef struct {
+  u_int32 magic;
+  u_int32 version;
+  u_int32 compress_type;
+  u_int32 unused;
+} log_header_t;
+
+//Every record starts with its type and size, sizes are multiples of 8
+typedef struct {
+  u_int32 type;
+  u_int32 size;
+} record_t;
+
+typedef struct {
+  record_t r;
+  unsigned int sha1[SHA1_WORDS];
+  u_int32 archive;
+  u_int64 offset;
+  u_int64 len;
+} chunk_record_t;
+
+//Archive records are chained, so their names can be found without reading the whole log
+typedef struct {
+  record_t r;
+  u_int32 id;
+  u_int32 unused;
+  u_int64 prev; //offset of the previous archive record
+  char name[]; //NUL-terminated, padded with zeros
+} archive_record_t;
+
+typedef struct {
+  u_int32 magic;
+  u_int32 version;
+  u_int64 nslots;
+  u_int64 nchunks;
+  //Size of the prefix of the log covered by the directory, and the archives in it
+  u_int64 log_size;
+  u_int64 last_archive;
+  u_int64 narchives;
+  //Checksum of the fields above and of all slots
+  u_int64 checksum;
+} dir_header_t;
+
+struct fpstore {
+  char *dirpath;
+  //The log and its mapping
+  int fd;
+  char *log;
+  size_t log_mapped;
+  //The directory and its mapping
+  int dirfd;
+  dir_header_t *dir;
+  u_int64 *slots;
+  //Names of all archives, indexed by id
+  char **names;
+  u_int32 narchives;
+  //Records not written to the log yet, end of the log and last archive record including them
+  char *buf;
+  size_t nbuf, bufsize;
+  u_int64 log_end;
+  u_int64 last_archive;
+};
+
+static inline size_t dir_size(u_int64 nslots) {
+  return sizeof(dir_header_t) + nslots * sizeof(u_int64);
+}
+
+static inline int sha1_equal(const unsigned int *a, const unsigned int *b) {
+  return memcmp(a, b, SHA1_LEN) == 0;
+}
+
+//Map the whole log, replacing any previous mapping
+static void map_log(struct fpstore *s) {
+  struct stat st;
+
+  if(s->log != NULL) munmap(s->log, s->log_mapped);
+  if(fstat(s->fd, &st) < 0) EXIT_TRACE("fstat() of index failed: %s\n", strerror(errno));
+  s->log_mapped = st.st_size;
+  s->log = (char *)mmap(NULL, s->log_mapped, PROT_READ, MAP_SHARED, s->fd, 0);
+  if(s->log == MAP_FAILED) EXIT_TRACE("mmap() of index failed: %s\n", strerror(errno));
+}
+
+//Write all buffered records to the log
+static void flush(struct fpstore *s) {
+  if(s->nbuf > 0 && xwrite(s->fd, s->buf, s->nbuf) < 0) {
+    EXIT_TRACE("Cannot write index: %s\n", strerror(errno));
+  }
+  s->nbuf = 0;
+}
+
+//Reserve zero-filled space for a record of `size' bytes at the end of the log.
+//Records are only written by sync_dir, so that none of them reaches the log
+//before the archive data it points to is on disk.
+static void *append(struct fpstore *s, size_t size) {
+  void *p;
+
+  assert(size % 8 == 0 && size <= FPSTORE_BUFFER);
+  if(s->nbuf + size > s->bufsize) {
+    char *buf = (char *)realloc(s->buf, 2 * s->bufsize);
+    if(buf == NULL) EXIT_TRACE("Memory allocation failed.\n");
+    s->buf = buf;
+    s->bufsize *= 2;
+  }
+  p = s->buf + s->nbuf;
+  memset(p, 0, size);
+  s->nbuf += size;
+  s->log_end += size;
+  return p;
+}
+
+//FNV-1a over 64-bit words of the directory header and all slots
+static u_int64 dir_checksum(dir_header_t *d) {
+  u_int64 *slots = (u_int64 *)(d + 1);
+  u_int64 h = 0xcbf29ce484222325ULL;
+  u_int64 i;
+
+  h = (h ^ d->magic ^ ((u_int64)d->version << 32)) * 0x100000001b3ULL;
+  h = (h ^ d->nslots) * 0x100000001b3ULL;
+  h = (h ^ d->nchunks) * 0x100000001b3ULL;
+  h = (h ^ d->log_size) * 0x100000001b3ULL;
+  h = (h ^ d->last_archive) * 0x100000001b3ULL;
+  h = (h ^ d->narchives) * 0x100000001b3ULL;
+  for(i=0; i<d->nslots; i++) {
+    h = (h ^ slots[i]) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+//Add the chunk record at offset `off' of the log to the directory, unless
+//its SHA1 sum is already in it (records may be added again after a crash)
+static void dir_insert(struct fpstore *s, u_int64 off) {
+  chunk_record_t *c = (chunk_record_t *)(s->log + off);
+  u_int64 mask = s->dir->nslots - 1;
+  u_int64 i, v;
+
+  for(i=c->sha1[0] & mask; (v = s->slots[i]) != 0; i=(i+1) & mask) {
+    if((v & ~SLOT_OFFSET(v)) == SLOT_TAG(c->sha1) && sha1_equal(((chunk_record_t *)(s->log + SLOT_OFFSET(v)))->sha1, c->sha1)) return;
+  }
+  s->slots[i] = SLOT_TAG(c->sha1) | off;
+  s->dir->nchunks++;
+}
+
+//Replace the directory by one with `nslots' slots which holds the same
+//entries. The new directory is written to a temporary file first, so the old
+//one stays intact until it is replaced.
+static void dir_create(struct fpstore *s, u_int64 nslots) {
+  dir_header_t *old = s->dir;
+  u_int64 *old_slots = s->slots;
+  int old_fd = s->dirfd;
+  char tmppath[strlen(s->dirpath) + 5];
+  dir_header_t *d;
+  u_int64 i;
+  int fd;
+
+  sprintf(tmppath, "%s.tmp", s->dirpath);
+  fd = open(tmppath, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if(fd < 0) EXIT_TRACE("Cannot create %s: %s\n", tmppath, strerror(errno));
+  if(ftruncate(fd, dir_size(nslots)) < 0) EXIT_TRACE("Cannot resize %s: %s\n", tmppath, strerror(errno));
+  d = (dir_header_t *)mmap(NULL, dir_size(nslots), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(d == MAP_FAILED) EXIT_TRACE("mmap() of %s failed: %s\n", tmppath, strerror(errno));
+
+  d->magic = FPSTORE_DIR_MAGIC;
+  d->version = FPSTORE_VERSION;
+  d->nslots = nslots;
+  d->nchunks = 0;
+  if(old != NULL) {
+    d->log_size = old->log_size;
+    d->last_archive = old->last_archive;
+    d->narchives = old->narchives;
+  } else {
+    d->log_size = sizeof(log_header_t);
+    d->last_archive = 0;
+    d->narchives = 0;
+  }
+  s->dir = d;
+  s->slots = (u_int64 *)(d + 1);
+  s->dirfd = fd;
+
+  if(old != NULL) {
+    for(i=0; i<old->nslots; i++) {
+      if(old_slots[i] != 0) dir_insert(s, SLOT_OFFSET(old_slots[i]));
+    }
+    munmap(old, dir_size(old->nslots));
+    close(old_fd);
+  }
+
+  d->checksum = dir_checksum(d);
+  msync(d, dir_size(nslots), MS_SYNC);
+  if(rename(tmppath, s->dirpath) < 0) EXIT_TRACE("Cannot rename %s: %s\n", tmppath, strerror(errno));
+}
+
+//Write all buffered records and add the records beyond the prefix covered
+//by the directory to it. Stops at the first invalid record.
+static void sync_dir(struct fpstore *s) {
+  u_int64 off, last_archive, narchives;
+
+  flush(s);
+  fsync(s->fd);
+  map_log(s);
+
+  off = s->dir->log_size;
+  last_archive = s->dir->last_archive;
+  narchives = s->dir->narchives;
+  while(off + sizeof(record_t) <= s->log_mapped) {
+    record_t *r = (record_t *)(s->log + off);
+
+    if(r->size < sizeof(record_t) || r->size % 8 != 0 || r->size > s->log_mapped - off) break;
+    if(r->type == RECORD_CHUNK) {
+      if(r->size != sizeof(chunk_record_t)) break;
+      //Keep the directory at most half full
+      if(2 * (s->dir->nchunks + 1) > s->dir->nslots) dir_create(s, 2 * s->dir->nslots);
+      dir_insert(s, off);
+    } else if(r->type == RECORD_ARCHIVE) {
+      archive_record_t *a = (archive_record_t *)r;
+      if(r->size <= sizeof(archive_record_t) || a->id != narchives || s->log[off + r->size - 1] != '\0') break;
+      last_archive = off;
+      narchives++;
+    } else {
+      break;
+    }
+    off += r->size;
+  }
+
+  //The directory must be complete before it claims to cover the new records.
+  //If the header is not written completely, the checksum does not match.
+  msync(s->dir, dir_size(s->dir->nslots), MS_SYNC);
+  s->dir->log_size = off;
+  s->dir->last_archive = last_archive;
+  s->dir->narchives = narchives;
+  s->dir->checksum = dir_checksum(s->dir);
+  msync(s->dir, sizeof(dir_header_t), MS_SYNC);
+}
+
+//Returns TRUE if the directory mapped at `d' with `size' bytes is usable for a log of `log_size' bytes
+static int dir_valid(dir_header_t *d, size_t size, size_t log_size) {
+  if(d->magic != FPSTORE_DIR_MAGIC || d->version != FPSTORE_VERSION) return FALSE;
+  if(d->nslots == 0 || (d->nslots & (d->nslots - 1)) != 0 || size != dir_size(d->nslots)) return FALSE;
+  if(d->log_size < sizeof(log_header_t) || d->log_size > log_size) return FALSE;
+  if(d->narchives > 0 && d->last_archive >= d->log_size) return FALSE;
+  if(d->checksum != dir_checksum(d)) return FALSE;
+  return TRUE;
+}
+
+struct fpstore *fpstore_open(const char *path, int compress_type) {
+  struct fpstore *s;
+  struct stat st;
+  log_header_t header;
+  u_int64 off;
+  int fd, i;
+
+  s = (struct fpstore *)malloc(sizeof(struct fpstore));
+  if(s == NULL) EXIT_TRACE("Memory allocation failed.\n");
+  s->dirpath = (char *)malloc(strlen(path) + 5);
+  s->buf = (char *)malloc(FPSTORE_BUFFER);
+  if(s->dirpath == NULL || s->buf == NULL) EXIT_TRACE("Memory allocation failed.\n");
+  sprintf(s->dirpath, "%s.dir", path);
+  s->nbuf = 0;
+  s->bufsize = FPSTORE_BUFFER;
+  s->log = NULL;
+  s->dir = NULL;
+  s->slots = NULL;
+  s->dirfd = -1;
+
+  //Open the log, write the header of a new one
+  s->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_LARGEFILE, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if(s->fd < 0) EXIT_TRACE("Cannot open index %s: %s\n", path, strerror(errno));
+  //Other processes using the index wait until it is closed, the lock is
+  //released when the log is closed
+  if(flock(s->fd, LOCK_EX) < 0) EXIT_TRACE("Cannot lock index %s: %s\n", path, strerror(errno));
+  if(fstat(s->fd, &st) < 0) EXIT_TRACE("fstat() %s failed: %s\n", path, strerror(errno));
+  if(st.st_size == 0) {
+    header.magic = FPSTORE_MAGIC;
+    header.version = FPSTORE_VERSION;
+    header.compress_type = compress_type;
+    header.unused = 0;
+    if(xwrite(s->fd, &header, sizeof(header)) < 0) EXIT_TRACE("Cannot write index %s: %s\n", path, strerror(errno));
+    st.st_size = sizeof(header);
+  } else {
+    if(xread(s->fd, &header, sizeof(header)) != sizeof(header) || header.magic != FPSTORE_MAGIC || header.version != FPSTORE_VERSION) {
+      EXIT_TRACE("%s is not a dedup index.\n", path);
+    }
+    if(header.compress_type != compress_type) {
+      EXIT_TRACE("Index %s is used with a different compression type.\n", path);
+    }
+  }
+
+  //Use the existing directory if it is intact, otherwise rebuild it from the log
+  fd = open(s->dirpath, O_RDWR);
+  if(fd >= 0) {
+    struct stat dst;
+    if(fstat(fd, &dst) == 0 && dst.st_size >= sizeof(dir_header_t)) {
+      dir_header_t *d = (dir_header_t *)mmap(NULL, dst.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if(d != MAP_FAILED) {
+        if(dir_valid(d, dst.st_size, st.st_size)) {
+          s->dir = d;
+          s->slots = (u_int64 *)(d + 1);
+          s->dirfd = fd;
+        } else {
+          munmap(d, dst.st_size);
+        }
+      }
+    }
+    if(s->dir == NULL) close(fd);
+  }
+  if(s->dir == NULL) dir_create(s, FPSTORE_MIN_SLOTS);
+  sync_dir(s);
+
+  //Drop a partial record left behind by an interrupted run
+  if(s->dir->log_size < s->log_mapped) {
+    printf("WARNING: Discarding %lu bytes of damaged records at the end of index %s\n", (unsigned long)(s->log_mapped - s->dir->log_size), path);
+    if(ftruncate(s->fd, s->dir->log_size) < 0) EXIT_TRACE("Cannot truncate index %s: %s\n", path, strerror(errno));
+    map_log(s);
+  }
+  s->log_end = s->dir->log_size;
+  s->last_archive = s->dir->last_archive;
+
+  //Collect the archive names by following the chain of archive records
+  s->narchives = s->dir->narchives;
+  s->names = (char **)malloc((s->narchives + 1) * sizeof(char *));
+  if(s->names == NULL) EXIT_TRACE("Memory allocation failed.\n");
+  off = s->dir->last_archive;
+  for(i=s->narchives-1; i>=0; i--) {
+    archive_record_t *a = (archive_record_t *)(s->log + off);
+    if(a->r.type != RECORD_ARCHIVE || a->id != i) EXIT_TRACE("Index %s is damaged.\n", path);
+    s->names[i] = strdup(a->name);
+    if(s->names[i] == NULL) EXIT_TRACE("Memory allocation failed.\n");
+    off = a->prev;
+  }
+
+  return s;
+}
+
+void fpstore_close(struct fpstore *s) {
+  u_int32 i;
+
+  sync_dir(s);
+  munmap(s->log, s->log_mapped);
+  munmap(s->dir, dir_size(s->dir->nslots));
+  close(s->fd);
+  close(s->dirfd);
+  for(i=0; i<s->narchives; i++) {
+    free(s->names[i]);
+  }
+  free(s->names);
+  free(s->buf);
+  free(s->dirpath);
+  free(s);
+}
+
+int fpstore_lookup(struct fpstore *s, const unsigned int *sha1, fpstore_location_t *loc) {
+  u_int64 mask = s->dir->nslots - 1;
+  u_int64 i, v;
+
+  for(i=sha1[0] & mask; (v = s->slots[i]) != 0; i=(i+1) & mask) {
+    chunk_record_t *c;
+
+    if((v & ~SLOT_OFFSET(v)) != SLOT_TAG(sha1)) continue;
+    c = (chunk_record_t *)(s->log + SLOT_OFFSET(v));
+    if(sha1_equal(c->sha1, sha1)) {
+      if(loc != NULL) {
+        loc->archive = c->archive;
+        loc->offset = c->offset;
+        loc->len = c->len;
+      }
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+int fpstore_find_archive(struct fpstore *s, const char *name) {
+  u_int32 i;
+
+  for(i=0; i<s->narchives; i++) {
+    if(strcmp(s->names[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+const char *fpstore_archive_name(struct fpstore *s, u_int32 archive) {
+  if(archive >= s->narchives) EXIT_TRACE("Index refers to an unknown archive.\n");
+  return s->names[archive];
+}
+
+u_int32 fpstore_add_archive(struct fpstore *s, const char *name) {
+  size_t size = (sizeof(archive_record_t) + strlen(name) + 1 + 7) / 8 * 8;
+  u_int64 off = s->log_end;
+  archive_record_t *a;
+  char **names;
+
+  if(size > FPSTORE_BUFFER) EXIT_TRACE("Archive name too long.\n");
+  a = (archive_record_t *)append(s, size);
+  a->r.type = RECORD_ARCHIVE;
+  a->r.size = size;
+  a->id = s->narchives;
+  a->prev = s->last_archive;
+  strcpy(a->name, name);
+  s->last_archive = off;
+
+  names = (char **)realloc(s->names, (s->narchives + 1) * sizeof(char *));
+  if(names == NULL) EXIT_TRACE("Memory allocation failed.\n");
+  s->names = names;
+  s->names[s->narchives] = strdup(name);
+  if(s->names[s->narchives] == NULL) EXIT_TRACE("Memory allocation failed.\n");
+  return s->narchives++;
+}
+
+void fpstore_add_chunk(struct fpstore *s, const unsigned int *sha1, u_int32 archive, u_int64 offset, u_int64 len) {
+  chunk_record_t *c;
+
+  assert(archive < s->narchives);
+  c = (chunk_record_t *)append(s, sizeof(chunk_record_t));
+  c->r.type = RECORD_CHUNK;
+  c->r.size = sizeof(chunk_record_t);
+  memcpy(c->sha1, sha1, SHA1_LEN);
+  c->archive = archive;
+  c->offset = offset;
+  c->len = len;
+}
@@ -0,0 +1,70 @@
+/* This file contains the persistent fingerprint index which allows
+ * incremental encoding: An archive can refer to chunks whose compressed data
+ * is stored in an archive written by an earlier run instead of storing the
+ * data again.
+ *
+ * The index consists of two files:
+ *  - An append-only log <path> with a record for every archive and for every
+ *    chunk stored in one of them (SHA1 sum, archive, offset and size of the
+ *    compressed data).
+ *  - A hash directory <path>.dir which maps SHA1 sums to chunk records in the
+ *    log. The directory uses open addressing with linear probing, each slot
+ *    holds the offset of a record and 16 bits of the SHA1 sum so that most
+ *    mismatches do not touch the log.
+ * Both files are memory-mapped. The directory only covers a prefix of the
+ * log, records beyond it are added when the index is opened or closed. This
+ * makes the directory disposable: it is rebuilt from the log if it is lost or
+ * if it does not match its checksum.
+ *
+ * New records are kept in memory and written to the log when the index is
+ * closed. The caller has to make the data of the new chunks durable before,
+ * so that the log never points to data which is not on disk.
+ *
+ * An index is locked while it is open, a process opening an index which is
+ * in use waits until it is closed.
+ *
+ * Note on use in multithreaded programs:
+ * Lookups do not modify the index and can be done by any number of threads.
+ * They only see chunks that were in the index when it was opened. Adding
+ * archives and chunks is limited to a single thread.
+ */
+
+#ifndef _FPSTORE_H_
+#define _FPSTORE_H_
+
+#include "dedupdef.h"
+
+struct fpstore;
+
+//Location of the compressed data of a chunk
+typedef struct {
+  u_int32 archive;
+  u_int64 offset;
+  u_int64 len;
+} fpstore_location_t;
+
+//Open the index at `path', creating it if necessary. All archives referenced
+//by an index must use the same compression type.
+struct fpstore *fpstore_open(const char *path, int compress_type);
+
+//Write all records added since the index was opened to the log, add them to
+//the directory and close it
+void fpstore_close(struct fpstore *s);
+
+//Look up a SHA1 sum, returns TRUE and the location of the chunk in *loc
+//(unless loc is NULL) if it is found
+int fpstore_lookup(struct fpstore *s, const unsigned int *sha1, fpstore_location_t *loc);
+
+//Returns the id of the archive with the given name, or -1 if it is unknown
+int fpstore_find_archive(struct fpstore *s, const char *name);
+
+//Returns the name of an archive
+const char *fpstore_archive_name(struct fpstore *s, u_int32 archive);
+
+//Add an archive and return its id
+u_int32 fpstore_add_archive(struct fpstore *s, const char *name);
+
+//Add a chunk whose compressed data is stored in `archive' at `offset'
+void fpstore_add_chunk(struct fpstore *s, const unsigned int *sha1, u_int32 archive, u_int64 offset, u_int64 len);
+
+#endif //_FPSTORE_H_
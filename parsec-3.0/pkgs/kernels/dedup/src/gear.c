@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "dedupdef.h"
+#include "gear.h"
+
+//Cut masks before and after the normal chunk size. They select the top bits
+//of the hash, which depend on all 64 bytes of the window, and are two bits
+//harder and easier than the 12 bits needed for the average size of 4 KB.
+#define GEAR_MASK(bits) (~(u64int)0 << (64 - (bits)))
+#define GearMaskS GEAR_MASK(14)
+#define GearMaskL GEAR_MASK(10)
+
+//Number of bytes the hash depends on
+#define GEAR_WINDOW 64
+
+static u64int geartab[256];
+
+void gearinit(void) {
+  u64int x = 0x2545f4914f6cdd1dULL;
+  int i;
+
+  //Fixed seed, chunk boundaries must not change between runs
+  for(i=0; i<256; i++) {
+    u64int z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    geartab[i] = z ^ (z >> 31);
+  }
+}
+
+//Returns the first position i in [from, to) such that the hash of the
+//window ending at byte i matches the mask, plus one, or `to' if none does.
+//Since the hash only depends on the last 64 bytes, hashing starts 64 bytes
+//before `from' instead of at the start of the chunk.
+//The main loop hashes four bytes per iteration and tests the four cut
+//candidates with a single branch, which is rarely taken.
+static int gear_scan(uchar *p, int from, int to, u64int mask) {
+  u64int h = 0;
+  int i;
+
+  for(i=from-GEAR_WINDOW; i<from; i++) {
+    h = (h << 1) + geartab[p[i]];
+  }
+  for(; i+4<=to; i+=4) {
+    u64int h1 = (h << 1) + geartab[p[i]];
+    u64int h2 = (h1 << 1) + geartab[p[i+1]];
+    u64int h3 = (h2 << 1) + geartab[p[i+2]];
+    u64int h4 = (h3 << 1) + geartab[p[i+3]];
+    if(((h1 & mask) == 0) | ((h2 & mask) == 0) | ((h3 & mask) == 0) | ((h4 & mask) == 0)) {
+      if((h1 & mask) == 0) return i+1;
+      if((h2 & mask) == 0) return i+2;
+      if((h3 & mask) == 0) return i+3;
+      return i+4;
+    }
+    h = h4;
+  }
+  for(; i<to; i++) {
+    h = (h << 1) + geartab[p[i]];
+    if((h & mask) == 0) return i+1;
+  }
+  return to;
+}
+
+int gearseg(uchar *p, int n) {
+  int normal, max, i;
+
+  if(n <= GearMinSegment)
+    return n;
+  normal = n < GearNormalSegment ? n : GearNormalSegment;
+  max = n < GearMaxSegment ? n : GearMaxSegment;
+
+  i = gear_scan(p, GearMinSegment, normal, GearMaskS);
+  if(i < normal)
+    return i;
+  return gear_scan(p, normal, max, GearMaskL);
+}
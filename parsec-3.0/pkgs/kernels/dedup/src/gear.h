@@ -0,0 +1,30 @@
+#ifndef _GEAR_H_
+#define _GEAR_H_
+
+#include "dedupdef.h"
+
+/* Content-defined chunking with a Gear hash (FastCDC), an alternative to the
+ * Rabin fingerprints in rabin.c.
+ *
+ * The Gear hash shifts by one bit and adds a random value per byte, so it
+ * needs a single table lookup per byte and depends on exactly the last 64
+ * bytes. Chunk sizes are normalized: no cut is made before GearMinSegment
+ * bytes, a harder mask is used up to GearNormalSegment bytes and an easier
+ * one after, and GearMaxSegment bytes are cut unconditionally. This gives
+ * the same average chunk size as the Rabin chunker with a much narrower
+ * distribution.
+ */
+
+enum {
+  GearMinSegment = 1024,
+  GearNormalSegment = 4096,
+  GearMaxSegment = 65536,
+};
+
+//Initialize the Gear table, must be called once before gearseg
+void gearinit(void);
+
+//Returns the length of the first chunk of the n bytes at p
+int gearseg(uchar *p, int n);
+
+#endif //_GEAR_H_
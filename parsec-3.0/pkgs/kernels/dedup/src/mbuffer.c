@@ -123,6 +123,22 @@ int mbuffer_create(mbuffer_t *m, size_t size) {
   return 0;
 }
 
+//Initialize a memory buffer for unmanaged memory
+int mbuffer_wrap(mbuffer_t *m, void *ptr, size_t size) {
+  assert(m!=NULL);
+  assert(ptr!=NULL);
+  assert(size > 0);
+
+  m->ptr = ptr;
+  m->n = size;
+  m->mcb = NULL;
+#ifdef ENABLE_MBUFFER_CHECK
+  m->check_flag=MBUFFER_CHECK_MAGIC;
+#endif
+
+  return 0;
+}
+
 //Make a shallow copy of a memory buffer
 mbuffer_t *mbuffer_clone(mbuffer_t *m) {
   mbuffer_t *temp;
@@ -136,15 +152,17 @@ mbuffer_t *mbuffer_clone(mbuffer_t *m) {
   if(temp==NULL) return NULL;
 
   //Update reference counter
+  if(m->mcb!=NULL) {
 #ifdef ENABLE_PTHREADS
-  PTHREAD_LOCK(&locks[lock_hash(m->mcb)]);
-  assert(m->mcb->i>=1);
-  m->mcb->i++;
-  PTHREAD_UNLOCK(&locks[lock_hash(m->mcb)]);
+    PTHREAD_LOCK(&locks[lock_hash(m->mcb)]);
+    assert(m->mcb->i>=1);
+    m->mcb->i++;
+    PTHREAD_UNLOCK(&locks[lock_hash(m->mcb)]);
 #else
-  assert(m->mcb->i>=1);
-  m->mcb->i++;
+    assert(m->mcb->i>=1);
+    m->mcb->i++;
 #endif //ENABLE_PTHREADS
+  }
 
   //copy state, use joint mcb
   temp->ptr = m->ptr;
@@ -192,6 +210,14 @@ void mbuffer_free(mbuffer_t *m) {
   assert(m->check_flag==MBUFFER_CHECK_MAGIC);
 #endif
 
+  //Unmanaged memory, nothing to free
+  if(m->mcb==NULL) {
+#ifdef ENABLE_MBUFFER_CHECK
+    m->check_flag=0;
+#endif
+    return;
+  }
+
   //Update meta state first to avoid races
 #ifdef ENABLE_PTHREADS
   PTHREAD_LOCK(&locks[lock_hash(m->mcb)]);
@@ -226,6 +252,9 @@ int mbuffer_realloc(mbuffer_t *m, size_t size) {
   assert(m->check_flag==MBUFFER_CHECK_MAGIC);
 #endif
 
+  //We cannot resize memory we do not own
+  if(m->mcb==NULL) return -1;
+
 #ifdef ENABLE_PTHREADS
   PTHREAD_LOCK(&locks[lock_hash(m->mcb)]);
 #endif //ENABLE_PTHREADS
@@ -276,15 +305,17 @@ int mbuffer_split(mbuffer_t *m1, mbuffer_t *m2, size_t split) {
 #endif
 
   //Update reference counter
+  if(m1->mcb!=NULL) {
 #ifdef ENABLE_PTHREADS
-  PTHREAD_LOCK(&locks[lock_hash(m1->mcb)]);
-  assert(m1->mcb->i>=1);
-  m1->mcb->i++;
-  PTHREAD_UNLOCK(&locks[lock_hash(m1->mcb)]);
+    PTHREAD_LOCK(&locks[lock_hash(m1->mcb)]);
+    assert(m1->mcb->i>=1);
+    m1->mcb->i++;
+    PTHREAD_UNLOCK(&locks[lock_hash(m1->mcb)]);
 #else
-  assert(m1->mcb->i>=1);
-  m1->mcb->i++;
+    assert(m1->mcb->i>=1);
+    m1->mcb->i++;
 #endif //ENABLE_PTHREADS
+  }
 
   //split buffer
   m2->ptr = m1->ptr+split;
@@ -47,7 +47,7 @@ typedef struct {
 typedef struct {
   void *ptr; //pointer to the buffer
   size_t n; //size of the buffer in bytes
-  mcb_t *mcb; //meta information needed for malloc/free operations
+  mcb_t *mcb; //meta information needed for malloc/free operations, NULL if the memory is not managed by the mbuffer system
 #ifdef ENABLE_MBUFFER_CHECK
   int check_flag;
 #endif
@@ -65,6 +65,11 @@ int mbuffer_system_destroy();
 //The mbuffer system will not attempt to free argument *m
 int mbuffer_create(mbuffer_t *m, size_t size);
 
+//Initialize a memory buffer for memory that is not managed by the mbuffer system (e.g. a file mapping)
+//The memory is never freed by the mbuffer system, it must stay valid until all buffers derived from m are freed
+//Such buffers do not need a reference counter, so cloning, splitting and freeing them requires no locking
+int mbuffer_wrap(mbuffer_t *m, void *ptr, size_t size);
+
 //Make a shallow copy of a memory buffer
 mbuffer_t *mbuffer_clone(mbuffer_t *m);
 
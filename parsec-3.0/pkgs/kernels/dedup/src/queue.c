@@ -6,17 +6,39 @@
 
 #ifdef ENABLE_PTHREADS
 #include <pthread.h>
+#include <sched.h>
 #endif //ENABLE_PTHREADS
 
+//Number of times a thread retries an empty or full queue before it goes to sleep
+#define QUEUE_SPIN 64
+
+//Values of the turn of a slot at position `pos' when the slot is ready to be
+//filled (EMPTY) or to be emptied (FULL). Slots start out with turn 0, so a
+//freshly allocated ring can be zero-filled lazily by calloc.
+#define TURN_EMPTY(que, pos) (2 * ((pos) >> (que)->shift))
+#define TURN_FULL(que, pos) (2 * ((pos) >> (que)->shift) + 1)
+
 void queue_init(queue_t * que, size_t size, int nProducers) {
+  size_t capacity;
+
 #ifdef ENABLE_PTHREADS
   pthread_mutex_init(&que->mutex, NULL);
   pthread_cond_init(&que->notEmpty, NULL);
   pthread_cond_init(&que->notFull, NULL);
 #endif
-  assert(!ringbuffer_init(&(que->buf), size));
+  //Round the capacity up to a power of two so positions map to slots with a mask
+  que->shift = 0;
+  for(capacity=1; capacity<size; capacity*=2) que->shift++;
+  que->mask = capacity - 1;
+  que->slots = (queue_slot_t *)calloc(capacity, sizeof(queue_slot_t));
+  assert(que->slots != NULL);
+  que->head = 0;
+  que->tail = 0;
   que->nProducers = nProducers;
   que->nTerminated = 0;
+  que->nIdle = 0;
+  que->nAsleepEmpty = 0;
+  que->nAsleepFull = 0;
 }
 
 void queue_destroy(queue_t * que) {
@@ -25,87 +47,165 @@ void queue_destroy(queue_t * que) {
   pthread_cond_destroy(&que->notEmpty);
   pthread_cond_destroy(&que->notFull);
 #endif
-  ringbuffer_destroy(&(que->buf));
+  free(que->slots);
 }
 
-/* Private function which requires synchronization */
 static inline int queue_isTerminated(queue_t * que) {
-  assert(que->nTerminated <= que->nProducers);
-  return que->nTerminated == que->nProducers;
+  int n = __atomic_load_n(&que->nTerminated, __ATOMIC_ACQUIRE);
+  assert(n <= que->nProducers);
+  return n == que->nProducers;
+}
+
+//Returns true if the slot at the position `*pos' is ready for the caller
+static inline int queue_isReady(queue_t *que, size_t *pos, int full) {
+  size_t p = __atomic_load_n(pos, __ATOMIC_SEQ_CST);
+  size_t turn = full ? TURN_FULL(que, p) : TURN_EMPTY(que, p);
+  return __atomic_load_n(&que->slots[p & que->mask].turn, __ATOMIC_SEQ_CST) == turn;
+}
+
+//Reserve up to `limit' consecutive slots at the position `*pos' (the head of
+//the queue for producers, the tail for consumers) which are ready to be filled
+//(full == 0) or emptied (full == 1). Returns the number of slots reserved and
+//the position of the first one in *first; 0 if the next slot is not ready.
+static int queue_reserve(queue_t *que, size_t *pos, int limit, int full, size_t *first) {
+  size_t p = __atomic_load_n(pos, __ATOMIC_RELAXED);
+  int n, idle;
+
+  while(1) {
+    for(n=0; n<limit; n++) {
+      size_t turn = full ? TURN_FULL(que, p+n) : TURN_EMPTY(que, p+n);
+      if(__atomic_load_n(&que->slots[(p+n) & que->mask].turn, __ATOMIC_ACQUIRE) != turn) break;
+    }
+    if(n == 0) {
+      size_t q = __atomic_load_n(pos, __ATOMIC_RELAXED);
+      if(q == p) return 0;
+      p = q;
+      continue;
+    }
+    //Leave a share of the elements to consumers that are waiting for work
+    if(full && n > 1 && (idle = __atomic_load_n(&que->nIdle, __ATOMIC_RELAXED)) > 0) {
+      n = (n + idle) / (idle + 1);
+    }
+    //On failure p is updated to the current position
+    if(__atomic_compare_exchange_n(pos, &p, p+n, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      *first = p;
+      return n;
+    }
+  }
 }
 
-void queue_terminate(queue_t * que) {
 #ifdef ENABLE_PTHREADS
+//Wait until the slot at `*pos' may have become ready or the queue is terminated
+static void queue_sleep(queue_t *que, size_t *pos, int full, int *nAsleep, pthread_cond_t *cond) {
   pthread_mutex_lock(&que->mutex);
-#endif
-  que->nTerminated++;
-  assert(que->nTerminated <= que->nProducers);
-#ifdef ENABLE_PTHREADS
-  if(queue_isTerminated(que)) pthread_cond_broadcast(&que->notEmpty);
+  __atomic_fetch_add(nAsleep, 1, __ATOMIC_SEQ_CST);
+  if(!queue_isReady(que, pos, full) && !(full && queue_isTerminated(que))) {
+    pthread_cond_wait(cond, &que->mutex);
+  }
+  __atomic_fetch_sub(nAsleep, 1, __ATOMIC_SEQ_CST);
   pthread_mutex_unlock(&que->mutex);
-#endif
 }
 
-int queue_dequeue(queue_t *que, ringbuffer_t *buf, int limit) {
-  int i;
+//Wake up one or all of the threads sleeping on `cond', if there are any
+static inline void queue_wake(queue_t *que, int *nAsleep, pthread_cond_t *cond, int all) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if(__atomic_load_n(nAsleep, __ATOMIC_RELAXED) > 0) {
+    pthread_mutex_lock(&que->mutex);
+    if(all) {
+      pthread_cond_broadcast(cond);
+    } else {
+      pthread_cond_signal(cond);
+    }
+    pthread_mutex_unlock(&que->mutex);
+  }
+}
+#endif //ENABLE_PTHREADS
 
+void queue_terminate(queue_t * que) {
+  int n = __atomic_add_fetch(&que->nTerminated, 1, __ATOMIC_RELEASE);
+  assert(n <= que->nProducers);
 #ifdef ENABLE_PTHREADS
-  pthread_mutex_lock(&que->mutex);
-  while (ringbuffer_isEmpty(&que->buf) && !queue_isTerminated(que)) {
-    pthread_cond_wait(&que->notEmpty, &que->mutex);
+  if(n == que->nProducers) {
+    pthread_mutex_lock(&que->mutex);
+    pthread_cond_broadcast(&que->notEmpty);
+    pthread_mutex_unlock(&que->mutex);
   }
 #endif
-  if (ringbuffer_isEmpty(&que->buf) && queue_isTerminated(que)) {
+}
+
+int queue_dequeue(queue_t *que, ringbuffer_t *buf, int limit) {
+  size_t first;
+  int i, n, done, spin;
+
+  if(limit > (int)ringbuffer_space(buf)) limit = ringbuffer_space(buf);
+
+  for(spin=0; ; spin++) {
+    //Producers terminate only after their last insertion, so if the queue
+    //was terminated before it was found empty it will stay empty
+    done = queue_isTerminated(que);
+    n = limit > 0 ? queue_reserve(que, &que->tail, limit, 1, &first) : 0;
+    if(n > 0 || limit == 0) break;
+    if(done) {
+      if(spin > 0) __atomic_fetch_sub(&que->nIdle, 1, __ATOMIC_RELAXED);
+      return -1;
+    }
 #ifdef ENABLE_PTHREADS
-    pthread_mutex_unlock(&que->mutex);
+    if(spin == 0) __atomic_fetch_add(&que->nIdle, 1, __ATOMIC_RELAXED);
+    if(spin < QUEUE_SPIN) {
+      sched_yield();
+    } else {
+      queue_sleep(que, &que->tail, 1, &que->nAsleepEmpty, &que->notEmpty);
+    }
+#else
+    return 0;
 #endif
-    return -1;
   }
+  if(spin > 0) __atomic_fetch_sub(&que->nIdle, 1, __ATOMIC_RELAXED);
 
-  //NOTE: This can be optimized by copying whole segments of pointers with memcpy. However,
-  //      `limit' is typically small so the performance benefit would be negligible.
-  for(i=0; i<limit && !ringbuffer_isEmpty(&que->buf) && !ringbuffer_isFull(buf); i++) {
-    void *temp;
+  for(i=0; i<n; i++) {
+    queue_slot_t *slot = &que->slots[(first+i) & que->mask];
     int rv;
 
-    temp = ringbuffer_remove(&que->buf);
-    assert(temp!=NULL);
-    rv = ringbuffer_insert(buf, temp);
+    assert(slot->data!=NULL);
+    rv = ringbuffer_insert(buf, slot->data);
     assert(rv==0);
+    __atomic_store_n(&slot->turn, TURN_EMPTY(que, first+i+que->mask+1), __ATOMIC_RELEASE);
   }
 #ifdef ENABLE_PTHREADS
-  if(i>0) pthread_cond_signal(&que->notFull);
-  pthread_mutex_unlock(&que->mutex);
+  if(n>0) queue_wake(que, &que->nAsleepFull, &que->notFull, n>1);
 #endif
-  return i;
+  return n;
 }
 
 int queue_enqueue(queue_t *que, ringbuffer_t *buf, int limit) {
-  int i;
+  size_t first;
+  int i, n, spin;
 
-#ifdef ENABLE_PTHREADS
-  pthread_mutex_lock(&que->mutex);
   assert(!queue_isTerminated(que));
-  while (ringbuffer_isFull(&que->buf))
-    pthread_cond_wait(&que->notFull, &que->mutex);
+  if(limit > (int)ringbuffer_count(buf)) limit = ringbuffer_count(buf);
+  if(limit == 0) return 0;
+
+  for(spin=0; (n = queue_reserve(que, &que->head, limit, 0, &first)) == 0; spin++) {
+#ifdef ENABLE_PTHREADS
+    if(spin < QUEUE_SPIN) {
+      sched_yield();
+    } else {
+      queue_sleep(que, &que->head, 0, &que->nAsleepFull, &que->notFull);
+    }
 #else
-  assert(!queue_isTerminated(que));
+    return 0;
 #endif
+  }
 
-  //NOTE: This can be optimized by copying whole segments of pointers with memcpy. However,
-  //      `limit' is typically small so the performance benefit would be negligible.
-  for(i=0; i<limit && !ringbuffer_isFull(&que->buf) && !ringbuffer_isEmpty(buf); i++) {
-    void *temp;
-    int rv;
+  for(i=0; i<n; i++) {
+    queue_slot_t *slot = &que->slots[(first+i) & que->mask];
 
-    temp = ringbuffer_remove(buf);
-    assert(temp!=NULL);
-    rv = ringbuffer_insert(&que->buf, temp);
-    assert(rv==0);
+    slot->data = ringbuffer_remove(buf);
+    assert(slot->data!=NULL);
+    __atomic_store_n(&slot->turn, TURN_FULL(que, first+i), __ATOMIC_RELEASE);
   }
 #ifdef ENABLE_PTHREADS
-  if(i>0) pthread_cond_signal(&que->notEmpty);
-  pthread_mutex_unlock(&que->mutex);
+  queue_wake(que, &que->nAsleepEmpty, &que->notEmpty, n>1);
 #endif
-  return i;
+  return n;
 }
@@ -19,16 +19,39 @@ struct _ringbuffer_t {
 
 typedef struct _ringbuffer_t ringbuffer_t;
 
+//A slot of a queue. `turn' counts how often the slot has been filled and
+//emptied, so it tells which lap of the queue the slot is in and whether it
+//currently holds an element.
+typedef struct {
+  size_t turn;
+  void *data;
+} queue_slot_t;
+
 //A synchronized queue.
-//Basically just a ring buffer with some synchronization added
+//A bounded lock-free ring which any number of threads can insert into and
+//remove from concurrently. Threads reserve a run of consecutive slots with a
+//single CAS on the head or tail position and then fill or empty them without
+//further synchronization, so a whole batch of elements moves at once.
+//The mutex and condition variables are only used to let idle threads sleep.
 struct _queue_t {
-  ringbuffer_t buf;
+  queue_slot_t *slots;
+  size_t mask;
+  int shift;
   int nProducers;
   int nTerminated;
+  //Number of consumers which are waiting for elements (spinning or asleep)
+  int nIdle;
+  int nAsleepEmpty, nAsleepFull;
 #ifdef ENABLE_PTHREADS
   pthread_mutex_t mutex;
   pthread_cond_t notEmpty, notFull;
 #endif //ENABLE_PTHREADS
+  //Next positions to insert at and to remove from, on cache lines of their own
+  char pad0[64];
+  size_t head;
+  char pad1[64];
+  size_t tail;
+  char pad2[64];
 };
 
 typedef struct _queue_t queue_t;
@@ -66,6 +89,16 @@ static inline int ringbuffer_isFull(ringbuffer_t *buf) {
   return (buf->head == (buf->tail-1+buf->size)%buf->size);
 }
 
+//Returns the number of elements in the ring buffer
+static inline size_t ringbuffer_count(ringbuffer_t *buf) {
+  return (buf->head - buf->tail + buf->size) % buf->size;
+}
+
+//Returns the number of elements that can still be inserted into the ring buffer
+static inline size_t ringbuffer_space(ringbuffer_t *buf) {
+  return buf->size - 1 - ringbuffer_count(buf);
+}
+
 //Get an element from a ringbuffer
 //Returns NULL if buffer is empty
 static inline void *ringbuffer_remove(ringbuffer_t *buf) {
@@ -107,5 +140,13 @@ void queue_terminate(queue_t * que);
 int queue_dequeue(queue_t *que, ringbuffer_t *buf, int limit);
 int queue_enqueue(queue_t *que, ringbuffer_t *buf, int limit);
 
+//Returns true if a producer should pass the elements collected in buf on to
+//the queue now. Batches are filled up while the consumers are busy but handed
+//over right away if one of them is idle, so batching never starves a stage.
+static inline int queue_shouldFlush(queue_t *que, ringbuffer_t *buf) {
+  if(ringbuffer_isFull(buf)) return 1;
+  return !ringbuffer_isEmpty(buf) && __atomic_load_n(&que->nIdle, __ATOMIC_RELAXED) > 0;
+}
+
 #endif //_QUEUE_H_
 
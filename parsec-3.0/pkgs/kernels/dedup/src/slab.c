@@ -0,0 +1,152 @@
+#include <assert.h>
+
+#include "slab.h"
+
+//Number of objects moved between a cache and the slab at once
+#define SLAB_BATCH 64
+
+//Number of objects per block
+#define SLAB_BLOCK_OBJECTS 4096
+
+//Objects are aligned like memory returned by malloc on common platforms
+#define SLAB_ALIGN 16
+
+//Layout of a free object. Objects are linked into batches through `next';
+//the first object of a batch also links the batches and holds their size.
+struct slab_object {
+  struct slab_object *next;
+  struct slab_object *batch;
+  int n;
+};
+
+//Header of a block, the objects follow it
+struct slab_block {
+  struct slab_block *next;
+  char pad[SLAB_ALIGN - sizeof(struct slab_block *)];
+};
+
+int slab_init(slab_t *s, size_t size) {
+  assert(s!=NULL);
+  assert(size > 0);
+
+  if(size < sizeof(struct slab_object)) size = sizeof(struct slab_object);
+  s->size = (size + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+  s->batches = NULL;
+  s->blocks = NULL;
+  s->top = NULL;
+  s->left = 0;
+#ifdef ENABLE_PTHREADS
+  if(pthread_mutex_init(&s->mutex, NULL) != 0) return -1;
+#endif //ENABLE_PTHREADS
+  return 0;
+}
+
+void slab_destroy(slab_t *s) {
+  struct slab_block *b, *next;
+
+  assert(s!=NULL);
+  for(b=s->blocks; b!=NULL; b=next) {
+    next = b->next;
+    free(b);
+  }
+  s->blocks = NULL;
+  s->batches = NULL;
+  s->top = NULL;
+  s->left = 0;
+#ifdef ENABLE_PTHREADS
+  pthread_mutex_destroy(&s->mutex);
+#endif //ENABLE_PTHREADS
+}
+
+void slab_cache_init(slab_cache_t *c) {
+  assert(c!=NULL);
+  c->head = NULL;
+  c->n = 0;
+}
+
+//Take a batch of free objects from the slab, carving new ones if there are
+//no free batches. Returns NULL if no memory is available.
+static struct slab_object *slab_take_batch(slab_t *s, int *n) {
+  struct slab_object *head = NULL;
+  int i;
+
+#ifdef ENABLE_PTHREADS
+  pthread_mutex_lock(&s->mutex);
+#endif //ENABLE_PTHREADS
+  if(s->batches != NULL) {
+    head = s->batches;
+    s->batches = head->batch;
+    *n = head->n;
+  } else {
+    if(s->left == 0) {
+      struct slab_block *b = (struct slab_block *)malloc(sizeof(struct slab_block) + SLAB_BLOCK_OBJECTS * s->size);
+      if(b != NULL) {
+        b->next = s->blocks;
+        s->blocks = b;
+        s->top = (char *)(b + 1);
+        s->left = SLAB_BLOCK_OBJECTS;
+      }
+    }
+    //Link the objects back to front, so the batch is handed out in address order
+    *n = s->left < SLAB_BATCH ? s->left : SLAB_BATCH;
+    for(i=*n-1; i>=0; i--) {
+      struct slab_object *o = (struct slab_object *)(s->top + i * s->size);
+      o->next = head;
+      head = o;
+    }
+    s->top += *n * s->size;
+    s->left -= *n;
+  }
+#ifdef ENABLE_PTHREADS
+  pthread_mutex_unlock(&s->mutex);
+#endif //ENABLE_PTHREADS
+  return head;
+}
+
+//Give a batch of `n' free objects back to the slab
+static void slab_give_batch(slab_t *s, struct slab_object *head, int n) {
+  head->n = n;
+#ifdef ENABLE_PTHREADS
+  pthread_mutex_lock(&s->mutex);
+#endif //ENABLE_PTHREADS
+  head->batch = s->batches;
+  s->batches = head;
+#ifdef ENABLE_PTHREADS
+  pthread_mutex_unlock(&s->mutex);
+#endif //ENABLE_PTHREADS
+}
+
+void *slab_alloc(slab_t *s, slab_cache_t *c) {
+  struct slab_object *o;
+
+  if(c->head == NULL) {
+    c->head = slab_take_batch(s, &c->n);
+    if(c->head == NULL) return NULL;
+  }
+  o = c->head;
+  c->head = o->next;
+  c->n--;
+  return (void *)o;
+}
+
+void slab_free(slab_t *s, slab_cache_t *c, void *p) {
+  struct slab_object *o = (struct slab_object *)p;
+  int i;
+
+  assert(p!=NULL);
+  o->next = c->head;
+  c->head = o;
+  c->n++;
+
+  //Keep one batch for future allocations and pass the rest on
+  if(c->n >= 2 * SLAB_BATCH) {
+    struct slab_object *last = c->head;
+
+    for(i=1; i<SLAB_BATCH; i++) last = last->next;
+    o = c->head;
+    c->head = last->next;
+    last->next = NULL;
+    c->n -= SLAB_BATCH;
+    slab_give_batch(s, o, SLAB_BATCH);
+  }
+}
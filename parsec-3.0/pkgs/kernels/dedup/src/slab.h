@@ -0,0 +1,65 @@
+/* This file contains a slab allocator for objects of a fixed size, used for
+ * the chunk_t structures of the encoder.
+ *
+ * Objects are carved from large blocks which are only returned to the system
+ * when the whole slab is destroyed, so objects do not have to be freed
+ * individually at the end of a run.
+ *
+ * Note on use in multithreaded programs:
+ * Every thread allocates from and frees to its own cache, which needs no
+ * synchronization. Caches exchange batches of free objects with the slab,
+ * which is protected by a lock. A thread that only frees objects (e.g. the
+ * last pipeline stage) thus passes them on to threads that only allocate.
+ * Objects still in a cache when its thread exits are released by
+ * slab_destroy.
+ */
+
+#ifndef _SLAB_H_
+#define _SLAB_H_
+
+#include <stdlib.h>
+
+#ifdef ENABLE_PTHREADS
+#include <pthread.h>
+#endif //ENABLE_PTHREADS
+
+struct slab_object;
+struct slab_block;
+
+typedef struct {
+  //Size of an object in bytes
+  size_t size;
+  //Stack of batches of free objects
+  struct slab_object *batches;
+  //All blocks allocated so far, and the unused objects of the newest one
+  struct slab_block *blocks;
+  char *top;
+  size_t left;
+#ifdef ENABLE_PTHREADS
+  pthread_mutex_t mutex;
+#endif //ENABLE_PTHREADS
+} slab_t;
+
+//Free objects owned by a single thread
+typedef struct {
+  struct slab_object *head;
+  int n;
+} slab_cache_t;
+
+//Initialize a slab for objects of `size' bytes
+//Returns 0 if the operation was successful
+int slab_init(slab_t *s, size_t size);
+
+//Destroy a slab, releasing all of its objects at once
+void slab_destroy(slab_t *s);
+
+//Initialize an empty per-thread cache
+void slab_cache_init(slab_cache_t *c);
+
+//Allocate an object, returns NULL if no memory is available
+void *slab_alloc(slab_t *s, slab_cache_t *c);
+
+//Free an object which has been allocated from `s'
+void slab_free(slab_t *s, slab_cache_t *c, void *p);
+
+#endif //_SLAB_H_